@@ -0,0 +1,306 @@
+import math
+
+import esphome.codegen as cg
+import esphome.config_validation as cv
+import esphome.final_validate as fv
+from esphome.components import spi
+from esphome.const import CONF_ID
+from esphome import automation, pins
+
+MULTI_CONF = True
+
+CONF_RADIO = "radio"
+RADIO_CC1101 = "cc1101"
+RADIO_NRF905 = "nrf905"
+RADIO_MOCK = "mock"
+
+# Define custom pin constants for CC1101
+CONF_GDO0_PIN = "gdo0_pin"
+CONF_GDO2_PIN = "gdo2_pin"
+CONF_CS_PIN = "cs_pin"
+CONF_RX_INTERRUPT = "rx_interrupt"
+CONF_OPERATION_TIMEOUT = "operation_timeout"
+CONF_CALIBRATION_INTERVAL = "calibration_interval"
+CONF_LISTEN = "listen"
+CONF_RADIO_TASK = "radio_task"
+CONF_CAPTURE = "capture"
+CONF_WAKE_ON_RADIO = "wake_on_radio"
+CONF_INTERVAL = "interval"
+CONF_RX_TIME = "rx_time"
+CONF_ZEHNDER_FAN_ID = "zehnder_fan_id"
+
+# nRF905 pins
+CONF_TRX_CE_PIN = "trx_ce_pin"
+CONF_TX_EN_PIN = "tx_en_pin"
+CONF_PWR_UP_PIN = "pwr_up_pin"
+CONF_DR_PIN = "dr_pin"
+CONF_CD_PIN = "cd_pin"
+
+# Simulated main unit
+CONF_REPLY_DELAY = "reply_delay"
+CONF_REPLY_LOSS = "reply_loss"
+
+# CC1101 radio parameters
+CONF_FREQUENCY = "frequency"
+CONF_FREQUENCY_OFFSET = "frequency_offset"
+CONF_DATA_RATE = "data_rate"
+CONF_DEVIATION = "deviation"
+CONF_RX_BANDWIDTH = "rx_bandwidth"
+CONF_TX_POWER = "tx_power"
+RADIO_PARAMETERS = (
+    CONF_FREQUENCY,
+    CONF_FREQUENCY_OFFSET,
+    CONF_DATA_RATE,
+    CONF_DEVIATION,
+    CONF_RX_BANDWIDTH,
+    CONF_TX_POWER,
+)
+
+# Wake-on-Radio timing with WOR_RES = 0 and a 26 MHz crystal: one Event0 tick
+# is 750 / 26 MHz, and RX_TIME n listens for 3.6058 us per tick / 2^n
+WOR_EVENT0_TICK_US = 750 / 26
+WOR_RX_TIME_US_PER_TICK = 3.6058
+WOR_MAX_RX_TIME = 6
+
+def wor_registers(interval_us, rx_time_us):
+    event0 = round(interval_us / WOR_EVENT0_TICK_US)
+    # Shortest window that still covers the requested RX time
+    for rx_time in range(WOR_MAX_RX_TIME, -1, -1):
+        if event0 * WOR_RX_TIME_US_PER_TICK / (1 << rx_time) >= rx_time_us:
+            return event0, rx_time
+    return None
+
+def validate_wake_on_radio(config):
+    interval_us = config[CONF_INTERVAL].total_microseconds
+    if round(interval_us / WOR_EVENT0_TICK_US) > 0xFFFF:
+        raise cv.Invalid(f"{CONF_INTERVAL} can be at most 1.89s")
+    if wor_registers(interval_us, config[CONF_RX_TIME].total_microseconds) is None:
+        raise cv.Invalid(f"{CONF_RX_TIME} can be at most 12.5% of {CONF_INTERVAL}")
+    return config
+
+# Register encodings from the CC1101 datasheet, all relative to the crystal
+CC1101_XOSC_HZ = 26_000_000
+# PATABLE settings for 868 MHz from the datasheet, by output power in dBm
+CC1101_PA_868 = {-30: 0x03, -20: 0x0F, -15: 0x1E, -10: 0x27, -6: 0x38, 0: 0x8E, 5: 0x84, 7: 0xCC, 10: 0xC3, 12: 0xC0}
+
+def freq_register(frequency):
+    return round(frequency * 2**16 / CC1101_XOSC_HZ)
+
+def freqoff_register(offset):
+    # Two's complement byte
+    return round(offset * 2**14 / CC1101_XOSC_HZ) & 0xFF
+
+def drate_registers(data_rate):
+    exponent = math.floor(math.log2(data_rate * 2**20 / CC1101_XOSC_HZ))
+    mantissa = round(data_rate * 2**28 / (CC1101_XOSC_HZ * 2**exponent)) - 256
+    if mantissa == 256:
+        exponent, mantissa = exponent + 1, 0
+    return exponent, mantissa
+
+def deviatn_register(deviation):
+    # Closest of the 64 settings
+    def deviation_of(reg):
+        return CC1101_XOSC_HZ / 2**17 * (8 + (reg & 0x07)) * 2 ** (reg >> 4)
+    return min(((e << 4) | m for e in range(8) for m in range(8)), key=lambda reg: abs(deviation_of(reg) - deviation))
+
+def chanbw_register(bandwidth):
+    # Narrowest filter that still passes the requested bandwidth
+    settings = [(CC1101_XOSC_HZ / (8 * (4 + m) * 2**e), (e << 2) | m) for e in range(4) for m in range(4)]
+    return min((bw, reg) for bw, reg in settings if round(bw) >= bandwidth)[1]
+
+def validate_tx_power(value):
+    value = cv.float_with_unit("power", "(dBm|dbm)", optional_unit=True)(value)
+    if value not in CC1101_PA_868:
+        levels = ", ".join(f"{level}dBm" for level in CC1101_PA_868)
+        raise cv.Invalid(f"{CONF_TX_POWER} must be one of {levels}")
+    return int(value)
+
+def validate_config(config):
+    if CONF_WAKE_ON_RADIO in config:
+        if not config[CONF_LISTEN]:
+            raise cv.Invalid(f"{CONF_WAKE_ON_RADIO} requires {CONF_LISTEN}: true")
+        if not config[CONF_RX_INTERRUPT]:
+            raise cv.Invalid(f"{CONF_WAKE_ON_RADIO} requires {CONF_RX_INTERRUPT}: true")
+    return config
+
+zehnder_fan_ns = cg.esphome_ns.namespace("zehnder_fan")
+ZehnderRadio = zehnder_fan_ns.class_("ZehnderRadio", cg.Component)
+DumpCaptureAction = zehnder_fan_ns.class_("DumpCaptureAction", automation.Action)
+
+WAKE_ON_RADIO_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_INTERVAL, default="15ms"): cv.positive_time_period_microseconds,
+            cv.Optional(CONF_RX_TIME, default="1ms"): cv.positive_time_period_microseconds,
+        }
+    ),
+    validate_wake_on_radio,
+)
+
+# Options shared by all radio backends
+BASE_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(ZehnderRadio),
+        cv.Optional(CONF_OPERATION_TIMEOUT, default="10s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_CALIBRATION_INTERVAL, default="10min"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(min=cv.TimePeriod(seconds=10))
+        ),
+        cv.Optional(CONF_LISTEN, default=False): cv.boolean,
+        # Run the protocol in its own FreeRTOS task instead of the main loop
+        cv.Optional(CONF_RADIO_TASK, default=False): cv.boolean,
+        # Keep the latest frames in a RAM ring for zehnder_fan.dump_capture
+        cv.Optional(CONF_CAPTURE, default=False): cv.boolean,
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+SPI_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_CS_PIN): pins.gpio_output_pin_schema,
+        cv.Required(spi.CONF_SPI_ID): cv.use_id(spi.SPIComponent),
+    }
+)
+
+CC1101_SCHEMA = cv.All(
+    BASE_SCHEMA.extend(SPI_SCHEMA).extend(
+        {
+            cv.Required(CONF_GDO0_PIN): pins.internal_gpio_input_pin_schema,
+            cv.Optional(CONF_GDO2_PIN): pins.internal_gpio_input_pin_schema,
+            cv.Optional(CONF_RX_INTERRUPT, default=True): cv.boolean,
+            cv.Optional(CONF_WAKE_ON_RADIO): WAKE_ON_RADIO_SCHEMA,
+            # Radio parameters; without them the chip runs at 868.0 MHz, 1.2 kBaud,
+            # 5.2 kHz deviation, 58 kHz RX bandwidth and 10 dBm
+            cv.Optional(CONF_FREQUENCY): cv.All(cv.frequency, cv.Range(min=779e6, max=928e6)),
+            cv.Optional(CONF_FREQUENCY_OFFSET): cv.All(cv.frequency, cv.Range(min=-201e3, max=201e3)),
+            cv.Optional(CONF_DATA_RATE): cv.All(
+                cv.float_with_unit("data rate", "(bps|baud)"), cv.Range(min=600, max=250e3)
+            ),
+            cv.Optional(CONF_DEVIATION): cv.All(cv.frequency, cv.Range(min=1.6e3, max=380e3)),
+            cv.Optional(CONF_RX_BANDWIDTH): cv.All(cv.frequency, cv.Range(max=812.5e3)),
+            cv.Optional(CONF_TX_POWER): validate_tx_power,
+        }
+    ),
+    validate_config,
+)
+
+NRF905_SCHEMA = BASE_SCHEMA.extend(SPI_SCHEMA).extend(
+    {
+        cv.Required(CONF_TRX_CE_PIN): pins.gpio_output_pin_schema,
+        cv.Required(CONF_TX_EN_PIN): pins.gpio_output_pin_schema,
+        cv.Required(CONF_PWR_UP_PIN): pins.gpio_output_pin_schema,
+        cv.Required(CONF_DR_PIN): pins.gpio_input_pin_schema,
+        cv.Optional(CONF_CD_PIN): pins.gpio_input_pin_schema,
+    }
+)
+
+MOCK_SCHEMA = BASE_SCHEMA.extend(
+    {
+        cv.Optional(CONF_REPLY_DELAY, default="50ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_REPLY_LOSS, default="0%"): cv.percentage_int,
+    }
+)
+
+CONFIG_SCHEMA = cv.typed_schema(
+    {
+        RADIO_CC1101: CC1101_SCHEMA,
+        RADIO_NRF905: NRF905_SCHEMA,
+        RADIO_MOCK: MOCK_SCHEMA,
+    },
+    key=CONF_RADIO,
+    default_type=RADIO_CC1101,
+    lower=True,
+)
+
+def final_validate(config):
+    # The backend, the task mode, the capture and the radio parameters are
+    # compiled in, so every radio in the build has to agree
+    hubs = fv.full_config.get()["zehnder_fan"]
+    for key in (CONF_RADIO, CONF_RADIO_TASK, CONF_CAPTURE) + RADIO_PARAMETERS:
+        if len({conf.get(key) for conf in hubs}) > 1:
+            raise cv.Invalid(f"All zehnder_fan radios must use the same {key}")
+    return config
+
+FINAL_VALIDATE_SCHEMA = final_validate
+
+@automation.register_action(
+    "zehnder_fan.dump_capture",
+    DumpCaptureAction,
+    automation.maybe_simple_id({cv.GenerateID(): cv.use_id(ZehnderRadio)}),
+)
+async def dump_capture_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    cg.add(var.set_record_key(str(config[CONF_ID])))
+    cg.add(var.set_operation_timeout(config[CONF_OPERATION_TIMEOUT]))
+    cg.add(var.set_calibration_interval(config[CONF_CALIBRATION_INTERVAL]))
+    cg.add(var.set_listen(config[CONF_LISTEN]))
+    if config[CONF_RADIO_TASK]:
+        cg.add_define("USE_ZEHNDER_FAN_RADIO_TASK")
+    if config[CONF_CAPTURE]:
+        cg.add_define("USE_ZEHNDER_FAN_CAPTURE")
+
+    radio = config[CONF_RADIO]
+    if radio == RADIO_MOCK:
+        cg.add_define("USE_ZEHNDER_FAN_MOCK")
+        cg.add(var.set_reply_delay(config[CONF_REPLY_DELAY]))
+        cg.add(var.set_reply_loss(config[CONF_REPLY_LOSS]))
+        return
+
+    # Set SPI parent
+    spi_parent = await cg.get_variable(config[spi.CONF_SPI_ID])
+    cg.add(var.set_spi_parent(spi_parent))
+    cs_pin = await cg.gpio_pin_expression(config[CONF_CS_PIN])
+    cg.add(var.set_cs_pin(cs_pin))
+
+    if radio == RADIO_NRF905:
+        cg.add_define("USE_ZEHNDER_FAN_NRF905")
+        for conf, setter in (
+            (CONF_TRX_CE_PIN, var.set_trx_ce_pin),
+            (CONF_TX_EN_PIN, var.set_tx_en_pin),
+            (CONF_PWR_UP_PIN, var.set_pwr_up_pin),
+            (CONF_DR_PIN, var.set_dr_pin),
+            (CONF_CD_PIN, var.set_cd_pin),
+        ):
+            if conf in config:
+                pin = await cg.gpio_pin_expression(config[conf])
+                cg.add(setter(pin))
+        return
+
+    # Register CC1101 pins
+    cg.add_define("USE_ZEHNDER_FAN_CC1101")
+    gdo0_pin = await cg.gpio_pin_expression(config[CONF_GDO0_PIN])
+    cg.add(var.set_gdo0_pin(gdo0_pin))
+    
+    if CONF_GDO2_PIN in config:
+        gdo2_pin = await cg.gpio_pin_expression(config[CONF_GDO2_PIN])
+        cg.add(var.set_gdo2_pin(gdo2_pin))
+
+    cg.add(var.set_rx_interrupt(config[CONF_RX_INTERRUPT]))
+
+    # Register values for cc1101_config_regs and the PATABLE, fixed at compile time
+    if CONF_FREQUENCY in config:
+        cg.add_define("ZEHNDER_FAN_CC1101_FREQ", freq_register(config[CONF_FREQUENCY]))
+    if CONF_FREQUENCY_OFFSET in config:
+        cg.add_define("ZEHNDER_FAN_CC1101_FREQOFF", freqoff_register(config[CONF_FREQUENCY_OFFSET]))
+    if CONF_DATA_RATE in config:
+        exponent, mantissa = drate_registers(config[CONF_DATA_RATE])
+        cg.add_define("ZEHNDER_FAN_CC1101_DRATE_E", exponent)
+        cg.add_define("ZEHNDER_FAN_CC1101_DRATE_M", mantissa)
+    if CONF_DEVIATION in config:
+        cg.add_define("ZEHNDER_FAN_CC1101_DEVIATN", deviatn_register(config[CONF_DEVIATION]))
+    if CONF_RX_BANDWIDTH in config:
+        cg.add_define("ZEHNDER_FAN_CC1101_CHANBW", chanbw_register(config[CONF_RX_BANDWIDTH]))
+    if CONF_TX_POWER in config:
+        cg.add_define("ZEHNDER_FAN_CC1101_PATABLE", CC1101_PA_868[config[CONF_TX_POWER]])
+
+    if CONF_WAKE_ON_RADIO in config:
+        wor = config[CONF_WAKE_ON_RADIO]
+        event0, rx_time = wor_registers(
+            wor[CONF_INTERVAL].total_microseconds, wor[CONF_RX_TIME].total_microseconds
+        )
+        cg.add(var.set_wake_on_radio(event0, rx_time))
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "radio.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace zehnder_fan {
+
+static const uint8_t FAN_CAPTURE_VERSION = 1;
+static const size_t FAN_CAPTURE_SIZE = 64;  // Records kept in RAM, 2 KiB
+
+enum class FanCaptureDirection : uint8_t {
+    RX = 0,
+    TX = 1,
+};
+
+// One frame as it went over the air, with the protocol state at that moment.
+// The layout is fixed (32 bytes, little-endian, no padding) and only ever
+// extended into the reserved bytes under a new FAN_CAPTURE_VERSION, so dumps
+// can be decoded off the device.
+struct __attribute__((packed)) FanCaptureRecord {
+    uint32_t timestamp_us;  // micros() at the end of the frame: TX done or GDO0 edge
+    uint16_t sequence;      // Counts every record; a gap means records were overwritten
+    uint8_t direction;      // FanCaptureDirection
+    uint8_t unit;           // Unit whose operation held the radio, FAN_CAPTURE_NO_UNIT while listening
+    uint8_t op_type;        // RadioOperationType
+    uint8_t op_state;       // RadioOperationState
+    uint8_t attempt;        // Retry count of the operation
+    uint8_t data[FAN_FRAMESIZE];
+    uint8_t status[FAN_RX_STATUS_BYTES];  // RSSI and LQI/CRC_OK of received frames, zero for sent ones
+    uint8_t reserved[3];
+};
+static_assert(sizeof(FanCaptureRecord) == 32, "The capture record layout is part of the dump format");
+
+static const uint8_t FAN_CAPTURE_NO_UNIT = 0xFF;
+
+// RAM ring of the latest frames sent and received; the oldest record is
+// overwritten once it is full. Written and read only from the context the
+// protocol runs in, so it needs no locking.
+class FanCapture {
+public:
+    void add(FanCaptureRecord record) {
+        record.sequence = sequence_++;
+        records_[head_] = record;
+        head_ = (head_ + 1) % FAN_CAPTURE_SIZE;
+        if (count_ < FAN_CAPTURE_SIZE) {
+            count_++;
+        }
+    }
+
+    size_t size() const { return count_; }
+    // Records from oldest (0) to newest (size() - 1)
+    const FanCaptureRecord &get(size_t index) const {
+        return records_[(head_ + FAN_CAPTURE_SIZE - count_ + index) % FAN_CAPTURE_SIZE];
+    }
+
+private:
+    FanCaptureRecord records_[FAN_CAPTURE_SIZE]{};
+    size_t head_{0};
+    size_t count_{0};
+    uint16_t sequence_{0};
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
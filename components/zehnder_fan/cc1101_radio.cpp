@@ -0,0 +1,611 @@
+#include "cc1101_radio.h"
+
+#ifdef USE_ZEHNDER_FAN_CC1101
+
+#include "esphome/core/log.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+namespace esphome {
+namespace zehnder_fan {
+
+static const char *const TAG = "zehnder_fan";
+
+// Radio parameters. __init__.py derives them from the frequency, data_rate,
+// deviation, rx_bandwidth and tx_power options; without those the values the
+// protocol was developed with apply.
+#ifndef ZEHNDER_FAN_CC1101_FREQ
+#define ZEHNDER_FAN_CC1101_FREQ 0x216276  // 868.0 MHz
+#endif
+#ifndef ZEHNDER_FAN_CC1101_FREQOFF
+#define ZEHNDER_FAN_CC1101_FREQOFF 0x00  // Two's complement, 1.59 kHz steps
+#endif
+#ifndef ZEHNDER_FAN_CC1101_DRATE_E
+#define ZEHNDER_FAN_CC1101_DRATE_E 0x05  // 1.2 kBaud
+#define ZEHNDER_FAN_CC1101_DRATE_M 0x83
+#endif
+#ifndef ZEHNDER_FAN_CC1101_CHANBW
+#define ZEHNDER_FAN_CC1101_CHANBW 0x0F  // CHANBW_E:CHANBW_M, 58 kHz
+#endif
+#ifndef ZEHNDER_FAN_CC1101_DEVIATN
+#define ZEHNDER_FAN_CC1101_DEVIATN 0x15  // 5.2 kHz
+#endif
+#ifndef ZEHNDER_FAN_CC1101_PATABLE
+#define ZEHNDER_FAN_CC1101_PATABLE 0xC3  // 10 dBm at 868 MHz
+#endif
+static_assert(ZEHNDER_FAN_CC1101_FREQ <= 0x3FFFFF, "FREQ is a 22 bit word");
+static_assert(ZEHNDER_FAN_CC1101_FREQOFF <= 0xFF, "FREQOFF is one byte");
+static_assert(ZEHNDER_FAN_CC1101_DRATE_E <= 0x0F && ZEHNDER_FAN_CC1101_DRATE_M <= 0xFF, "DRATE out of range");
+static_assert(ZEHNDER_FAN_CC1101_CHANBW <= 0x0F, "CHANBW out of range");
+static_assert((ZEHNDER_FAN_CC1101_DEVIATN & 0x88) == 0, "DEVIATN out of range");
+static_assert(ZEHNDER_FAN_CC1101_PATABLE <= 0xFF, "PATABLE entries are one byte");
+
+// Carrier sense. With CCA_MODE=11 STX is only honoured while RSSI is below
+// the absolute threshold and no frame is being received. The threshold is set
+// explicitly instead of relying on the reset values: CARRIER_SENSE_ABS_THR dB
+// relative to the input level at which the AGC reaches MAGN_TARGET, with the
+// relative threshold off so only the absolute level counts.
+static const uint8_t CC1101_MAGN_TARGET_42DB = 0x07;      // AGCCTRL2, all LNA/DVGA gain steps allowed
+static const int8_t CC1101_CS_ABS_THR_DB = 0;             // Busy at the MAGN_TARGET level and above
+static const uint8_t CC1101_CS_REL_THR_DISABLED = 0x00;   // AGCCTRL1 CARRIER_SENSE_REL_THR
+static const uint8_t CC1101_CCA_MODE_RSSI_AND_RX = 0x30;  // MCSM1 CCA_MODE=11
+static_assert(CC1101_CS_ABS_THR_DB >= -7 && CC1101_CS_ABS_THR_DB <= 7,
+              "CARRIER_SENSE_ABS_THR is a 4 bit offset in dB; -8 would disable the absolute threshold");
+
+// CC1101 868 MHz configuration for Zehnder protocol
+static constexpr uint8_t cc1101_config_regs[] = {
+    0x06,  // IOCFG2   - GDO2 output pin config (packet sent/received)
+    0x2E,  // IOCFG1   - GDO1 output pin config  
+    0x06,  // IOCFG0   - GDO0 output pin config (packet received)
+    0x47,  // FIFOTHR  - FIFO threshold
+    0xD3,  // SYNC1    - Sync word high byte
+    0x91,  // SYNC0    - Sync word low byte
+    0x10,  // PKTLEN   - Packet length (16 bytes for Zehnder)
+    0x04,  // PKTCTRL1 - Packet automation control
+    0x05,  // PKTCTRL0 - Packet automation control (fixed length)
+    0x00,  // ADDR     - Device address
+    0x00,  // CHANNR   - Channel number
+    0x06,  // FSCTRL1  - Frequency synthesizer control
+    ZEHNDER_FAN_CC1101_FREQOFF,                  // FSCTRL0  - Frequency offset
+    (ZEHNDER_FAN_CC1101_FREQ >> 16) & 0xFF,      // FREQ2    - Frequency control word, high byte
+    (ZEHNDER_FAN_CC1101_FREQ >> 8) & 0xFF,       // FREQ1    - Frequency control word, middle byte
+    ZEHNDER_FAN_CC1101_FREQ & 0xFF,              // FREQ0    - Frequency control word, low byte
+    (ZEHNDER_FAN_CC1101_CHANBW << 4) | ZEHNDER_FAN_CC1101_DRATE_E,  // MDMCFG4 - RX bandwidth, data rate exponent
+    ZEHNDER_FAN_CC1101_DRATE_M,                  // MDMCFG3  - Data rate mantissa
+    0x13,  // MDMCFG2  - Modem configuration (GFSK, 16/16 sync)
+    0x22,  // MDMCFG1  - Modem configuration
+    0xF8,  // MDMCFG0  - Modem configuration
+    ZEHNDER_FAN_CC1101_DEVIATN,                  // DEVIATN  - Modem deviation setting
+    0x07,  // MCSM2    - Main Radio Control State Machine config
+    CC1101_CCA_MODE_RSSI_AND_RX | 0x0F,          // MCSM1    - Radio state machine config (TXOFF_MODE=RX, RXOFF_MODE=RX)
+    0x18,  // MCSM0    - Main Radio Control State Machine config
+    0x14,  // FOCCFG   - Frequency Offset Compensation config
+    0x6C,  // BSCFG    - Bit Synchronization config
+    CC1101_MAGN_TARGET_42DB,                     // AGCCTRL2 - AGC control
+    CC1101_CS_REL_THR_DISABLED | (CC1101_CS_ABS_THR_DB & 0x0F),  // AGCCTRL1 - AGC control, carrier sense threshold
+    0x92,  // AGCCTRL0 - AGC control
+    0x87,  // WOREVT1  - High byte Event0 timeout
+    0x6B,  // WOREVT0  - Low byte Event0 timeout
+    0xFB,  // WORCTRL  - Wake On Radio control
+    0x56,  // FREND1   - Front end RX configuration
+    0x10,  // FREND0   - Front end TX configuration (PA_POWER 0: GFSK uses PATABLE[0])
+    0xE9,  // FSCAL3   - Frequency synthesizer calibration
+    0x2A,  // FSCAL2   - Frequency synthesizer calibration
+    0x00,  // FSCAL1   - Frequency synthesizer calibration
+    0x1F,  // FSCAL0   - Frequency synthesizer calibration
+};
+static_assert(cc1101_config_regs[CC1101_PKTLEN] == FAN_FRAMESIZE, "PKTLEN must match the Zehnder frame size");
+static_assert((cc1101_config_regs[CC1101_MCSM1] & 0x30) == CC1101_CCA_MODE_RSSI_AND_RX,
+              "The protocol's carrier sense needs CCA_MODE=11");
+static_assert((cc1101_config_regs[CC1101_AGCCTRL1] & 0x0F) != 0x08, "Carrier sense needs an absolute threshold");
+
+bool CC1101Controller::init() {
+    // Initialize SPI device
+    this->spi_setup();
+    
+    this->gdo0_pin_->setup();
+    this->gdo0_pin_->pin_mode(gpio::FLAG_INPUT);
+    
+    if (this->gdo2_pin_ != nullptr) {
+        this->gdo2_pin_->setup();
+        this->gdo2_pin_->pin_mode(gpio::FLAG_INPUT);
+    }
+
+    // Reset CC1101
+    this->reset();
+    delay(10);
+
+    // Configure for 868 MHz Zehnder operation
+    this->configure_868mhz();
+    this->update_airtime();
+
+    if (this->rx_interrupt_) {
+        // IOCFG0 = 0x06: GDO0 de-asserts at the end of a received packet
+        this->gdo0_pin_->attach_interrupt(CC1101Controller::gdo0_isr, this, gpio::INTERRUPT_FALLING_EDGE);
+    }
+    if (this->gdo2_pin_ != nullptr) {
+        // IOCFG2 = 0x06: GDO2 de-asserts when a transmitted packet has been sent
+        this->gdo2_pin_->attach_interrupt(CC1101Controller::gdo2_isr, this, gpio::INTERRUPT_FALLING_EDGE);
+    }
+
+    ESP_LOGD(TAG, "CC1101 initialized for 868 MHz operation.");
+    return true;
+}
+
+void CC1101Controller::dump_config() {
+    ESP_LOGCONFIG(TAG, "  Radio: CC1101");
+    LOG_PIN("  GDO0 Pin: ", this->gdo0_pin_);
+    LOG_PIN("  GDO2 Pin: ", this->gdo2_pin_);
+    ESP_LOGCONFIG(TAG, "  RX Mode: %s", this->rx_interrupt_ ? "interrupt" : "polling");
+    if (this->wor_event0_ != 0) {
+        ESP_LOGCONFIG(TAG, "  Wake-on-Radio: Event0 %u, RX_TIME %u", this->wor_event0_, this->wor_rx_time_);
+    }
+    ESP_LOGCONFIG(TAG, "  Frequency Word: 0x%06X, PATABLE: 0x%02X", ZEHNDER_FAN_CC1101_FREQ,
+                  ZEHNDER_FAN_CC1101_PATABLE);
+    ESP_LOGCONFIG(TAG, "  Carrier Sense: MAGN_TARGET 42 dB, threshold %+d dB", CC1101_CS_ABS_THR_DB);
+    ESP_LOGCONFIG(TAG, "  Frame Airtime: %" PRIu32 " us", this->frame_airtime_us_);
+    ESP_LOGCONFIG(TAG, "  CRC Errors: %" PRIu32, this->crc_errors_);
+    ESP_LOGCONFIG(TAG, "  RX FIFO Overflows: %" PRIu32, this->rx_overflows_);
+}
+
+void CC1101Controller::reset() {
+    // Reset via CS pin toggle
+    this->disable();
+    delayMicroseconds(5);
+    this->enable();
+    delayMicroseconds(10);
+    this->disable();
+    delayMicroseconds(41);
+    
+    // Send reset strobe
+    this->enable();
+    this->write_byte(CC1101_SRES);
+    this->disable();
+    delayMicroseconds(100);
+
+    // Register contents are back to chip defaults
+    this->shadow_valid_ = 0;
+    this->shadow_dirty_ = 0;
+}
+
+void CC1101Controller::begin_transaction() {
+    this->transaction_start_us_ = micros();
+    this->enable();
+}
+
+void CC1101Controller::end_transaction(size_t bytes) {
+    this->disable();
+    this->spi_stats_.transactions++;
+    this->spi_stats_.bytes += bytes;
+    this->spi_stats_.blocked_us += micros() - this->transaction_start_us_;
+}
+
+void CC1101Controller::execute(CC1101Batch &batch) {
+    if (batch.empty()) {
+        return;
+    }
+    this->begin_transaction();
+    this->transfer_array(batch.buffer_, batch.length_);
+    this->end_transaction(batch.length_);
+}
+
+uint8_t CC1101Controller::read_register(uint8_t reg) {
+    CC1101Batch batch;
+    size_t value = batch.read(reg);
+    this->execute(batch);
+    return batch[value];
+}
+
+void CC1101Controller::write_burst_register(uint8_t reg, const uint8_t *buffer, size_t len) {
+    CC1101Batch batch;
+    batch.write_burst(reg, buffer, len);
+    this->execute(batch);
+}
+
+uint8_t CC1101Controller::send_strobe(uint8_t strobe) {
+    CC1101Batch batch;
+    batch.strobe(strobe);
+    this->execute(batch);
+    return batch.status();
+}
+
+void CC1101Controller::set_register(uint8_t reg, uint8_t value) {
+    uint64_t bit = 1ULL << reg;
+    if ((this->shadow_valid_ & bit) && this->shadow_regs_[reg] == value) {
+        return;
+    }
+    this->shadow_regs_[reg] = value;
+    this->shadow_valid_ |= bit;
+    this->shadow_dirty_ |= bit;
+}
+
+void CC1101Controller::commit_registers(CC1101Batch &batch) {
+    // Single writes rather than bursts: a burst would end the batch, while
+    // the strobe that follows a commit can share its CS assertion this way.
+    // A typical commit touches a handful of scattered registers, so the
+    // extra address bytes cost less than another enable/disable pair.
+    for (uint8_t reg = 0; this->shadow_dirty_ != 0 && reg < CC1101_CONFIG_REG_COUNT; reg++) {
+        uint64_t bit = 1ULL << reg;
+        if (this->shadow_dirty_ & bit) {
+            batch.write(reg, this->shadow_regs_[reg]);
+            this->shadow_dirty_ &= ~bit;
+        }
+    }
+}
+
+uint8_t CC1101Controller::get_register(uint8_t reg) {
+    if (reg >= CC1101_CONFIG_REG_COUNT) {
+        return this->read_register(reg);
+    }
+    uint64_t bit = 1ULL << reg;
+    if (!(this->shadow_valid_ & bit)) {
+        this->shadow_regs_[reg] = this->read_register(reg);
+        this->shadow_valid_ |= bit;
+    }
+    return this->shadow_regs_[reg];
+}
+
+void CC1101Controller::flush_rx() {
+    this->send_strobe(CC1101_SFRX);
+}
+
+void CC1101Controller::flush_tx() {
+    this->send_strobe(CC1101_SFTX);
+}
+
+void CC1101Controller::configure_868mhz() {
+    // The output power first, then all configuration registers in burst mode
+    // starting at IOCFG2 (0x00), which ends the transaction
+    CC1101Batch batch;
+    batch.write(CC1101_PATABLE, ZEHNDER_FAN_CC1101_PATABLE);
+    batch.write_burst(CC1101_IOCFG2, cc1101_config_regs, sizeof(cc1101_config_regs));
+    this->execute(batch);
+
+    memcpy(this->shadow_regs_, cc1101_config_regs, sizeof(cc1101_config_regs));
+    this->shadow_valid_ = (1ULL << sizeof(cc1101_config_regs)) - 1;
+    this->shadow_dirty_ = 0;
+}
+
+void CC1101Controller::wake() {
+    // Pulling CS low wakes the chip from SLEEP, but strobes are ignored until
+    // the crystal runs, signalled by CHIP_RDYn going low
+    uint32_t start = micros();
+    while (this->send_strobe(CC1101_SNOP) & CC1101_STATUS_CHIP_RDYN) {
+        if (micros() - start >= CC1101_WAKE_TIMEOUT_US) {
+            ESP_LOGW(TAG, "Radio did not wake up from SLEEP");
+            break;
+        }
+        delayMicroseconds(10);
+    }
+    this->wor_active_ = false;
+}
+
+void CC1101Controller::update_airtime() {
+    // Data rate = (256 + DRATE_M) * 2^DRATE_E * f_xosc / 2^28
+    uint8_t mdmcfg4 = this->get_register(CC1101_MDMCFG4);
+    uint8_t mdmcfg1 = this->get_register(CC1101_MDMCFG1);
+    uint64_t baud = ((uint64_t) (256 + this->get_register(CC1101_MDMCFG3)) << (mdmcfg4 & 0x0F)) * CC1101_XOSC_HZ >> 28;
+    if (baud == 0) {
+        baud = 1;
+    }
+
+    // NUM_PREAMBLE; SYNC_MODE 3 and 7 send the sync word twice
+    static const uint8_t preamble_bytes[] = {2, 3, 4, 6, 8, 12, 16, 24};
+    uint8_t sync_bytes = (this->get_register(CC1101_MDMCFG2) & 0x03) == 0x03 ? 4 : 2;
+    uint32_t bits = (preamble_bytes[(mdmcfg1 >> 4) & 0x07] + sync_bytes + FAN_FRAMESIZE + 2) * 8;
+
+    this->bit_time_us_ = 1000000 / baud + 1;
+    this->frame_airtime_us_ = (uint64_t) bits * 1000000 / baud;
+    ESP_LOGD(TAG, "Data rate %" PRIu32 " baud, frame airtime %" PRIu32 " us", (uint32_t) baud, this->frame_airtime_us_);
+}
+
+void CC1101Controller::set_mode_idle() {
+    if (this->wor_active_) {
+        this->wake();
+    }
+    uint8_t status = this->send_strobe(CC1101_SIDLE);
+    // FIFO error states ignore SIDLE; only a flush brings them back to IDLE
+    CC1101State state = status_state(status);
+    if (state == CC1101State::RXFIFO_OVERFLOW) {
+        this->flush_rx();
+    } else if (state == CC1101State::TXFIFO_UNDERFLOW) {
+        this->flush_tx();
+    }
+}
+
+void CC1101Controller::set_mode_receive() {
+    if (this->wor_active_) {
+        this->wake();
+    }
+    this->set_register(CC1101_MCSM2, CC1101_MCSM2_RX_TIME_NONE);
+    CC1101Batch batch;
+    this->commit_registers(batch);
+    batch.strobe(CC1101_SRX);
+    this->execute(batch);
+}
+
+void CC1101Controller::set_mode_transmit() {
+    if (this->wor_active_) {
+        this->wake();
+    }
+    CC1101Batch batch;
+    this->commit_registers(batch);
+    batch.strobe(CC1101_STX);
+    this->tx_edges_at_start_ = this->tx_edges_.load(std::memory_order_acquire);
+    this->execute(batch);
+}
+
+void CC1101Controller::start_calibration() {
+    // SCAL is only accepted in IDLE and returns there when done (~720 us)
+    this->set_mode_idle();
+    this->send_strobe(CC1101_SCAL);
+}
+
+bool CC1101Controller::poll_calibration() {
+    // One batch polls the state and fetches the results: the status byte of
+    // the first read tells whether the calibration had finished before it
+    CC1101Batch batch;
+    const uint8_t regs[] = {CC1101_FSCAL3, CC1101_FSCAL2, CC1101_FSCAL1};
+    size_t values[3];
+    for (size_t i = 0; i < 3; i++) {
+        values[i] = batch.read(regs[i]);
+    }
+    this->execute(batch);
+    if (status_state(batch[values[0] - 1]) != CC1101State::IDLE) {
+        return false;
+    }
+
+    // The chip holds the results already; only the shadow copies are stale
+    for (size_t i = 0; i < 3; i++) {
+        this->shadow_regs_[regs[i]] = batch[values[i]];
+        this->shadow_valid_ |= 1ULL << regs[i];
+        this->shadow_dirty_ &= ~(1ULL << regs[i]);
+    }
+    this->calibration_ = FanCalibrationRecord{1, this->shadow_regs_[CC1101_FSCAL1], this->shadow_regs_[CC1101_FSCAL2],
+                                              this->shadow_regs_[CC1101_FSCAL3]};
+    this->set_register(CC1101_MCSM0, CC1101_MCSM0_MANUAL_CAL);
+    return true;
+}
+
+uint32_t CC1101Controller::get_config_hash() const {
+    // FNV-1 over FREQ2..FREQ0 and MDMCFG4..MDMCFG0, as the build configured them
+    uint32_t hash = 2166136261UL;
+    for (uint8_t reg = CC1101_FREQ2; reg <= CC1101_MDMCFG0; reg++) {
+        hash = (hash * 16777619UL) ^ cc1101_config_regs[reg];
+    }
+    return hash;
+}
+
+void CC1101Controller::restore_calibration(const FanCalibrationRecord &calibration) {
+    // Written with the next commit_registers(), before the radio enters RX/TX
+    this->set_register(CC1101_FSCAL3, calibration.fscal3);
+    this->set_register(CC1101_FSCAL2, calibration.fscal2);
+    this->set_register(CC1101_FSCAL1, calibration.fscal1);
+    this->set_register(CC1101_MCSM0, CC1101_MCSM0_MANUAL_CAL);
+    this->calibration_ = calibration;
+}
+
+void CC1101Controller::set_mode_wor() {
+    // SWOR is only accepted in IDLE
+    this->set_mode_idle();
+    this->set_register(CC1101_MCSM2, CC1101_MCSM2_RX_TIME_QUAL | this->wor_rx_time_);
+    this->set_register(CC1101_WOREVT1, this->wor_event0_ >> 8);
+    this->set_register(CC1101_WOREVT0, this->wor_event0_ & 0xFF);
+    this->set_register(CC1101_WORCTRL, CC1101_WORCTRL_WOR);
+    CC1101Batch batch;
+    this->commit_registers(batch);
+    batch.strobe(CC1101_SWORRST);
+    batch.strobe(CC1101_SWOR);
+    this->execute(batch);
+    this->wor_active_ = true;
+}
+
+bool CC1101Controller::is_tx_deferred() {
+    // The TXBYTES header clocks back the state, so one transaction answers both
+    CC1101Batch batch;
+    size_t txbytes = batch.read_status(CC1101_TXBYTES);
+    this->execute(batch);
+    if (status_state(batch.status()) != CC1101State::RX || (batch[txbytes] & CC1101_FIFO_BYTES_MASK) == 0) {
+        return false;
+    }
+    return this->gdo2_pin_ == nullptr ||
+           this->tx_edges_.load(std::memory_order_acquire) == this->tx_edges_at_start_;
+}
+
+bool CC1101Controller::poll_tx_done(uint32_t &end_us) {
+    if (this->gdo2_pin_ != nullptr) {
+        if (this->tx_edges_.load(std::memory_order_acquire) == this->tx_edges_at_start_) {
+            return false;
+        }
+        end_us = this->tx_edge_time_us_;
+        return true;
+    }
+
+    // Without GDO2: TXOFF_MODE moves the radio on to RX once the TX FIFO is
+    // empty (IDLE only if something idled it in between). The TXBYTES header
+    // clocks back the state, so one transaction answers both. A busy channel
+    // leaves the radio in RX with the frame still queued.
+    CC1101Batch batch;
+    size_t txbytes = batch.read_status(CC1101_TXBYTES);
+    this->execute(batch);
+    CC1101State state = status_state(batch.status());
+    if ((state == CC1101State::RX || state == CC1101State::IDLE) && (batch[txbytes] & CC1101_FIFO_BYTES_MASK) == 0) {
+        end_us = micros();
+        return true;
+    }
+    return false;
+}
+
+CC1101State CC1101Controller::read_chip_state() {
+    return status_state(this->send_strobe(CC1101_SNOP));
+}
+
+RadioState CC1101Controller::get_state() {
+    switch (this->read_chip_state()) {
+        case CC1101State::IDLE: return RadioState::IDLE;
+        case CC1101State::RX: return RadioState::RX;
+        case CC1101State::TX: return RadioState::TX;
+        default: return RadioState::BUSY;
+    }
+}
+
+uint8_t CC1101Controller::get_tx_bytes() {
+    CC1101Batch batch;
+    size_t txbytes = batch.read_status(CC1101_TXBYTES);
+    this->execute(batch);
+    return batch[txbytes] & CC1101_FIFO_BYTES_MASK;
+}
+
+void CC1101Controller::set_address(uint32_t address) {
+    // CC1101 uses a single byte address for filtering (ADDR register at 0x09)
+    // The Zehnder protocol may use the full 32-bit address in the payload itself,
+    // but for hardware filtering we use the lowest byte
+    this->set_register(CC1101_ADDR, (address >> 0) & 0xFF);
+}
+
+void CC1101Controller::set_tx_address(uint32_t address) {
+    // For CC1101, TX and RX use the same address register
+    this->set_address(address);
+}
+
+void CC1101Controller::set_rx_address(uint32_t address) {
+    // For CC1101, TX and RX use the same address register
+    this->set_address(address);
+}
+
+void CC1101Controller::write_tx_payload(const uint8_t *payload, size_t size) {
+    // Caller makes sure the radio is IDLE, SFTX is ignored in other states.
+    // The flush and the FIFO burst share one CS assertion.
+    CC1101Batch batch;
+    batch.strobe(CC1101_SFTX);
+    batch.write_burst(CC1101_TXFIFO, payload, std::min<size_t>(size, CC1101_FIFO_SIZE));
+    this->execute(batch);
+}
+
+void IRAM_ATTR HOT CC1101Controller::gdo0_isr(CC1101Controller *arg) {
+    arg->rx_edge_time_us_ = micros();
+    arg->rx_edges_.fetch_add(1, std::memory_order_release);
+    wake_task_from_isr(arg);
+}
+
+void IRAM_ATTR HOT CC1101Controller::gdo2_isr(CC1101Controller *arg) {
+    arg->tx_edge_time_us_ = micros();
+    arg->tx_edges_.fetch_add(1, std::memory_order_release);
+    wake_task_from_isr(arg);
+}
+
+void IRAM_ATTR HOT CC1101Controller::wake_task_from_isr(CC1101Controller *arg) {
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    TaskHandle_t task = arg->wake_task_;
+    if (task != nullptr) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+#endif
+}
+
+bool CC1101Controller::service_rx() {
+    uint32_t timestamp_us;
+    if (this->rx_interrupt_) {
+        // Nothing to fetch until the ISR has seen a packet end
+        uint32_t edges = this->rx_edges_.load(std::memory_order_acquire);
+        if (edges == this->rx_edges_handled_) {
+            return false;
+        }
+        this->rx_edges_handled_ = edges;
+        timestamp_us = this->rx_edge_time_us_;
+    } else {
+        // A read header clocks back the RX FIFO level, saturating at 15
+        // bytes; while that is short of a frame and the FIFO holds nothing
+        // to clean up, one byte settles the poll
+        timestamp_us = micros();
+        uint8_t status = this->send_strobe(CC1101_SNOP | CC1101_READ_SINGLE);
+        uint8_t level = status & CC1101_STATUS_FIFO_BYTES;
+        CC1101State state = status_state(status);
+        if (level < CC1101_STATUS_FIFO_BYTES && state != CC1101State::RXFIFO_OVERFLOW &&
+            (level == 0 || state == CC1101State::RX)) {
+            return false;
+        }
+    }
+
+    // Drain every complete frame in the FIFO. The radio stays in RX after a
+    // packet, so repeats, replies and other remotes can queue up back to back.
+    uint8_t status;
+    uint8_t rxbytes = this->read_rx_bytes(status);
+    CC1101State state = status_state(status);
+    bool overflow = (rxbytes & CC1101_FIFO_OVERFLOW) || state == CC1101State::RXFIFO_OVERFLOW;
+    uint8_t available = rxbytes & CC1101_FIFO_BYTES_MASK;
+    uint8_t count = std::min<uint8_t>(available / FAN_RX_FRAME_BYTES, FAN_RX_FIFO_FRAMES);
+
+    RxFrame frames[FAN_RX_FIFO_FRAMES];
+    if (count > 0) {
+        this->read_rx_frames(frames, count);
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        frames[i].timestamp_us = timestamp_us;
+        this->accept_rx_frame(frames[i]);
+    }
+
+    if (overflow) {
+        // The frame that hit the limit is lost and the rest cannot be realigned
+        this->rx_overflows_++;
+        ESP_LOGW(TAG, "RX FIFO overflow, recovered %u frames", count);
+        this->flush_rx();
+        this->set_mode_receive();
+    } else if (available % FAN_RX_FRAME_BYTES != 0 && state != CC1101State::RX) {
+        // A partial frame only completes while the radio is still receiving
+        ESP_LOGD(TAG, "Discarding %u stray bytes from RX FIFO", available % FAN_RX_FRAME_BYTES);
+        this->flush_rx();
+    }
+    return true;
+}
+
+void CC1101Controller::accept_rx_frame(const RxFrame &frame) {
+    // A corrupted frame must never count as a reply
+    if (!frame.crc_ok()) {
+        this->crc_errors_++;
+        ESP_LOGD(TAG, "Dropping frame with CRC error (RSSI %.1f dBm)", frame.rssi_dbm());
+        return;
+    }
+    this->link_quality_.add(frame);
+    if (!this->rx_frames_.push(frame)) {
+        ESP_LOGW(TAG, "RX frame ring full, dropping frame");
+    }
+}
+
+uint8_t CC1101Controller::read_rx_bytes(uint8_t &status) {
+    // Errata: RXBYTES can be read wrong while it changes, so read it until
+    // two consecutive values agree. Each pair of reads shares one CS assertion.
+    uint8_t rxbytes = 0;
+    for (uint8_t attempt = 0; attempt < CC1101_RXBYTES_READ_ATTEMPTS; attempt += 2) {
+        CC1101Batch batch;
+        size_t first = batch.read_status(CC1101_RXBYTES);
+        size_t second = batch.read_status(CC1101_RXBYTES);
+        this->execute(batch);
+        status = batch.status();
+        rxbytes = batch[second];
+        if (batch[first] == rxbytes) {
+            break;
+        }
+    }
+    return rxbytes;
+}
+
+void CC1101Controller::read_rx_frames(RxFrame *frames, uint8_t count) {
+    // One burst for all complete frames, payload followed by the status bytes
+    CC1101Batch batch;
+    size_t at = batch.read_burst(CC1101_RXFIFO, count * FAN_RX_FRAME_BYTES);
+    this->execute(batch);
+    for (uint8_t i = 0; i < count; i++, at += FAN_RX_FRAME_BYTES) {
+        memcpy(frames[i].data, batch.data(at), FAN_FRAMESIZE);
+        memcpy(frames[i].status, batch.data(at + FAN_FRAMESIZE), FAN_RX_STATUS_BYTES);
+    }
+}
+
+} // namespace zehnder_fan
+} // namespace esphome
+
+#endif  // USE_ZEHNDER_FAN_CC1101
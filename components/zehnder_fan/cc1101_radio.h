@@ -0,0 +1,316 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_ZEHNDER_FAN_CC1101
+
+#include "esphome/core/hal.h"
+#include "esphome/components/spi/spi.h"
+#include "radio.h"
+#include "ring_buffer.h"
+
+#include <atomic>
+#include <cstring>
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+namespace esphome {
+namespace zehnder_fan {
+
+// CC1101 Command Strobes
+static const uint8_t CC1101_SRES = 0x30;      // Reset chip
+static const uint8_t CC1101_SFSTXON = 0x31;   // Enable and calibrate frequency synthesizer
+static const uint8_t CC1101_SCAL = 0x33;      // Calibrate frequency synthesizer
+static const uint8_t CC1101_SRX = 0x34;       // Enable RX
+static const uint8_t CC1101_STX = 0x35;       // Enable TX
+static const uint8_t CC1101_SIDLE = 0x36;     // Exit RX/TX
+static const uint8_t CC1101_SWOR = 0x38;      // Start automatic RX polling (Wake-on-Radio)
+static const uint8_t CC1101_SFRX = 0x3A;      // Flush RX FIFO
+static const uint8_t CC1101_SFTX = 0x3B;      // Flush TX FIFO
+static const uint8_t CC1101_SWORRST = 0x3C;   // Reset the WOR timer to Event1
+static const uint8_t CC1101_SNOP = 0x3D;      // No operation, returns the chip status byte
+static const uint8_t CC1101_STATUS_CHIP_RDYN = 0x80;  // Set in the status byte until the crystal runs
+static const uint8_t CC1101_STATUS_FIFO_BYTES = 0x0F; // RX (read header) or free TX (write header) FIFO bytes
+static const uint32_t CC1101_WAKE_TIMEOUT_US = 1000;  // Crystal start-up after SLEEP takes ~150 us
+static const uint32_t CC1101_CCA_SETTLE_US = 500;     // RX time before STX so RSSI reflects the channel
+
+// CC1101 Register Access
+static const uint8_t CC1101_WRITE_BURST = 0x40;
+static const uint8_t CC1101_READ_SINGLE = 0x80;
+static const uint8_t CC1101_READ_BURST = 0xC0;
+
+// CC1101 FIFO and PA table access
+static const uint8_t CC1101_PATABLE = 0x3E;
+static const uint8_t CC1101_TXFIFO = 0x3F;
+static const uint8_t CC1101_RXFIFO = 0x3F;
+
+// CC1101 Status Registers
+static const uint8_t CC1101_TXBYTES = 0x3A;
+static const uint8_t CC1101_RXBYTES = 0x3B;
+static const uint8_t CC1101_MARCSTATE = 0x35;
+static const uint8_t CC1101_FIFO_OVERFLOW = 0x80;     // RXBYTES/TXBYTES overflow/underflow flag
+static const uint8_t CC1101_FIFO_BYTES_MASK = 0x7F;
+static const uint8_t CC1101_FIFO_SIZE = 64;
+static const uint8_t CC1101_RXBYTES_READ_ATTEMPTS = 4;
+static const uint8_t FAN_RX_FIFO_FRAMES = CC1101_FIFO_SIZE / FAN_RX_FRAME_BYTES;  // Complete frames the RX FIFO holds
+
+// CC1101 Configuration Registers
+static const uint8_t CC1101_IOCFG2 = 0x00;  // Configuration register start address
+static const uint8_t CC1101_PKTLEN = 0x06;
+static const uint8_t CC1101_ADDR = 0x09;
+static const uint8_t CC1101_FREQ2 = 0x0D;
+static const uint8_t CC1101_MDMCFG4 = 0x10;
+static const uint8_t CC1101_MDMCFG3 = 0x11;
+static const uint8_t CC1101_MDMCFG2 = 0x12;
+static const uint8_t CC1101_MDMCFG1 = 0x13;
+static const uint8_t CC1101_MDMCFG0 = 0x14;
+static const uint8_t CC1101_MCSM2 = 0x16;
+static const uint8_t CC1101_MCSM1 = 0x17;
+static const uint8_t CC1101_MCSM0 = 0x18;
+static const uint8_t CC1101_AGCCTRL2 = 0x1B;
+static const uint8_t CC1101_AGCCTRL1 = 0x1C;
+static const uint8_t CC1101_WOREVT1 = 0x1E;
+static const uint8_t CC1101_WOREVT0 = 0x1F;
+static const uint8_t CC1101_WORCTRL = 0x20;
+static const uint8_t CC1101_FSCAL3 = 0x23;
+static const uint8_t CC1101_FSCAL2 = 0x24;
+static const uint8_t CC1101_FSCAL1 = 0x25;
+static const uint8_t CC1101_CONFIG_REG_COUNT = 0x2F;  // 0x00-0x2E are read/write configuration registers
+
+// Largest batch: every configuration register as a single write plus the strobes that follow
+static const size_t CC1101_BATCH_SIZE = 2 * CC1101_CONFIG_REG_COUNT + 4;
+
+// MCSM2: RX_TIME_QUAL keeps the radio in RX past the WOR timeout once a sync
+// word was found; RX_TIME 7 disables the timeout for normal reception
+static const uint8_t CC1101_MCSM2_RX_TIME_QUAL = 0x08;
+static const uint8_t CC1101_MCSM2_RX_TIME_NONE = 0x07;
+// MCSM0 with FS_AUTOCAL = 0: mode changes reuse the cached FSCAL values
+static const uint8_t CC1101_MCSM0_MANUAL_CAL = 0x08;
+// WORCTRL: RC oscillator on, EVENT1 ~1.4 ms, RC calibration on, WOR_RES 0
+static const uint8_t CC1101_WORCTRL_WOR = 0x78;
+static const uint32_t CC1101_XOSC_HZ = 26000000;
+
+// STATE field (bits 6:4) of the chip status byte clocked out with every header byte
+enum class CC1101State : uint8_t {
+    IDLE = 0,
+    RX = 1,
+    TX = 2,
+    FSTXON = 3,
+    CALIBRATE = 4,
+    SETTLING = 5,
+    RXFIFO_OVERFLOW = 6,
+    TXFIFO_UNDERFLOW = 7,
+};
+
+inline CC1101State status_state(uint8_t status) { return static_cast<CC1101State>((status >> 4) & 0x07); }
+
+// Accesses sent in one CS assertion. Strobes and single register accesses
+// may follow each other while CS stays low; a burst access runs until CS
+// rises, so it has to come last. The controller clocks the whole batch out
+// with one full-duplex transfer_array(), which the SPI bus can hand to DMA,
+// and the bytes clocked back replace the buffer: the chip status byte for
+// every header, the value for every read.
+class CC1101Batch {
+public:
+    // Each returns the buffer offset of its result: the status byte for
+    // strobes and writes, the value for reads (its status byte precedes it)
+    size_t strobe(uint8_t strobe) { return this->header(strobe); }
+    size_t write(uint8_t reg, uint8_t value) {
+        size_t at = this->header(reg);
+        this->buffer_[this->length_++] = value;
+        return at;
+    }
+    size_t read(uint8_t reg) { return this->read_value(reg | CC1101_READ_SINGLE); }
+    // Status registers are addressed with the burst bit but read one byte
+    size_t read_status(uint8_t reg) { return this->read_value(reg | CC1101_READ_BURST); }
+    size_t write_burst(uint8_t reg, const uint8_t *data, size_t len) {
+        size_t at = this->header(reg | CC1101_WRITE_BURST);
+        memcpy(&this->buffer_[this->length_], data, len);
+        this->length_ += len;
+        return at;
+    }
+    size_t read_burst(uint8_t reg, size_t len) {
+        this->header(reg | CC1101_READ_BURST);
+        size_t at = this->length_;
+        memset(&this->buffer_[at], 0, len);
+        this->length_ += len;
+        return at;
+    }
+
+    uint8_t operator[](size_t offset) const { return this->buffer_[offset]; }
+    const uint8_t *data(size_t offset) const { return &this->buffer_[offset]; }
+    // Status byte clocked back with the last header
+    uint8_t status() const { return this->buffer_[this->last_header_]; }
+    bool empty() const { return this->length_ == 0; }
+
+protected:
+    friend class CC1101Controller;
+
+    size_t header(uint8_t header) {
+        this->last_header_ = this->length_;
+        this->buffer_[this->length_++] = header;
+        return this->last_header_;
+    }
+    size_t read_value(uint8_t header) {
+        this->header(header);
+        this->buffer_[this->length_] = 0;
+        return this->length_++;
+    }
+
+    uint8_t buffer_[CC1101_BATCH_SIZE];
+    size_t length_{0};
+    size_t last_header_{0};
+};
+
+// Low-level CC1101 driver, the default radio backend
+class CC1101Controller : public spi::SPIDevice<spi::BIT_ORDER_MSB_FIRST,
+                                               spi::CLOCK_POLARITY_LOW,
+                                               spi::CLOCK_PHASE_LEADING,
+                                               spi::DATA_RATE_4MHZ> {
+public:
+    void set_gdo0_pin(InternalGPIOPin *pin) { this->gdo0_pin_ = pin; }
+    void set_gdo2_pin(InternalGPIOPin *pin) { this->gdo2_pin_ = pin; }
+    void set_cs_pin(GPIOPin *cs_pin) { this->cs_ = cs_pin; }
+    void set_rx_interrupt(bool rx_interrupt) { this->rx_interrupt_ = rx_interrupt; }
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    // Task notified from the GDO0/GDO2 interrupts, so it can sleep between edges
+    void set_wake_task(TaskHandle_t task) { this->wake_task_ = task; }
+#endif
+    bool init();
+    void dump_config();
+
+    // Mode changes only issue the strobe. Poll get_state() to see the chip
+    // arrive in the target state instead of waiting a fixed time.
+    void set_mode_idle();
+    void set_mode_receive();
+    void set_mode_transmit();
+    // Duty-cycled listening: the chip sleeps and sniffs for a sync word every
+    // Event0. Only GDO0 wakes the host, so this needs rx_interrupt.
+    void set_wake_on_radio(uint16_t event0, uint8_t rx_time) {
+        this->wor_event0_ = event0;
+        this->wor_rx_time_ = rx_time;
+    }
+    void set_mode_wor();
+    RadioState get_state();
+
+    // On-air time of one frame (preamble, sync word, payload, CRC) and of one
+    // bit at the configured data rate
+    uint32_t get_frame_airtime_us() const { return this->frame_airtime_us_; }
+    uint32_t get_bit_time_us() const { return this->bit_time_us_; }
+    uint32_t get_cca_settle_us() const { return CC1101_CCA_SETTLE_US; }
+
+    // Synthesizer calibration. start_calibration() strobes SCAL; once
+    // poll_calibration() returns true the FSCAL1-3 results are cached and
+    // FS_AUTOCAL is turned off, so IDLE->RX/TX no longer recalibrates.
+    void start_calibration();
+    bool poll_calibration();
+    void restore_calibration(const FanCalibrationRecord &calibration);
+    bool is_calibrated() const { return this->calibration_.valid; }
+    const FanCalibrationRecord &get_calibration() const { return this->calibration_; }
+    // Hash of the frequency and modem registers; stored FSCAL values are only
+    // valid for the configuration they were calibrated with
+    uint32_t get_config_hash() const;
+    uint8_t get_tx_bytes();
+
+    // True if CCA held back the STX: the chip is in RX with the frame still in
+    // the TX FIFO and no end-of-packet edge came since. TXOFF_MODE=RX also
+    // ends in RX, after the frame went out.
+    bool is_tx_deferred();
+    // True once the frame started by set_mode_transmit() has left the air.
+    // end_us receives the end-of-packet time, taken from the GDO2 edge when
+    // that pin is wired.
+    bool poll_tx_done(uint32_t &end_us);
+
+    void set_tx_address(uint32_t address);
+    void set_rx_address(uint32_t address);
+
+    void write_tx_payload(const uint8_t *payload, size_t size);
+
+    // Moves all complete frames from the RX FIFO into the frame ring, oldest
+    // first. In interrupt mode this only touches SPI after GDO0 signalled a
+    // packet, in polling mode a one-byte status read screens out the empty
+    // FIFO. The FIFO is only flushed on overflow or a stray partial frame.
+    // Returns true if the FIFO was read.
+    bool service_rx();
+    bool pop_rx_frame(RxFrame &frame) { return this->rx_frames_.pop(frame); }
+    void clear_rx_frames() { this->rx_frames_.clear(); }
+
+    // Shadowed configuration register access. set_register() only stages a
+    // changed value; commit_registers() queues all staged values as single
+    // writes, which share the CS assertion of the SRX/STX strobe that follows.
+    void set_register(uint8_t reg, uint8_t value);
+    void commit_registers(CC1101Batch &batch);
+    uint8_t get_register(uint8_t reg);
+
+    bool is_data_ready() { return this->gdo0_pin_->digital_read(); }
+    bool is_rx_interrupt() const { return this->rx_interrupt_; }
+
+    const SpiStats &get_spi_stats() const { return this->spi_stats_; }
+    const LinkQuality &get_link_quality() const { return this->link_quality_; }
+    uint32_t get_crc_errors() const { return this->crc_errors_; }
+    uint32_t get_rx_overflows() const { return this->rx_overflows_; }
+
+private:
+    static void gdo0_isr(CC1101Controller *arg);
+    static void gdo2_isr(CC1101Controller *arg);
+    static void wake_task_from_isr(CC1101Controller *arg);
+    CC1101State read_chip_state();
+    uint8_t read_rx_bytes(uint8_t &status);
+    void read_rx_frames(RxFrame *frames, uint8_t count);
+    void accept_rx_frame(const RxFrame &frame);
+
+    void reset();
+    void wake();
+    void begin_transaction();
+    void end_transaction(size_t bytes);
+    void execute(CC1101Batch &batch);  // Sends the batch in one CS assertion
+    uint8_t read_register(uint8_t reg);
+    void write_burst_register(uint8_t reg, const uint8_t *buffer, size_t len);
+    uint8_t send_strobe(uint8_t strobe);  // Returns the chip status byte
+    void flush_rx();
+    void flush_tx();
+    void configure_868mhz();
+    void update_airtime();
+    void set_address(uint32_t address);  // Helper for setting address register
+
+    InternalGPIOPin *gdo0_pin_{nullptr};
+    InternalGPIOPin *gdo2_pin_{nullptr};
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    volatile TaskHandle_t wake_task_{nullptr};
+#endif
+
+    bool rx_interrupt_{true};
+    std::atomic<uint32_t> rx_edges_{0};      // Packet-received edges counted by the ISR
+    uint32_t rx_edges_handled_{0};
+    volatile uint32_t rx_edge_time_us_{0};   // micros() of the latest edge
+    RingBuffer<RxFrame, FAN_RX_RING_SIZE> rx_frames_;
+    LinkQuality link_quality_;
+    uint32_t crc_errors_{0};
+    uint32_t rx_overflows_{0};
+
+    std::atomic<uint32_t> tx_edges_{0};      // End-of-packet edges on GDO2
+    uint32_t tx_edges_at_start_{0};
+    volatile uint32_t tx_edge_time_us_{0};
+
+    SpiStats spi_stats_;
+    uint32_t transaction_start_us_{0};
+
+    FanCalibrationRecord calibration_{};
+    uint32_t frame_airtime_us_{0};
+    uint32_t bit_time_us_{0};
+
+    uint16_t wor_event0_{0};
+    uint8_t wor_rx_time_{0};
+    bool wor_active_{false};  // Chip may be in SLEEP and must be woken before the next strobe
+
+    uint8_t shadow_regs_[CC1101_CONFIG_REG_COUNT]{};
+    uint64_t shadow_valid_{0};  // Bit per register: shadow value matches or will match the chip
+    uint64_t shadow_dirty_{0};  // Bit per register: staged but not yet written
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
+
+#endif  // USE_ZEHNDER_FAN_CC1101
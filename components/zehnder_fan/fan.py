@@ -1,49 +1,101 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import fan, spi
-from esphome.const import CONF_ID
-from esphome import pins
+import esphome.final_validate as fv
+from esphome import automation
+from esphome.components import fan
+from esphome.const import CONF_ID, CONF_NAME, CONF_PLATFORM, CONF_TRIGGER_ID
+from esphome.helpers import sanitize, snake_case
 
-DEPENDENCIES = ["spi"]
+from . import CONF_ZEHNDER_FAN_ID, ZehnderRadio, zehnder_fan_ns
 
-# Define custom pin constants for CC1101
-CONF_GDO0_PIN = "gdo0_pin"
-CONF_GDO2_PIN = "gdo2_pin"
-CONF_CS_PIN = "cs_pin"
+DEPENDENCIES = ["zehnder_fan"]
 
-zehnder_fan_ns = cg.esphome_ns.namespace("zehnder_fan")
 ZehnderFanComponent = zehnder_fan_ns.class_("ZehnderFanComponent", fan.Fan, cg.PollingComponent)
+CommandAckedTrigger = zehnder_fan_ns.class_(
+    "CommandAckedTrigger", automation.Trigger.template(cg.uint8, cg.uint32)
+)
+CommandFailedTrigger = zehnder_fan_ns.class_(
+    "CommandFailedTrigger", automation.Trigger.template(cg.std_string, cg.uint8, cg.uint32)
+)
+PairedTrigger = zehnder_fan_ns.class_("PairedTrigger", automation.Trigger.template(cg.uint32, cg.uint8))
+
+# Must match FAN_MAX_UNITS in zehnder_fan.h
+FAN_MAX_UNITS = 4
+
+CONF_MIN_STATUS_INTERVAL = "min_status_interval"
+CONF_MAX_STATUS_INTERVAL = "max_status_interval"
+CONF_ON_COMMAND_ACKED = "on_command_acked"
+CONF_ON_COMMAND_FAILED = "on_command_failed"
+CONF_ON_PAIRED = "on_paired"
+
+def validate_status_interval(config):
+    if config[CONF_MIN_STATUS_INTERVAL] > config[CONF_MAX_STATUS_INTERVAL]:
+        raise cv.Invalid(f"{CONF_MIN_STATUS_INTERVAL} must not exceed {CONF_MAX_STATUS_INTERVAL}")
+    return config
 
-CONFIG_SCHEMA = (
+# update_interval only sets how often the status query timer is checked; the
+# query itself adapts between the min and max status interval
+CONFIG_SCHEMA = cv.All(
     fan.fan_schema(ZehnderFanComponent)
     .extend(
         {
             cv.GenerateID(): cv.declare_id(ZehnderFanComponent),
-            cv.Required(CONF_CS_PIN): pins.gpio_output_pin_schema,
-            cv.Required(CONF_GDO0_PIN): pins.gpio_input_pin_schema,
-            cv.Optional(CONF_GDO2_PIN): pins.gpio_input_pin_schema,
-            cv.Required(spi.CONF_SPI_ID): cv.use_id(spi.SPIComponent),
+            cv.GenerateID(CONF_ZEHNDER_FAN_ID): cv.use_id(ZehnderRadio),
+            cv.Optional(CONF_MIN_STATUS_INTERVAL, default="5s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_MAX_STATUS_INTERVAL, default="15min"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_ON_COMMAND_ACKED): automation.validate_automation(
+                {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(CommandAckedTrigger)}
+            ),
+            cv.Optional(CONF_ON_COMMAND_FAILED): automation.validate_automation(
+                {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(CommandFailedTrigger)}
+            ),
+            cv.Optional(CONF_ON_PAIRED): automation.validate_automation(
+                {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(PairedTrigger)}
+            ),
         }
     )
-    .extend(cv.polling_component_schema("1s"))
+    .extend(cv.polling_component_schema("1s")),
+    validate_status_interval,
 )
 
+def final_validate(config):
+    # The stored pairing of each fan is keyed on its object id
+    radio_id = config[CONF_ZEHNDER_FAN_ID].id
+    fans = [
+        conf
+        for conf in fv.full_config.get()["fan"]
+        if conf[CONF_PLATFORM] == "zehnder_fan" and conf[CONF_ZEHNDER_FAN_ID].id == radio_id
+    ]
+    if len(fans) > FAN_MAX_UNITS:
+        raise cv.Invalid(f"A zehnder_fan radio serves at most {FAN_MAX_UNITS} fans")
+    object_ids = [sanitize(snake_case(str(conf[CONF_NAME]))) for conf in fans]
+    if object_ids.count(sanitize(snake_case(str(config[CONF_NAME])))) > 1:
+        raise cv.Invalid("Fans on the same zehnder_fan radio need unique names, their pairing is stored by name")
+    return config
+
+FINAL_VALIDATE_SCHEMA = final_validate
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     await fan.register_fan(var, config)
 
-    # Set SPI parent
-    spi_parent = await cg.get_variable(config[spi.CONF_SPI_ID])
-    cg.add(var.set_spi_parent(spi_parent))
-
-    # Register CC1101 pins
-    cs_pin = await cg.gpio_pin_expression(config[CONF_CS_PIN])
-    cg.add(var.set_cs_pin(cs_pin))
-    
-    gdo0_pin = await cg.gpio_pin_expression(config[CONF_GDO0_PIN])
-    cg.add(var.set_gdo0_pin(gdo0_pin))
-    
-    if CONF_GDO2_PIN in config:
-        gdo2_pin = await cg.gpio_pin_expression(config[CONF_GDO2_PIN])
-        cg.add(var.set_gdo2_pin(gdo2_pin))
+    # Attach to the shared radio
+    parent = await cg.get_variable(config[CONF_ZEHNDER_FAN_ID])
+    cg.add(var.set_parent(parent))
+    cg.add(parent.register_unit(var))
+    cg.add(
+        var.set_status_interval(config[CONF_MIN_STATUS_INTERVAL], config[CONF_MAX_STATUS_INTERVAL])
+    )
+
+    for conf in config.get(CONF_ON_COMMAND_ACKED, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.uint8, "retries"), (cg.uint32, "elapsed_ms")], conf)
+    for conf in config.get(CONF_ON_COMMAND_FAILED, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(
+            trigger, [(cg.std_string, "reason"), (cg.uint8, "retries"), (cg.uint32, "elapsed_ms")], conf
+        )
+    for conf in config.get(CONF_ON_PAIRED, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.uint32, "network_id"), (cg.uint8, "main_unit_id")], conf)
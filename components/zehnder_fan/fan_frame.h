@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace zehnder_fan {
+
+// Zehnder/BUVA on-air frame layout. Frames have a fixed size and are built
+// and parsed in place, so no copies are made between the FIFO buffers and
+// the protocol code.
+static const uint8_t FAN_FRAMESIZE = 16;
+static const uint8_t FAN_FRAME_TTL = 0xFA;
+static const uint32_t NETWORK_LINK_ID = 0xA55A5AA5;
+
+// Fan device types and commands
+enum {
+    FAN_TYPE_BROADCAST = 0x00,
+    FAN_TYPE_MAIN_UNIT = 0x01,
+    FAN_TYPE_REMOTE_CONTROL = 0x03,
+    FAN_TYPE_DISCOVERY = 0x04,  // Destination type of the pairing discovery frame
+};
+enum {
+    FAN_FRAME_SETSPEED = 0x02,
+    FAN_FRAME_SETTIMER = 0x03,
+    FAN_NETWORK_JOIN_REQUEST = 0x04,
+    FAN_FRAME_SETSPEED_REPLY = 0x05,
+    FAN_NETWORK_JOIN_OPEN = 0x06,
+    FAN_TYPE_FAN_SETTINGS = 0x07,  // Current settings, sent by the main unit in reply to a query
+    FAN_FRAME_0B = 0x0B,
+    FAN_NETWORK_JOIN_ACK = 0x0C,
+    FAN_TYPE_QUERY_DEVICE = 0x10,
+};
+// Parameters of FAN_TYPE_FAN_SETTINGS
+enum {
+    FAN_SETTINGS_SPEED = 0,
+    FAN_SETTINGS_VOLTAGE = 1,
+    FAN_SETTINGS_TIMER = 2,
+};
+enum {
+    FAN_SPEED_AUTO = 0x00,
+    FAN_SPEED_LOW = 0x01,
+    FAN_SPEED_MEDIUM = 0x02,
+    FAN_SPEED_HIGH = 0x03,
+    FAN_SPEED_MAX = 0x04,
+};
+
+// Byte offsets within a frame
+enum FrameField : uint8_t {
+    FRAME_DEST_TYPE = 0,
+    FRAME_DEST_ID = 1,
+    FRAME_SRC_TYPE = 2,
+    FRAME_SRC_ID = 3,
+    FRAME_TTL = 4,
+    FRAME_COMMAND = 5,
+    FRAME_PARAM_COUNT = 6,
+    FRAME_PARAMS = 7,
+};
+static const uint8_t FAN_FRAME_MAX_PARAMS = FAN_FRAMESIZE - FRAME_PARAMS;
+
+// Read-only typed view on a received frame. Does not own the bytes.
+class FrameView {
+public:
+    constexpr explicit FrameView(const uint8_t *data) : data_(data) {}
+
+    constexpr uint8_t dest_type() const { return data_[FRAME_DEST_TYPE]; }
+    constexpr uint8_t dest_id() const { return data_[FRAME_DEST_ID]; }
+    constexpr uint8_t src_type() const { return data_[FRAME_SRC_TYPE]; }
+    constexpr uint8_t src_id() const { return data_[FRAME_SRC_ID]; }
+    constexpr uint8_t ttl() const { return data_[FRAME_TTL]; }
+    constexpr uint8_t command() const { return data_[FRAME_COMMAND]; }
+    constexpr uint8_t param_count() const { return data_[FRAME_PARAM_COUNT]; }
+
+    // Parameter accessors are bounded by the frame size, not by param_count(),
+    // because some frames carry parameters without announcing them
+    constexpr uint8_t param(uint8_t index) const {
+        return index < FAN_FRAME_MAX_PARAMS ? data_[FRAME_PARAMS + index] : 0;
+    }
+    constexpr uint32_t param_u32le(uint8_t index) const {
+        return static_cast<uint32_t>(param(index)) | (static_cast<uint32_t>(param(index + 1)) << 8) |
+               (static_cast<uint32_t>(param(index + 2)) << 16) | (static_cast<uint32_t>(param(index + 3)) << 24);
+    }
+
+    constexpr bool is_from(uint8_t type, uint8_t id) const { return src_type() == type && src_id() == id; }
+    constexpr bool is_to(uint8_t type, uint8_t id) const { return dest_type() == type && dest_id() == id; }
+
+    // Rejects frames announcing more parameters than fit in a frame
+    constexpr bool is_valid() const { return param_count() <= FAN_FRAME_MAX_PARAMS; }
+
+    constexpr const uint8_t *data() const { return data_; }
+
+protected:
+    const uint8_t *data_;
+};
+
+// Writes a frame directly into a caller-owned buffer, e.g. the TX payload
+// that is handed to the radio FIFO as-is
+class FrameBuilder {
+public:
+    constexpr explicit FrameBuilder(uint8_t *data) : data_(data) {
+        for (uint8_t i = 0; i < FAN_FRAMESIZE; i++) {
+            data_[i] = 0;
+        }
+        data_[FRAME_TTL] = FAN_FRAME_TTL;
+    }
+
+    constexpr FrameBuilder &dest(uint8_t type, uint8_t id) {
+        data_[FRAME_DEST_TYPE] = type;
+        data_[FRAME_DEST_ID] = id;
+        return *this;
+    }
+    constexpr FrameBuilder &src(uint8_t type, uint8_t id) {
+        data_[FRAME_SRC_TYPE] = type;
+        data_[FRAME_SRC_ID] = id;
+        return *this;
+    }
+    constexpr FrameBuilder &command(uint8_t command) {
+        data_[FRAME_COMMAND] = command;
+        return *this;
+    }
+    constexpr FrameBuilder &param_count(uint8_t count) {
+        data_[FRAME_PARAM_COUNT] = count;
+        return *this;
+    }
+    constexpr FrameBuilder &param(uint8_t index, uint8_t value) {
+        if (index < FAN_FRAME_MAX_PARAMS) {
+            data_[FRAME_PARAMS + index] = value;
+        }
+        return *this;
+    }
+    constexpr FrameBuilder &param_u32le(uint8_t index, uint32_t value) {
+        param(index, value & 0xFF);
+        param(index + 1, (value >> 8) & 0xFF);
+        param(index + 2, (value >> 16) & 0xFF);
+        return param(index + 3, (value >> 24) & 0xFF);
+    }
+
+private:
+    uint8_t *data_;
+};
+
+// Frames sent by this remote. Each one fills a complete FAN_FRAMESIZE buffer.
+
+constexpr void build_set_speed_frame(uint8_t *frame, uint8_t main_unit_id, uint8_t my_device_id, uint8_t speed,
+                                     uint8_t timer_minutes) {
+    FrameBuilder(frame)
+        .dest(FAN_TYPE_MAIN_UNIT, main_unit_id)
+        .src(FAN_TYPE_REMOTE_CONTROL, my_device_id)
+        .command(timer_minutes > 0 ? FAN_FRAME_SETTIMER : FAN_FRAME_SETSPEED)
+        .param_count(timer_minutes > 0 ? 2 : 1)
+        .param(0, speed)
+        .param(1, timer_minutes);
+}
+
+constexpr void build_query_device_frame(uint8_t *frame, uint8_t main_unit_id, uint8_t my_device_id) {
+    FrameBuilder(frame)
+        .dest(FAN_TYPE_MAIN_UNIT, main_unit_id)
+        .src(FAN_TYPE_REMOTE_CONTROL, my_device_id)
+        .command(FAN_TYPE_QUERY_DEVICE);
+}
+
+constexpr void build_discover_frame(uint8_t *frame, uint8_t my_device_id) {
+    FrameBuilder(frame)
+        .dest(FAN_TYPE_DISCOVERY, 0x00)
+        .src(FAN_TYPE_REMOTE_CONTROL, my_device_id)
+        .command(FAN_NETWORK_JOIN_ACK)
+        .param_count(4)
+        .param_u32le(0, NETWORK_LINK_ID);
+}
+
+// The join request carries the network id without announcing a parameter
+// count; the main units expect it exactly like this
+constexpr void build_join_request_frame(uint8_t *frame, uint8_t main_unit_id, uint8_t my_device_id,
+                                        uint32_t network_id) {
+    FrameBuilder(frame)
+        .dest(FAN_TYPE_MAIN_UNIT, main_unit_id)
+        .src(FAN_TYPE_REMOTE_CONTROL, my_device_id)
+        .command(FAN_NETWORK_JOIN_REQUEST)
+        .param_u32le(0, network_id);
+}
+
+constexpr void build_join_ack_frame(uint8_t *frame, uint8_t main_unit_id, uint8_t my_device_id) {
+    FrameBuilder(frame)
+        .dest(FAN_TYPE_MAIN_UNIT, main_unit_id)
+        .src(FAN_TYPE_REMOTE_CONTROL, my_device_id)
+        .command(FAN_FRAME_0B);
+}
+
+// Builders and views are constexpr, so the wire format is checked at compile time
+constexpr bool discover_frame_round_trips() {
+    uint8_t frame[FAN_FRAMESIZE]{};
+    build_discover_frame(frame, 0x5C);
+    FrameView view(frame);
+    return view.is_to(FAN_TYPE_DISCOVERY, 0x00) && view.is_from(FAN_TYPE_REMOTE_CONTROL, 0x5C) &&
+           view.ttl() == FAN_FRAME_TTL && view.command() == FAN_NETWORK_JOIN_ACK && view.param_count() == 4 &&
+           frame[FRAME_PARAMS] == 0xA5 && frame[FRAME_PARAMS + 1] == 0x5A && view.param_u32le(0) == NETWORK_LINK_ID;
+}
+static_assert(discover_frame_round_trips(), "Discovery frame layout changed");
+
+} // namespace zehnder_fan
+} // namespace esphome
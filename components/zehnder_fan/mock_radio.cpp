@@ -0,0 +1,109 @@
+#include "mock_radio.h"
+
+#ifdef USE_ZEHNDER_FAN_MOCK
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include <cinttypes>
+#include <cstring>
+
+namespace esphome {
+namespace zehnder_fan {
+
+static const char *const TAG = "zehnder_fan";
+
+void MockRadio::dump_config() {
+    ESP_LOGCONFIG(TAG, "  Radio: mock (simulated main unit 0x%02X on network 0x%08" PRIX32 ")", MOCK_MAIN_UNIT_ID,
+                  MOCK_NETWORK_ID);
+    ESP_LOGCONFIG(TAG, "  Reply Delay: %" PRIu32 " ms", this->reply_delay_ms_);
+    ESP_LOGCONFIG(TAG, "  Reply Loss: %u%%", this->reply_loss_);
+}
+
+void MockRadio::write_tx_payload(const uint8_t *payload, size_t size) {
+    memcpy(this->tx_payload_, payload, size < FAN_FRAMESIZE ? size : FAN_FRAMESIZE);
+}
+
+void MockRadio::set_mode_transmit() {
+    this->tx_start_us_ = micros();
+    this->state_ = RadioState::TX;
+}
+
+bool MockRadio::poll_tx_done(uint32_t &end_us) {
+    if (this->state_ != RadioState::TX || micros() - this->tx_start_us_ < MOCK_FRAME_AIRTIME_US) {
+        return false;
+    }
+    end_us = micros();
+    this->state_ = RadioState::RX;
+
+    if (this->build_reply(this->reply_.data)) {
+        if (random_uint32() % 100 < this->reply_loss_) {
+            ESP_LOGV(TAG, "Mock main unit drops reply");
+        } else {
+            this->reply_pending_ = true;
+            this->reply_due_ = millis() + this->reply_delay_ms_;
+        }
+    }
+    return true;
+}
+
+bool MockRadio::build_reply(uint8_t *reply) {
+    FrameView sent(this->tx_payload_);
+    FrameBuilder builder(reply);
+    builder.src(FAN_TYPE_MAIN_UNIT, MOCK_MAIN_UNIT_ID).dest(sent.src_type(), sent.src_id());
+
+    if (this->tx_address_ == NETWORK_LINK_ID) {
+        // Pairing discovery: open the network to the new remote
+        if (!sent.is_to(FAN_TYPE_DISCOVERY, 0x00)) {
+            return false;
+        }
+        builder.command(FAN_NETWORK_JOIN_OPEN).param_count(4).param_u32le(0, MOCK_NETWORK_ID);
+        return true;
+    }
+    if (this->tx_address_ != MOCK_NETWORK_ID || !sent.is_to(FAN_TYPE_MAIN_UNIT, MOCK_MAIN_UNIT_ID)) {
+        return false;
+    }
+
+    switch (sent.command()) {
+        case FAN_FRAME_SETSPEED:
+        case FAN_FRAME_SETTIMER:
+            this->speed_ = sent.param(0);
+            this->timer_minutes_ = sent.command() == FAN_FRAME_SETTIMER ? sent.param(1) : 0;
+            builder.command(FAN_FRAME_SETSPEED_REPLY).param_count(1).param(0, this->speed_);
+            return true;
+        case FAN_TYPE_QUERY_DEVICE:
+            builder.command(FAN_TYPE_FAN_SETTINGS)
+                .param_count(3)
+                .param(FAN_SETTINGS_SPEED, this->speed_)
+                .param(FAN_SETTINGS_VOLTAGE, this->speed_ * 25)
+                .param(FAN_SETTINGS_TIMER, this->timer_minutes_);
+            return true;
+        case FAN_NETWORK_JOIN_REQUEST:
+            builder.command(FAN_NETWORK_JOIN_ACK).param_count(4).param_u32le(0, MOCK_NETWORK_ID);
+            return true;
+        case FAN_FRAME_0B:
+            builder.command(FAN_FRAME_0B);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool MockRadio::service_rx() {
+    if (!this->reply_pending_ || this->state_ != RadioState::RX || (int32_t) (millis() - this->reply_due_) < 0) {
+        return false;
+    }
+    this->reply_pending_ = false;
+    this->reply_.status[0] = MOCK_RSSI_RAW;
+    this->reply_.status[1] = CC1101_LQI_CRC_OK | MOCK_LQI;
+    this->reply_.timestamp_us = micros();
+    this->link_quality_.add(this->reply_);
+    this->rx_frames_.push(this->reply_);
+    return true;
+}
+
+} // namespace zehnder_fan
+} // namespace esphome
+
+#endif  // USE_ZEHNDER_FAN_MOCK
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_ZEHNDER_FAN_MOCK
+
+#include "radio.h"
+#include "ring_buffer.h"
+
+namespace esphome {
+namespace zehnder_fan {
+
+// The simulated main unit
+static const uint32_t MOCK_NETWORK_ID = 0x4D4F434B;
+static const uint8_t MOCK_MAIN_UNIT_ID = 0x4D;
+static const uint32_t MOCK_FRAME_AIRTIME_US = 4000;
+static const uint32_t MOCK_BIT_TIME_US = 20;
+static const uint32_t MOCK_CCA_SETTLE_US = 500;
+static const uint8_t MOCK_RSSI_RAW = 20;  // -64 dBm in the CC1101 status byte format
+static const uint8_t MOCK_LQI = 10;
+
+// Radio without hardware: every transmitted frame is answered by a simulated
+// main unit after reply_delay, as a real one would, except for the share set
+// by reply_loss. Runs the complete protocol, pairing included, on a bare
+// board.
+class MockRadio {
+public:
+    void set_reply_delay(uint32_t delay_ms) { this->reply_delay_ms_ = delay_ms; }
+    void set_reply_loss(uint8_t percent) { this->reply_loss_ = percent; }
+    bool init() { return true; }
+    void dump_config();
+
+    void set_mode_idle() { this->state_ = RadioState::IDLE; }
+    void set_mode_receive() { this->state_ = RadioState::RX; }
+    void set_mode_transmit();
+    void set_mode_wor() { this->set_mode_receive(); }
+    RadioState get_state() const { return this->state_; }
+
+    uint32_t get_frame_airtime_us() const { return MOCK_FRAME_AIRTIME_US; }
+    uint32_t get_bit_time_us() const { return MOCK_BIT_TIME_US; }
+    uint32_t get_cca_settle_us() const { return MOCK_CCA_SETTLE_US; }
+
+    void start_calibration() {}
+    bool poll_calibration() { return true; }
+    void restore_calibration(const FanCalibrationRecord &calibration) {}
+    bool is_calibrated() const { return true; }
+    const FanCalibrationRecord &get_calibration() const { return this->calibration_; }
+    uint32_t get_config_hash() const { return 0; }
+
+    // No carrier sense; the frame always goes out
+    bool is_tx_deferred() { return false; }
+    bool poll_tx_done(uint32_t &end_us);
+
+    void set_tx_address(uint32_t address) { this->tx_address_ = address; }
+    void set_rx_address(uint32_t address) {}
+
+    void write_tx_payload(const uint8_t *payload, size_t size);
+
+    // Delivers the simulated reply once it is due and the radio listens
+    bool service_rx();
+    bool pop_rx_frame(RxFrame &frame) { return this->rx_frames_.pop(frame); }
+    void clear_rx_frames() { this->rx_frames_.clear(); }
+
+    const SpiStats &get_spi_stats() const { return this->spi_stats_; }
+    const LinkQuality &get_link_quality() const { return this->link_quality_; }
+    uint32_t get_crc_errors() const { return 0; }
+
+private:
+    // Builds the main unit's answer to the frame just sent, false if it has none
+    bool build_reply(uint8_t *reply);
+
+    RadioState state_{RadioState::IDLE};
+    uint32_t tx_address_{0};
+    uint8_t tx_payload_[FAN_FRAMESIZE]{};
+    uint32_t tx_start_us_{0};
+
+    uint8_t speed_{FAN_SPEED_LOW};  // Settings of the simulated main unit
+    uint8_t timer_minutes_{0};
+
+    uint32_t reply_delay_ms_{50};
+    uint8_t reply_loss_{0};
+    bool reply_pending_{false};
+    uint32_t reply_due_{0};
+    RxFrame reply_{};
+
+    RingBuffer<RxFrame, FAN_RX_RING_SIZE> rx_frames_;
+    LinkQuality link_quality_;
+    SpiStats spi_stats_;
+    FanCalibrationRecord calibration_{};
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
+
+#endif  // USE_ZEHNDER_FAN_MOCK
@@ -0,0 +1,192 @@
+#include "nrf905_radio.h"
+
+#ifdef USE_ZEHNDER_FAN_NRF905
+
+#include "esphome/core/log.h"
+
+#include <cinttypes>
+
+namespace esphome {
+namespace zehnder_fan {
+
+static const char *const TAG = "zehnder_fan";
+
+// nRF905 868 MHz configuration for Zehnder protocol, written from byte 0
+static constexpr uint8_t nrf905_config_regs[] = {
+    0x75,  // CH_NO    - 868.2 MHz: (422.4 + 117 / 10) * 2
+    0x0E,  // HFREQ_PLL=1, PA_PWR=10 dBm, RX_RED_PWR=0, AUTO_RETRAN=0
+    0x44,  // RX_AFW/TX_AFW - 4 byte addresses
+    0x10,  // RX_PW    - 16 byte payload
+    0x10,  // TX_PW    - 16 byte payload
+    0x00,  // RX_ADDRESS, set per operation
+    0x00,
+    0x00,
+    0x00,
+    0xD8,  // CRC16 enabled, 16 MHz crystal, no clock output
+};
+static_assert(nrf905_config_regs[3] == FAN_FRAMESIZE, "RX_PW must match the Zehnder frame size");
+
+bool NRF905Controller::init() {
+    this->spi_setup();
+
+    this->trx_ce_pin_->setup();
+    this->trx_ce_pin_->digital_write(false);
+    this->tx_en_pin_->setup();
+    this->tx_en_pin_->digital_write(false);
+    this->pwr_up_pin_->setup();
+    this->dr_pin_->setup();
+    this->dr_pin_->pin_mode(gpio::FLAG_INPUT);
+    if (this->cd_pin_ != nullptr) {
+        this->cd_pin_->setup();
+        this->cd_pin_->pin_mode(gpio::FLAG_INPUT);
+    }
+
+    // Power down -> standby takes up to 3 ms
+    this->pwr_up_pin_->digital_write(true);
+    delay(3);
+
+    this->write_command(NRF905_W_CONFIG, nrf905_config_regs, sizeof(nrf905_config_regs));
+    this->state_ = RadioState::IDLE;
+
+    ESP_LOGD(TAG, "nRF905 initialized for 868 MHz operation.");
+    return true;
+}
+
+void NRF905Controller::dump_config() {
+    ESP_LOGCONFIG(TAG, "  Radio: nRF905");
+    LOG_PIN("  TRX_CE Pin: ", this->trx_ce_pin_);
+    LOG_PIN("  TX_EN Pin: ", this->tx_en_pin_);
+    LOG_PIN("  PWR_UP Pin: ", this->pwr_up_pin_);
+    LOG_PIN("  DR Pin: ", this->dr_pin_);
+    LOG_PIN("  CD Pin: ", this->cd_pin_);
+    ESP_LOGCONFIG(TAG, "  Frame Airtime: %" PRIu32 " us", this->get_frame_airtime_us());
+}
+
+void NRF905Controller::begin_transaction() {
+    this->transaction_start_us_ = micros();
+    this->enable();
+}
+
+void NRF905Controller::end_transaction(size_t bytes) {
+    this->disable();
+    this->spi_stats_.transactions++;
+    this->spi_stats_.bytes += bytes;
+    this->spi_stats_.blocked_us += micros() - this->transaction_start_us_;
+}
+
+void NRF905Controller::write_command(uint8_t command, const uint8_t *buffer, size_t len) {
+    this->begin_transaction();
+    this->write_byte(command);
+    this->write_array(buffer, len);
+    this->end_transaction(1 + len);
+}
+
+uint32_t NRF905Controller::get_frame_airtime_us() const {
+    uint32_t bits = NRF905_PREAMBLE_BITS + (NRF905_ADDRESS_BYTES + FAN_FRAMESIZE + NRF905_CRC_BYTES) * 8;
+    return NRF905_STANDBY_TO_ACTIVE_US + bits * 1000000 / NRF905_DATA_RATE;
+}
+
+void NRF905Controller::enter_standby() {
+    this->trx_ce_pin_->digital_write(false);
+    this->tx_en_pin_->digital_write(false);
+    this->state_ = RadioState::IDLE;
+}
+
+void NRF905Controller::commit_addresses() {
+    // Caller keeps the chip in standby, where the SPI registers are writable
+    if (this->tx_address_dirty_) {
+        const uint8_t address[NRF905_ADDRESS_BYTES] = {
+            (uint8_t) this->tx_address_, (uint8_t) (this->tx_address_ >> 8), (uint8_t) (this->tx_address_ >> 16),
+            (uint8_t) (this->tx_address_ >> 24)};
+        this->write_command(NRF905_W_TX_ADDRESS, address, sizeof(address));
+        this->tx_address_dirty_ = false;
+    }
+    if (this->rx_address_dirty_) {
+        const uint8_t address[NRF905_ADDRESS_BYTES] = {
+            (uint8_t) this->rx_address_, (uint8_t) (this->rx_address_ >> 8), (uint8_t) (this->rx_address_ >> 16),
+            (uint8_t) (this->rx_address_ >> 24)};
+        this->write_command(NRF905_W_CONFIG | NRF905_CONFIG_RX_ADDRESS, address, sizeof(address));
+        this->rx_address_dirty_ = false;
+    }
+}
+
+void NRF905Controller::set_tx_address(uint32_t address) {
+    if (address != this->tx_address_) {
+        this->tx_address_ = address;
+        this->tx_address_dirty_ = true;
+    }
+}
+
+void NRF905Controller::set_rx_address(uint32_t address) {
+    if (address != this->rx_address_) {
+        this->rx_address_ = address;
+        this->rx_address_dirty_ = true;
+    }
+}
+
+void NRF905Controller::set_mode_idle() {
+    this->enter_standby();
+}
+
+void NRF905Controller::set_mode_receive() {
+    this->enter_standby();
+    this->commit_addresses();
+    this->trx_ce_pin_->digital_write(true);
+    this->state_ = RadioState::RX;
+}
+
+void NRF905Controller::set_mode_transmit() {
+    // CD is only valid after the receiver has been listening for a while;
+    // the protocol lets it settle before asking for the transmission
+    if (this->cd_pin_ != nullptr && this->state_ == RadioState::RX && this->cd_pin_->digital_read()) {
+        return;
+    }
+
+    this->enter_standby();
+    this->commit_addresses();
+    // A short TRX_CE pulse sends the loaded payload once, then the chip
+    // returns to standby and raises DR
+    this->tx_en_pin_->digital_write(true);
+    this->trx_ce_pin_->digital_write(true);
+    delayMicroseconds(NRF905_TRX_CE_PULSE_US);
+    this->trx_ce_pin_->digital_write(false);
+    this->state_ = RadioState::TX;
+}
+
+bool NRF905Controller::poll_tx_done(uint32_t &end_us) {
+    if (this->state_ != RadioState::TX || !this->dr_pin_->digital_read()) {
+        return false;
+    }
+    end_us = micros();
+    this->set_mode_receive();
+    return true;
+}
+
+void NRF905Controller::write_tx_payload(const uint8_t *payload, size_t size) {
+    this->write_command(NRF905_W_TX_PAYLOAD, payload, size);
+}
+
+bool NRF905Controller::service_rx() {
+    if (this->state_ != RadioState::RX || !this->dr_pin_->digital_read()) {
+        return false;
+    }
+
+    // DR only rises for frames with a matching address and a valid CRC
+    RxFrame frame{};
+    frame.timestamp_us = micros();
+    frame.status[1] = CC1101_LQI_CRC_OK;
+    this->begin_transaction();
+    this->write_byte(NRF905_R_RX_PAYLOAD);
+    this->read_array(frame.data, FAN_FRAMESIZE);
+    this->end_transaction(1 + FAN_FRAMESIZE);
+
+    if (!this->rx_frames_.push(frame)) {
+        ESP_LOGW(TAG, "RX frame ring full, dropping frame");
+    }
+    return true;
+}
+
+} // namespace zehnder_fan
+} // namespace esphome
+
+#endif  // USE_ZEHNDER_FAN_NRF905
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_ZEHNDER_FAN_NRF905
+
+#include "esphome/core/hal.h"
+#include "esphome/components/spi/spi.h"
+#include "radio.h"
+#include "ring_buffer.h"
+
+namespace esphome {
+namespace zehnder_fan {
+
+// nRF905 SPI instructions
+static const uint8_t NRF905_W_CONFIG = 0x00;      // Low nibble: first configuration byte to write
+static const uint8_t NRF905_W_TX_PAYLOAD = 0x20;
+static const uint8_t NRF905_W_TX_ADDRESS = 0x22;
+static const uint8_t NRF905_R_RX_PAYLOAD = 0x24;
+
+static const uint8_t NRF905_CONFIG_RX_ADDRESS = 5;  // Offset of RX_ADDRESS in the configuration register
+static const uint8_t NRF905_ADDRESS_BYTES = 4;
+
+static const uint32_t NRF905_STANDBY_TO_ACTIVE_US = 650;  // TRX_CE/TX_EN to RX or TX
+static const uint32_t NRF905_CD_SETTLE_US = 700;          // CD is valid ~650 us after entering RX
+static_assert(NRF905_CD_SETTLE_US >= NRF905_STANDBY_TO_ACTIVE_US, "CD is not valid before RX has started");
+static const uint32_t NRF905_TRX_CE_PULSE_US = 10;        // Shortest TRX_CE pulse starting a ShockBurst TX
+static const uint32_t NRF905_DATA_RATE = 50000;           // 100 kchip/s Manchester coded
+static const uint8_t NRF905_PREAMBLE_BITS = 10;
+static const uint8_t NRF905_CRC_BYTES = 2;
+
+// Low-level nRF905 driver, as used by the original firmware. ShockBurst
+// handles preamble, address matching and CRC, so frames read from the chip
+// are always valid. The chip measures no RSSI, so link quality stays empty.
+// Carrier sense uses the optional CD pin.
+class NRF905Controller : public spi::SPIDevice<spi::BIT_ORDER_MSB_FIRST,
+                                               spi::CLOCK_POLARITY_LOW,
+                                               spi::CLOCK_PHASE_LEADING,
+                                               spi::DATA_RATE_4MHZ> {
+public:
+    void set_cs_pin(GPIOPin *cs_pin) { this->cs_ = cs_pin; }
+    void set_trx_ce_pin(GPIOPin *pin) { this->trx_ce_pin_ = pin; }
+    void set_tx_en_pin(GPIOPin *pin) { this->tx_en_pin_ = pin; }
+    void set_pwr_up_pin(GPIOPin *pin) { this->pwr_up_pin_ = pin; }
+    void set_dr_pin(GPIOPin *pin) { this->dr_pin_ = pin; }
+    void set_cd_pin(GPIOPin *pin) { this->cd_pin_ = pin; }
+    bool init();
+    void dump_config();
+
+    // Mode changes only drive TRX_CE/TX_EN; the state is tracked in software
+    void set_mode_idle();
+    void set_mode_receive();
+    // Stays in RX without sending when CD reports a carrier
+    void set_mode_transmit();
+    // No duty-cycled listening on this chip: plain RX
+    void set_mode_wor() { this->set_mode_receive(); }
+    RadioState get_state() const { return this->state_; }
+
+    uint32_t get_frame_airtime_us() const;
+    uint32_t get_bit_time_us() const { return 1000000 / NRF905_DATA_RATE; }
+    uint32_t get_cca_settle_us() const { return NRF905_CD_SETTLE_US; }
+
+    // The synthesizer calibrates itself on every standby->active transition
+    void start_calibration() {}
+    bool poll_calibration() { return true; }
+    void restore_calibration(const FanCalibrationRecord &calibration) {}
+    bool is_calibrated() const { return true; }
+    const FanCalibrationRecord &get_calibration() const { return this->calibration_; }
+    uint32_t get_config_hash() const { return 0; }
+
+    // set_mode_transmit() stays in RX when CD saw a carrier; only
+    // poll_tx_done() moves a sent frame's radio back to RX
+    bool is_tx_deferred() { return this->state_ == RadioState::RX; }
+    // True once DR signals the end of the ShockBurst transmission; the radio
+    // is then put into RX, as the CC1101 does with TXOFF_MODE=RX
+    bool poll_tx_done(uint32_t &end_us);
+
+    // Addresses are staged and written on the next standby->active transition,
+    // since the configuration can only be written in standby
+    void set_tx_address(uint32_t address);
+    void set_rx_address(uint32_t address);
+
+    void write_tx_payload(const uint8_t *payload, size_t size);
+
+    // Reads the payload when DR reports one. Returns true if a frame was read.
+    bool service_rx();
+    bool pop_rx_frame(RxFrame &frame) { return this->rx_frames_.pop(frame); }
+    void clear_rx_frames() { this->rx_frames_.clear(); }
+
+    const SpiStats &get_spi_stats() const { return this->spi_stats_; }
+    const LinkQuality &get_link_quality() const { return this->link_quality_; }
+    uint32_t get_crc_errors() const { return 0; }
+
+private:
+    void begin_transaction();
+    void end_transaction(size_t bytes);
+    void write_command(uint8_t command, const uint8_t *buffer, size_t len);
+    void enter_standby();
+    void commit_addresses();
+
+    GPIOPin *trx_ce_pin_{nullptr};
+    GPIOPin *tx_en_pin_{nullptr};
+    GPIOPin *pwr_up_pin_{nullptr};
+    GPIOPin *dr_pin_{nullptr};
+    GPIOPin *cd_pin_{nullptr};
+
+    RadioState state_{RadioState::IDLE};
+    uint32_t tx_address_{0};
+    uint32_t rx_address_{0};
+    bool tx_address_dirty_{false};
+    bool rx_address_dirty_{false};
+
+    RingBuffer<RxFrame, FAN_RX_RING_SIZE> rx_frames_;
+    LinkQuality link_quality_;
+    SpiStats spi_stats_;
+    uint32_t transaction_start_us_{0};
+    FanCalibrationRecord calibration_{};
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
+
+#endif  // USE_ZEHNDER_FAN_NRF905
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "fan_frame.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace zehnder_fan {
+
+// Radio backends. The protocol is a template over the radio type, and one
+// backend is compiled in, selected with `radio:` in YAML. A backend provides
+// these non-virtual methods:
+//
+//   bool init();
+//   void dump_config();
+//   void set_mode_idle(); void set_mode_receive(); void set_mode_transmit(); void set_mode_wor();
+//   RadioState get_state();
+//   void set_tx_address(uint32_t address); void set_rx_address(uint32_t address);
+//   void write_tx_payload(const uint8_t *payload, size_t size);  // Only called in IDLE
+//   bool is_tx_deferred();  // After set_mode_transmit(): carrier sense held the frame back
+//   bool poll_tx_done(uint32_t &end_us);
+//   bool service_rx(); bool pop_rx_frame(RxFrame &frame); void clear_rx_frames();
+//   void start_calibration(); bool poll_calibration(); void restore_calibration(const FanCalibrationRecord &);
+//   bool is_calibrated() const; const FanCalibrationRecord &get_calibration() const;
+//   uint32_t get_config_hash() const;  // Identifies the settings a calibration holds for
+//   uint32_t get_frame_airtime_us() const; uint32_t get_bit_time_us() const;
+//   uint32_t get_cca_settle_us() const;  // RX time before carrier sense reflects the channel
+//   const SpiStats &get_spi_stats() const; const LinkQuality &get_link_quality() const;
+//   uint32_t get_crc_errors() const;
+//
+// set_mode_transmit() is issued from RX, at least get_cca_settle_us() after
+// set_mode_receive(). A backend with carrier sense stays in RX when the
+// channel is busy and reports that through is_tx_deferred(); the protocol
+// then backs off and tries again. A radio that already sent the frame may be
+// back in RX as well, so the state alone does not tell the two apart.
+
+static const uint8_t FAN_RX_STATUS_BYTES = 2;  // RSSI + LQI/CRC_OK, in the layout the CC1101 appends
+static const uint8_t FAN_RX_FRAME_BYTES = FAN_FRAMESIZE + FAN_RX_STATUS_BYTES;
+static const size_t FAN_RX_RING_SIZE = 8;      // Received frames buffered between process() calls
+static const uint8_t FAN_LINK_QUALITY_WINDOW = 8;  // Frames in the RSSI/LQI rolling average
+
+// Appended status bytes, see the CC1101 datasheet section 10.18.4. Backends
+// without them fill in the same format.
+static const uint8_t CC1101_LQI_CRC_OK = 0x80;
+static const uint8_t CC1101_LQI_MASK = 0x7F;
+static const int8_t CC1101_RSSI_OFFSET = 74;  // dBm, typical at 868 MHz
+
+// Radio state as the protocol sees it
+enum class RadioState : uint8_t {
+    IDLE,
+    RX,
+    TX,
+    BUSY,  // Calibrating, settling or recovering; neither listening nor sending
+};
+
+// A received frame as it came out of the radio
+struct RxFrame {
+    uint8_t data[FAN_FRAMESIZE];
+    uint8_t status[FAN_RX_STATUS_BYTES];
+    uint32_t timestamp_us;  // micros() at the packet-received edge
+
+    FrameView view() const { return FrameView(data); }
+
+    bool crc_ok() const { return (status[1] & CC1101_LQI_CRC_OK) != 0; }
+    uint8_t lqi() const { return status[1] & CC1101_LQI_MASK; }
+    // RSSI is a two's complement value in 0.5 dB steps
+    float rssi_dbm() const { return (int8_t) status[0] / 2.0f - CC1101_RSSI_OFFSET; }
+};
+
+// Rolling average of RSSI and LQI over the last FAN_LINK_QUALITY_WINDOW good frames
+class LinkQuality {
+public:
+    void add(const RxFrame &frame);
+    float get_rssi_dbm() const;
+    float get_lqi() const;
+    // Total frames seen, so callers can tell whether a new sample arrived
+    uint32_t get_samples() const { return this->samples_; }
+
+private:
+    uint8_t count() const;
+
+    float rssi_dbm_[FAN_LINK_QUALITY_WINDOW]{};
+    uint8_t lqi_[FAN_LINK_QUALITY_WINDOW]{};
+    uint32_t samples_{0};
+};
+
+// Cumulative SPI cost of the radio driver, used to measure driver changes.
+// blocked_us covers time spent inside SPI transactions.
+struct SpiStats {
+    uint32_t transactions{0};
+    uint32_t bytes{0};
+    uint32_t blocked_us{0};
+
+    SpiStats operator-(const SpiStats &other) const {
+        return {transactions - other.transactions, bytes - other.bytes, blocked_us - other.blocked_us};
+    }
+};
+
+// Frequency synthesizer calibration learned by the radio
+struct FanCalibrationRecord {
+    uint8_t valid;
+    uint8_t fscal1;
+    uint8_t fscal2;
+    uint8_t fscal3;
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace zehnder_fan {
+
+// Fixed-size lock-free single-producer/single-consumer ring buffer.
+// One slot is kept free to tell "full" from "empty", so N slots hold N-1 items.
+// push() may only be called from the producer context, pop()/clear() only
+// from the consumer context.
+template<typename T, size_t N> class RingBuffer {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
+public:
+    bool push(const T &item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & (N - 1);
+        if (next == tail_.load(std::memory_order_acquire)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items_[tail];
+        tail_.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    // Discards everything currently queued (consumer side)
+    void clear() { tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release); }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    // Number of items rejected because the buffer was full
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    T items_[N];
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<uint32_t> dropped_{0};
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
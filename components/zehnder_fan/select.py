@@ -0,0 +1,34 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import select
+from esphome.const import ENTITY_CATEGORY_CONFIG
+
+from . import zehnder_fan_ns
+from .fan import ZehnderFanComponent
+
+DEPENDENCIES = ["zehnder_fan"]
+
+ZehnderPairingSelect = zehnder_fan_ns.class_("ZehnderPairingSelect", select.Select)
+
+CONF_FAN_ID = "fan_id"
+
+# Must match FAN_PAIRING_SELECT_NONE in zehnder_fan.cpp
+PAIRING_SELECT_NONE = "None"
+
+# Filled with the units the last pairing discovery found; without this select
+# pairing joins the strongest unit by itself
+CONFIG_SCHEMA = select.select_schema(
+    ZehnderPairingSelect,
+    icon="mdi:access-point-network",
+    entity_category=ENTITY_CATEGORY_CONFIG,
+).extend(
+    {
+        cv.GenerateID(CONF_FAN_ID): cv.use_id(ZehnderFanComponent),
+    }
+)
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_FAN_ID])
+    var = await select.new_select(config, options=[PAIRING_SELECT_NONE])
+    cg.add(var.set_parent(parent))
+    cg.add(parent.set_pairing_select(var))
@@ -0,0 +1,47 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    DEVICE_CLASS_SIGNAL_STRENGTH,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_DECIBEL_MILLIWATT,
+)
+
+from . import CONF_ZEHNDER_FAN_ID, ZehnderRadio
+
+DEPENDENCIES = ["zehnder_fan"]
+
+CONF_RSSI = "rssi"
+CONF_LQI = "lqi"
+
+# Both sensors report the rolling average over the last received frames
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_ZEHNDER_FAN_ID): cv.use_id(ZehnderRadio),
+        cv.Optional(CONF_RSSI): sensor.sensor_schema(
+            unit_of_measurement=UNIT_DECIBEL_MILLIWATT,
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_SIGNAL_STRENGTH,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_LQI): sensor.sensor_schema(
+            icon="mdi:signal",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_ZEHNDER_FAN_ID])
+
+    if CONF_RSSI in config:
+        sens = await sensor.new_sensor(config[CONF_RSSI])
+        cg.add(parent.set_rssi_sensor(sens))
+
+    if CONF_LQI in config:
+        sens = await sensor.new_sensor(config[CONF_LQI])
+        cg.add(parent.set_lqi_sensor(sens))
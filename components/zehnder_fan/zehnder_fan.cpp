@@ -4,497 +4,932 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
 namespace esphome {
 namespace zehnder_fan {
 
 static const char *const TAG = "zehnder_fan";
 static const char *const NVS_NAMESPACE = "zehnder_fan";
-static const char *const NVS_PAIRING_KEY = "pairing_info";
+static const char *const NVS_PAIRING_KEY = "pairing_info";  // Pairing blob of single-fan firmware
+static const uint8_t FAN_NO_SLOT = 0xFF;
 
 // =========================================================================
-// 1. CC1101Controller Implementation
+// Radio Helpers
 // =========================================================================
 
-// CC1101 868 MHz configuration for Zehnder protocol
-static const uint8_t cc1101_config_regs[] = {
-    0x0D,  // IOCFG2   - GDO2 output pin config
-    0x2E,  // IOCFG1   - GDO1 output pin config  
-    0x06,  // IOCFG0   - GDO0 output pin config (packet received)
-    0x47,  // FIFOTHR  - FIFO threshold
-    0xD3,  // SYNC1    - Sync word high byte
-    0x91,  // SYNC0    - Sync word low byte
-    0x10,  // PKTLEN   - Packet length (16 bytes for Zehnder)
-    0x04,  // PKTCTRL1 - Packet automation control
-    0x05,  // PKTCTRL0 - Packet automation control (fixed length)
-    0x00,  // ADDR     - Device address
-    0x00,  // CHANNR   - Channel number
-    0x06,  // FSCTRL1  - Frequency synthesizer control
-    0x00,  // FSCTRL0  - Frequency synthesizer control
-    0x21,  // FREQ2    - Frequency control word, high byte (868 MHz)
-    0x62,  // FREQ1    - Frequency control word, middle byte
-    0x76,  // FREQ0    - Frequency control word, low byte
-    0xF5,  // MDMCFG4  - Modem configuration (bandwidth)
-    0x83,  // MDMCFG3  - Modem configuration (data rate)
-    0x13,  // MDMCFG2  - Modem configuration (GFSK, 16/16 sync)
-    0x22,  // MDMCFG1  - Modem configuration
-    0xF8,  // MDMCFG0  - Modem configuration
-    0x15,  // DEVIATN  - Modem deviation setting
-    0x07,  // MCSM2    - Main Radio Control State Machine config
-    0x30,  // MCSM1    - Main Radio Control State Machine config
-    0x18,  // MCSM0    - Main Radio Control State Machine config
-    0x14,  // FOCCFG   - Frequency Offset Compensation config
-    0x6C,  // BSCFG    - Bit Synchronization config
-    0x07,  // AGCCTRL2 - AGC control
-    0x00,  // AGCCTRL1 - AGC control
-    0x92,  // AGCCTRL0 - AGC control
-    0x87,  // WOREVT1  - High byte Event0 timeout
-    0x6B,  // WOREVT0  - Low byte Event0 timeout
-    0xFB,  // WORCTRL  - Wake On Radio control
-    0x56,  // FREND1   - Front end RX configuration
-    0x10,  // FREND0   - Front end TX configuration
-    0xE9,  // FSCAL3   - Frequency synthesizer calibration
-    0x2A,  // FSCAL2   - Frequency synthesizer calibration
-    0x00,  // FSCAL1   - Frequency synthesizer calibration
-    0x1F,  // FSCAL0   - Frequency synthesizer calibration
-};
-
-void CC1101Controller::setup_pins(GPIOPin *gdo0_pin, GPIOPin *gdo2_pin) {
-    this->gdo0_pin_ = gdo0_pin;
-    this->gdo2_pin_ = gdo2_pin;
-}
-
-bool CC1101Controller::init() {
-    // Initialize SPI device
-    this->spi_setup();
-    
-    this->gdo0_pin_->setup();
-    this->gdo0_pin_->pin_mode(gpio::FLAG_INPUT);
-    
-    if (this->gdo2_pin_ != nullptr) {
-        this->gdo2_pin_->setup();
-        this->gdo2_pin_->pin_mode(gpio::FLAG_INPUT);
-    }
-
-    // Reset CC1101
-    this->reset();
-    delay(10);
-
-    // Configure for 868 MHz Zehnder operation
-    this->configure_868mhz();
-
-    ESP_LOGD(TAG, "CC1101 initialized for 868 MHz operation.");
-    return true;
-}
-
-void CC1101Controller::reset() {
-    // Reset via CS pin toggle
-    this->disable();
-    delayMicroseconds(5);
-    this->enable();
-    delayMicroseconds(10);
-    this->disable();
-    delayMicroseconds(41);
-    
-    // Send reset strobe
-    this->enable();
-    this->write_byte(CC1101_SRES);
-    this->disable();
-    delayMicroseconds(100);
-}
-
-void CC1101Controller::write_register(uint8_t reg, uint8_t value) {
-    this->enable();
-    this->write_byte(reg);
-    this->write_byte(value);
-    this->disable();
-}
-
-uint8_t CC1101Controller::read_register(uint8_t reg) {
-    this->enable();
-    this->write_byte(reg | CC1101_READ_SINGLE);
-    uint8_t value = this->read_byte();
-    this->disable();
-    return value;
+void LinkQuality::add(const RxFrame &frame) {
+    uint8_t slot = this->samples_ % FAN_LINK_QUALITY_WINDOW;
+    this->rssi_dbm_[slot] = frame.rssi_dbm();
+    this->lqi_[slot] = frame.lqi();
+    this->samples_++;
 }
 
-void CC1101Controller::write_burst_register(uint8_t reg, const uint8_t *buffer, size_t len) {
-    this->enable();
-    this->write_byte(reg | CC1101_WRITE_BURST);
-    this->write_array(buffer, len);
-    this->disable();
+uint8_t LinkQuality::count() const {
+    return this->samples_ < FAN_LINK_QUALITY_WINDOW ? this->samples_ : FAN_LINK_QUALITY_WINDOW;
 }
 
-void CC1101Controller::send_strobe(uint8_t strobe) {
-    this->enable();
-    this->write_byte(strobe);
-    this->disable();
-}
-
-void CC1101Controller::flush_rx() {
-    this->send_strobe(CC1101_SFRX);
+float LinkQuality::get_rssi_dbm() const {
+    uint8_t n = this->count();
+    if (n == 0) {
+        return NAN;
+    }
+    float sum = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        sum += this->rssi_dbm_[i];
+    }
+    return sum / n;
 }
 
-void CC1101Controller::flush_tx() {
-    this->send_strobe(CC1101_SFTX);
+float LinkQuality::get_lqi() const {
+    uint8_t n = this->count();
+    if (n == 0) {
+        return NAN;
+    }
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        sum += this->lqi_[i];
+    }
+    return (float) sum / n;
 }
 
-void CC1101Controller::configure_868mhz() {
-    // Write all configuration registers in burst mode starting at IOCFG2 (0x00)
-    this->write_burst_register(CC1101_IOCFG2, cc1101_config_regs, sizeof(cc1101_config_regs));
-    
-    // Set packet length to 16 bytes (Zehnder frame size)
-    this->write_register(0x06, FAN_FRAMESIZE);
-}
 
-void CC1101Controller::set_mode_idle() {
-    this->send_strobe(CC1101_SIDLE);
-    delayMicroseconds(100);
-}
+// =========================================================================
+// ZehnderFanProtocol Implementation
+// =========================================================================
 
-void CC1101Controller::set_mode_receive() {
-    this->send_strobe(CC1101_SRX);
-    delayMicroseconds(100);
+void RttEstimator::add_sample(uint32_t rtt_ms) {
+    if (this->samples_ == 0) {
+        // First measurement: srtt = R, rttvar = R / 2
+        this->srtt_x8_ = rtt_ms << 3;
+        this->rttvar_x4_ = rtt_ms << 1;
+    } else {
+        // srtt += (R - srtt) / 8, rttvar += (|R - srtt| - rttvar) / 4
+        int32_t delta = (int32_t) rtt_ms - (int32_t) (this->srtt_x8_ >> 3);
+        this->srtt_x8_ += delta;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        delta -= (int32_t) (this->rttvar_x4_ >> 2);
+        this->rttvar_x4_ += delta;
+    }
+    this->samples_++;
 }
 
-void CC1101Controller::set_mode_transmit() {
-    this->send_strobe(CC1101_STX);
-    delayMicroseconds(100);
+uint32_t RttEstimator::get_timeout_ms() const {
+    if (this->samples_ == 0) {
+        return FAN_REPLY_TIMEOUT_MS;
+    }
+    uint32_t timeout = (this->srtt_x8_ >> 3) + this->rttvar_x4_;
+    if (timeout < FAN_MIN_REPLY_TIMEOUT_MS) {
+        return FAN_MIN_REPLY_TIMEOUT_MS;
+    }
+    if (timeout > FAN_MAX_REPLY_TIMEOUT_MS) {
+        return FAN_MAX_REPLY_TIMEOUT_MS;
+    }
+    return timeout;
 }
 
-void CC1101Controller::set_address(uint32_t address) {
-    // CC1101 uses a single byte address for filtering (ADDR register at 0x09)
-    // The Zehnder protocol may use the full 32-bit address in the payload itself,
-    // but for hardware filtering we use the lowest byte
-    this->write_register(0x09, (address >> 0) & 0xFF);
+void OperationStats::record(bool success, uint32_t time_to_ack_ms, uint32_t frames, uint32_t airtime_us) {
+    this->operations_++;
+    this->frames_ += frames;
+    this->airtime_us_ += airtime_us;
+    if (success) {
+        this->time_to_ack_ms_[this->acked_ % FAN_STATS_WINDOW] = time_to_ack_ms;
+        this->acked_++;
+    }
 }
 
-void CC1101Controller::set_tx_address(uint32_t address) {
-    // For CC1101, TX and RX use the same address register
-    this->set_address(address);
+uint32_t OperationStats::get_time_to_ack_ms(uint8_t percentile) const {
+    uint8_t n = this->acked_ < FAN_STATS_WINDOW ? this->acked_ : FAN_STATS_WINDOW;
+    if (n == 0) {
+        return 0;
+    }
+    uint32_t sorted[FAN_STATS_WINDOW];
+    std::copy(this->time_to_ack_ms_, this->time_to_ack_ms_ + n, sorted);
+    uint8_t index = (n - 1) * percentile / 100;
+    std::nth_element(sorted, sorted + index, sorted + n);
+    return sorted[index];
 }
 
-void CC1101Controller::set_rx_address(uint32_t address) {
-    // For CC1101, TX and RX use the same address register
-    this->set_address(address);
+void OperationStats::log(const char *name) const {
+    if (this->operations_ == 0) {
+        return;
+    }
+    ESP_LOGCONFIG(TAG,
+                  "  %s: %" PRIu32 " operations, %" PRIu32 "%% acked, time to ack p50 %" PRIu32
+                  " ms / p99 %" PRIu32 " ms",
+                  name, this->operations_, this->acked_ * 100 / this->operations_, this->get_time_to_ack_ms(50),
+                  this->get_time_to_ack_ms(99));
+    ESP_LOGCONFIG(TAG,
+                  "    %" PRIu32 " frames, %" PRIu32 " ms airtime, %" PRIu32 " deferred by carrier sense, %" PRIu32
+                  " collided",
+                  this->frames_, (uint32_t) (this->airtime_us_ / 1000), this->deferrals_, this->collisions_);
 }
 
-void CC1101Controller::write_tx_payload(const uint8_t *payload, size_t size) {
-    // Go to idle first
-    this->set_mode_idle();
-    
-    // Flush TX FIFO
-    this->flush_tx();
-    
-    // Write payload to TX FIFO
-    this->enable();
-    this->write_byte(CC1101_TXFIFO | CC1101_WRITE_BURST);
-    this->write_array(payload, size);
-    this->disable();
+template<typename Radio> ZehnderFanProtocol<Radio>::ZehnderFanProtocol(Radio *radio) : radio_(radio) {
+    // Initialize all operation slots to idle state
+    for (auto &op : ops_) {
+        op.type = RadioOperationType::NONE;
+        op.state = RadioOperationState::IDLE;
+    }
 }
 
-bool CC1101Controller::read_rx_payload(uint8_t *buffer, size_t size) {
-    if (!this->is_data_ready()) {
-        return false;
-    }
-    
-    // Read RXBYTES status register (status registers need special access)
-    this->enable();
-    this->write_byte(CC1101_RXBYTES | CC1101_READ_BURST);
-    uint8_t rxbytes = this->read_byte();
-    this->disable();
-    
-    uint8_t num_rxbytes = rxbytes & 0x7F;
-    
-    if (num_rxbytes < size) {
-        return false;
+template<typename Radio>
+void ZehnderFanProtocol<Radio>::start_pairing(uint8_t unit, bool auto_join, FanCompletionCallback &&on_complete) {
+    PendingOperation &op = ops_[unit];
+    if (op.state != RadioOperationState::IDLE) {
+        ESP_LOGW(TAG, "Cannot start pairing: Radio operation already in progress");
+        return;
     }
     
-    // Read from RX FIFO
-    this->enable();
-    this->write_byte(CC1101_RXFIFO | CC1101_READ_BURST);
-    this->read_array(buffer, size);
-    this->disable();
+    ESP_LOGD(TAG, "Unit %u: Starting fan pairing discovery...", unit);
     
-    // Flush RX FIFO after reading
-    this->flush_rx();
+    // Initialize pairing operation
+    init_operation(op, RadioOperationType::PAIRING_DISCOVER, std::move(on_complete));
+    op.data.pairing.my_device_id = random_uint32() & 0xFE; // Avoid 0xFF
+    if (op.data.pairing.my_device_id == 0x00) 
+        op.data.pairing.my_device_id = 1;
+    op.data.pairing.auto_join = auto_join;
+    op.data.pairing.candidate_count = 0;
     
-    return true;
+    setup_pairing_discover(op);
 }
 
+template<typename Radio>
+void ZehnderFanProtocol<Radio>::start_pairing_join(uint8_t unit, const FanPairingInfo &candidate,
+                                                   FanCompletionCallback &&on_complete) {
+    PendingOperation &op = ops_[unit];
+    if (op.state != RadioOperationState::IDLE) {
+        ESP_LOGW(TAG, "Cannot start pairing: Radio operation already in progress");
+        return;
+    }
 
-// =========================================================================
-// 2. ZehnderFanProtocol Implementation
-// =========================================================================
+    ESP_LOGD(TAG, "Unit %u: Joining fan unit ID 0x%02X on network 0x%08" PRIX32 "...", unit, candidate.main_unit_id,
+             candidate.network_id);
+    init_operation(op, RadioOperationType::PAIRING_JOIN, std::move(on_complete));
+    op.max_retries = FAN_TX_RETRIES;
+    op.data.pairing.my_device_id = candidate.my_device_id;
+    op.data.pairing.current_info = candidate;
+    op.data.pairing.candidate_count = 0;
 
-ZehnderFanProtocol::ZehnderFanProtocol(CC1101Controller *radio) : radio_(radio) {
-    // Initialize pending operation to idle state
-    pending_op_.type = RadioOperationType::NONE;
-    pending_op_.state = RadioOperationState::IDLE;
+    setup_pairing_join(op);
 }
 
-void ZehnderFanProtocol::start_pairing() {
-    if (pending_op_.state != RadioOperationState::IDLE) {
-        ESP_LOGW(TAG, "Cannot start pairing: Radio operation already in progress");
+template<typename Radio>
+void ZehnderFanProtocol<Radio>::start_set_speed(uint8_t unit, const FanPairingInfo &pairing_info, uint8_t speed,
+                                                uint8_t timer_minutes, FanCompletionCallback &&on_complete) {
+    PendingOperation &op = ops_[unit];
+    if (op.state != RadioOperationState::IDLE) {
+        ESP_LOGW(TAG, "Cannot set speed: Radio operation already in progress");
         return;
     }
     
-    ESP_LOGD(TAG, "Starting fan pairing discovery...");
+    // Initialize set speed operation
+    init_operation(op, RadioOperationType::SET_SPEED, std::move(on_complete));
+    op.data.set_speed.pairing_info = pairing_info;
+    op.data.set_speed.speed = speed;
+    op.data.set_speed.timer_minutes = timer_minutes;
+    op.link_id = pairing_info.network_id;
+    op.max_retries = FAN_TX_RETRIES;
+    op.retry_count = 0;
+    op.rtt = get_peer_rtt(pairing_info.network_id, pairing_info.main_unit_id);
     
-    // Initialize pairing operation
-    pending_op_.type = RadioOperationType::PAIRING_DISCOVER;
-    pending_op_.state = RadioOperationState::IDLE; // Will be set to TRANSMITTING by setup_pairing_discover
-    pending_op_.data.pairing.my_device_id = random_uint32() & 0xFE; // Avoid 0xFF
-    if (pending_op_.data.pairing.my_device_id == 0x00) 
-        pending_op_.data.pairing.my_device_id = 1;
-    pending_op_.data.pairing.pairing_step = 0;
+    build_set_speed_frame(op.tx_payload, pairing_info.main_unit_id, pairing_info.my_device_id, speed,
+                          timer_minutes);
     
-    setup_pairing_discover();
+    set_state(op, RadioOperationState::QUEUED);
 }
 
-void ZehnderFanProtocol::start_set_speed(const FanPairingInfo &pairing_info, uint8_t speed, uint8_t timer_minutes) {
-    if (pending_op_.state != RadioOperationState::IDLE) {
-        ESP_LOGW(TAG, "Cannot set speed: Radio operation already in progress");
+template<typename Radio>
+void ZehnderFanProtocol<Radio>::start_query_status(uint8_t unit, const FanPairingInfo &pairing_info,
+                                                   FanCompletionCallback &&on_complete) {
+    PendingOperation &op = ops_[unit];
+    if (op.state != RadioOperationState::IDLE) {
+        ESP_LOGW(TAG, "Cannot query status: Radio operation already in progress");
         return;
     }
-    
-    // Initialize set speed operation
-    pending_op_.type = RadioOperationType::SET_SPEED;
-    pending_op_.data.set_speed.pairing_info = pairing_info;
-    pending_op_.data.set_speed.speed = speed;
-    pending_op_.data.set_speed.timer_minutes = timer_minutes;
-    pending_op_.max_retries = FAN_TX_RETRIES;
-    pending_op_.retry_count = 0;
-    pending_op_.timeout_ms = FAN_REPLY_TIMEOUT_MS;
-    
-    // Setup radio for this network
-    radio_->set_mode_idle();
-    radio_->set_tx_address(pairing_info.network_id);
-    radio_->set_rx_address(pairing_info.network_id);
-    
-    // Prepare payload
-    memset(pending_op_.tx_payload, 0, FAN_FRAMESIZE);
-    pending_op_.tx_payload[0] = FAN_TYPE_MAIN_UNIT;
-    pending_op_.tx_payload[1] = pairing_info.main_unit_id;
-    pending_op_.tx_payload[2] = FAN_TYPE_REMOTE_CONTROL;
-    pending_op_.tx_payload[3] = pairing_info.my_device_id;
-    pending_op_.tx_payload[4] = 0xFA; // TTL
-    pending_op_.tx_payload[5] = (timer_minutes > 0) ? FAN_FRAME_SETTIMER : FAN_FRAME_SETSPEED;
-    pending_op_.tx_payload[6] = (timer_minutes > 0) ? 0x02 : 0x01; // Number of parameters
-    pending_op_.tx_payload[7] = speed;
-    pending_op_.tx_payload[8] = timer_minutes;
-    
-    start_transmit();
+
+    init_operation(op, RadioOperationType::QUERY_STATUS, std::move(on_complete));
+    op.data.query.pairing_info = pairing_info;
+    op.link_id = pairing_info.network_id;
+    op.max_retries = FAN_QUERY_RETRIES;
+    op.retry_count = 0;
+    op.rtt = get_peer_rtt(pairing_info.network_id, pairing_info.main_unit_id);
+
+    build_query_device_frame(op.tx_payload, pairing_info.main_unit_id, pairing_info.my_device_id);
+
+    set_state(op, RadioOperationState::QUEUED);
+}
+
+template<typename Radio>
+void ZehnderFanProtocol<Radio>::init_operation(PendingOperation &op, RadioOperationType type,
+                                               FanCompletionCallback &&on_complete) {
+    on_complete_[&op - ops_] = std::move(on_complete);
+    op.type = type;
+    op.spi_at_start = radio_->get_spi_stats();
+    op.op_start_time = millis();
+    op.not_before = op.op_start_time;
+    op.cca_deferrals = 0;
+    op.frames_sent = 0;
 }
 
-void ZehnderFanProtocol::process() {
-    switch (pending_op_.state) {
+template<typename Radio> void ZehnderFanProtocol<Radio>::process() {
+    if (active_op_ == nullptr) {
+        // Calibrate between operations only, never in the middle of an exchange
+        if (process_calibration()) {
+            return;
+        }
+        active_op_ = next_queued_operation();
+        if (active_op_ == nullptr) {
+            if (listen_) {
+                process_listen();
+            }
+            return;
+        }
+        listening_ = false;
+    }
+
+    PendingOperation &op = *active_op_;
+    switch (op.state) {
         case RadioOperationState::IDLE:
-            // Nothing to do
+        case RadioOperationState::OPERATION_COMPLETE:
+            break;
+
+        case RadioOperationState::QUEUED:
+            start_transmit(op);
+            break;
+
+        case RadioOperationState::PREPARING_TX:
+            // The TX FIFO can only be flushed and loaded from IDLE
+            if (radio_->get_state() == RadioState::IDLE) {
+                // CCA is only applied to STX issued in RX, so listen first
+                radio_->write_tx_payload(op.tx_payload, FAN_FRAMESIZE);
+                radio_->set_mode_receive();
+                set_state(op, RadioOperationState::CARRIER_SENSE);
+            } else if (state_timed_out(op, FAN_RADIO_STATE_TIMEOUT_MS)) {
+                ESP_LOGW(TAG, "Radio did not enter IDLE");
+                retry_or_fail(op);
+            } else {
+                radio_->set_mode_idle();
+            }
             break;
             
-        case RadioOperationState::TRANSMITTING:
-            // Check if we can move to receive mode (transmission should be quick)
-            pending_op_.state = RadioOperationState::WAITING_RESPONSE;
-            pending_op_.start_time = millis();
-            radio_->set_mode_receive();
+        case RadioOperationState::CARRIER_SENSE:
+            if (micros() - op.start_time_us >= radio_->get_cca_settle_us()) {
+                radio_->set_mode_transmit();
+                set_state(op, RadioOperationState::CHANNEL_CHECK);
+            }
             break;
+
+        case RadioOperationState::CHANNEL_CHECK:
+            // With carrier sense (CCA_MODE=11 on the CC1101) the radio ignores
+            // the transmit request and stays in RX while the channel is busy.
+            // A short frame, or a late loop, finds a sent frame back in RX too.
+            if (micros() - op.start_time_us <
+                FAN_CCA_DECISION_US + FAN_RXTX_TURNAROUND_BITS * radio_->get_bit_time_us()) {
+                break;
+            }
+            if (radio_->is_tx_deferred()) {
+                defer_transmit(op);
+            } else {
+                ESP_LOGD(TAG, "Attempt %u: channel clear, sent", op.retry_count + 1);
+                op.frames_sent++;
+                set_state(op, RadioOperationState::TRANSMITTING);
+            }
+            break;
+
+        case RadioOperationState::TRANSMITTING: {
+            // MCSM1 TXOFF_MODE=RX turns the radio around in hardware the moment
+            // the frame is sent; the reply timer starts at that edge
+            uint32_t tx_end_us;
+            if (radio_->poll_tx_done(tx_end_us)) {
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+                capture_frame(FanCaptureDirection::TX, op.tx_payload, nullptr, tx_end_us);
+#endif
+                set_state(op, RadioOperationState::WAITING_RESPONSE);
+                op.tx_time_us = tx_end_us;
+                // Frames heard during carrier sense came before ours and can't be the reply
+                radio_->service_rx();
+                discard_stale_frames(op, true);
+                op.crc_errors_at_tx = radio_->get_crc_errors();
+                // Discovery listens for a fixed window so that every open unit gets to answer
+                op.timeout_ms =
+                    op.type == RadioOperationType::PAIRING_DISCOVER ? FAN_DISCOVERY_LISTEN_MS : backoff_timeout_ms(op);
+            } else if (state_timed_out(op, radio_->get_frame_airtime_us() / 1000 + FAN_RADIO_STATE_TIMEOUT_MS)) {
+                ESP_LOGW(TAG, "Radio transmission did not complete");
+                retry_or_fail(op);
+            }
+            break;
+        }
             
         case RadioOperationState::WAITING_RESPONSE:
             // Check for received data
-            if (radio_->read_rx_payload(rx_buffer_, FAN_FRAMESIZE)) {
-                handle_response();
-            } else {
-                // Check for timeout
-                uint32_t elapsed = millis() - pending_op_.start_time;
-                if (elapsed >= pending_op_.timeout_ms) {
-                    retry_or_fail();
+            radio_->service_rx();
+            if (op.type == RadioOperationType::PAIRING_DISCOVER) {
+                process_discovery(op);
+            } else if (pop_rx_frame() && rx_frame_.view().is_valid()) {
+                if (!is_reply(op, rx_frame_.view())) {
+                    ESP_LOGV(TAG, "Ignoring frame 0x%02X from 0x%02X", rx_frame_.view().command(),
+                             rx_frame_.view().src_id());
+                    break;
                 }
+                // Karn's algorithm: a reply to a retransmission is ambiguous, don't sample it
+                if (op.retry_count == 0) {
+                    op.rtt->add_sample((rx_frame_.timestamp_us - op.tx_time_us) / 1000);
+                    ESP_LOGV(TAG, "Peer RTT %" PRIu32 " ms, reply timeout now %" PRIu32 " ms", op.rtt->get_srtt_ms(),
+                             op.rtt->get_timeout_ms());
+                }
+                handle_response(op);
+            } else if (reply_timed_out(op)) {
+                if (radio_->get_crc_errors() != op.crc_errors_at_tx) {
+                    // Something was on the air but arrived garbled: back off so
+                    // we don't collide with the same sender again in lock-step
+                    uint32_t backoff = collision_backoff_ms(op.retry_count + 1);
+                    ESP_LOGD(TAG, "Attempt %u: collided, backing off %" PRIu32 " ms", op.retry_count + 1, backoff);
+                    stats_for(op).add_collision();
+                    op.not_before = millis() + backoff;
+                } else {
+                    ESP_LOGD(TAG, "Attempt %u: no reply", op.retry_count + 1);
+                }
+                retry_or_fail(op);
             }
             break;
-            
-        case RadioOperationState::OPERATION_COMPLETE:
-            // Operation finished, waiting for external reset
-            break;
+    }
+
+    // The attempt is over: give the radio to the next unit in line
+    if (op.state == RadioOperationState::QUEUED || op.state == RadioOperationState::OPERATION_COMPLETE) {
+        active_op_ = nullptr;
+    }
+    if (op.state == RadioOperationState::OPERATION_COMPLETE) {
+        finish_operation(op);
     }
 }
 
-void ZehnderFanProtocol::start_transmit() {
-    radio_->write_tx_payload(pending_op_.tx_payload, FAN_FRAMESIZE);
-    pending_op_.state = RadioOperationState::TRANSMITTING;
-    radio_->set_mode_transmit();
-    // Note: We'll move to WAITING_RESPONSE in the next process() call
+template<typename Radio> bool ZehnderFanProtocol<Radio>::process_calibration() {
+    if (!calibrating_) {
+        if (radio_->is_calibrated() && !calibration_requested_ &&
+            millis() - last_calibration_ < calibration_interval_ms_) {
+            return false;
+        }
+        radio_->start_calibration();
+        calibrating_ = true;
+        calibration_requested_ = false;
+        calibration_start_ = millis();
+        listening_ = false;
+        return true;
+    }
+
+    if (radio_->poll_calibration()) {
+        // Backends without a synthesizer to calibrate finish at once and report nothing
+        const FanCalibrationRecord &cal = radio_->get_calibration();
+        if (cal.valid) {
+            ESP_LOGD(TAG, "Synthesizer calibrated in %" PRIu32 " ms: FSCAL3 0x%02X, FSCAL2 0x%02X, FSCAL1 0x%02X",
+                     millis() - calibration_start_, cal.fscal3, cal.fscal2, cal.fscal1);
+        }
+    } else if (millis() - calibration_start_ >= FAN_RADIO_STATE_TIMEOUT_MS) {
+        // Keep the previous values (or FS_AUTOCAL, if there are none) until the next attempt
+        ESP_LOGW(TAG, "Synthesizer calibration did not complete");
+    } else {
+        return true;
+    }
+    calibrating_ = false;
+    last_calibration_ = millis();
+    return false;
 }
 
-void ZehnderFanProtocol::handle_response() {
-    if (pending_op_.type == RadioOperationType::SET_SPEED) {
-        // For set speed, any response is considered success
+template<typename Radio> void ZehnderFanProtocol<Radio>::process_listen() {
+    if (!listening_) {
+        radio_->clear_rx_frames();
+        rx_frame_held_ = false;
+        if (wake_on_radio_) {
+            radio_->set_mode_wor();
+        } else {
+            radio_->set_mode_receive();
+        }
+        listening_ = true;
+        return;
+    }
+
+    // RXOFF_MODE keeps the radio in RX after every packet, no need to re-arm
+    bool serviced = radio_->service_rx();
+    while (pop_rx_frame()) {
+        if (frame_listener_ && rx_frame_.view().is_valid()) {
+            frame_listener_(rx_frame_);
+        }
+    }
+    if (serviced && wake_on_radio_) {
+        // A packet woke the radio into full RX; go back to sniffing
+        radio_->set_mode_wor();
+    }
+}
+
+template<typename Radio> bool ZehnderFanProtocol<Radio>::pop_rx_frame() {
+    if (rx_frame_held_) {
+        rx_frame_held_ = false;
+        return true;
+    }
+    if (!radio_->pop_rx_frame(rx_frame_)) {
+        return false;
+    }
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+    capture_frame(FanCaptureDirection::RX, rx_frame_.data, rx_frame_.status, rx_frame_.timestamp_us);
+#endif
+    return true;
+}
+
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+template<typename Radio>
+void ZehnderFanProtocol<Radio>::capture_frame(FanCaptureDirection direction, const uint8_t *data,
+                                              const uint8_t *status, uint32_t timestamp_us) {
+    FanCaptureRecord record{};
+    record.timestamp_us = timestamp_us;
+    record.direction = static_cast<uint8_t>(direction);
+    record.unit = FAN_CAPTURE_NO_UNIT;
+    if (active_op_ != nullptr) {
+        record.unit = active_op_ - ops_;
+        record.op_type = static_cast<uint8_t>(active_op_->type);
+        record.op_state = static_cast<uint8_t>(active_op_->state);
+        record.attempt = active_op_->retry_count;
+    }
+    memcpy(record.data, data, FAN_FRAMESIZE);
+    if (status != nullptr) {
+        memcpy(record.status, status, FAN_RX_STATUS_BYTES);
+    }
+    capture_.add(record);
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::dump_capture() const {
+    // The begin and end lines let a host tool cut the records out of the log stream
+    ESP_LOGI(TAG, "Capture begin: version %u, %u records of %u bytes", FAN_CAPTURE_VERSION,
+             (unsigned) capture_.size(), (unsigned) sizeof(FanCaptureRecord));
+    for (size_t i = 0; i < capture_.size(); i++) {
+        const FanCaptureRecord &record = capture_.get(i);
+        ESP_LOGI(TAG, "Capture: %s", format_hex(reinterpret_cast<const uint8_t *>(&record), sizeof(record)).c_str());
+    }
+    ESP_LOGI(TAG, "Capture end");
+}
+#endif
+
+template<typename Radio> PendingOperation *ZehnderFanProtocol<Radio>::next_queued_operation() {
+    for (uint8_t i = 1; i <= FAN_MAX_UNITS; i++) {
+        uint8_t unit = (last_served_unit_ + i) % FAN_MAX_UNITS;
+        // Skip operations still backing off after a busy channel or collision
+        if (ops_[unit].state == RadioOperationState::QUEUED && (int32_t) (millis() - ops_[unit].not_before) >= 0) {
+            last_served_unit_ = unit;
+            return &ops_[unit];
+        }
+    }
+    return nullptr;
+}
+
+template<typename Radio> uint32_t ZehnderFanProtocol<Radio>::get_idle_time_ms() const {
+    if (listen_ || is_busy() || !radio_->is_calibrated() || calibration_requested_) {
+        return 0;
+    }
+    uint32_t since = millis() - last_calibration_;
+    return since >= calibration_interval_ms_ ? 0 : calibration_interval_ms_ - since;
+}
+
+template<typename Radio> bool ZehnderFanProtocol<Radio>::is_busy() const {
+    if (calibrating_) {
+        return true;
+    }
+    for (const auto &op : ops_) {
+        if (op.state != RadioOperationState::IDLE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::set_state(PendingOperation &op, RadioOperationState state) {
+    op.state = state;
+    op.start_time = millis();
+    op.start_time_us = micros();
+}
+
+template<typename Radio> RttEstimator *ZehnderFanProtocol<Radio>::get_peer_rtt(uint32_t network_id, uint8_t unit_id) {
+    for (auto &peer : peers_) {
+        if (peer.in_use && peer.network_id == network_id && peer.unit_id == unit_id) {
+            return &peer.rtt;
+        }
+    }
+    // Unknown peer: take the next slot round-robin, forgetting its old estimate
+    PeerLink &peer = peers_[next_peer_slot_];
+    next_peer_slot_ = (next_peer_slot_ + 1) % FAN_MAX_PEERS;
+    peer = PeerLink{network_id, unit_id, true, RttEstimator()};
+    return &peer.rtt;
+}
+
+template<typename Radio> uint32_t ZehnderFanProtocol<Radio>::backoff_timeout_ms(const PendingOperation &op) const {
+    // Exponential backoff on the RTT-derived timeout, with up to 25% jitter so
+    // senders that collided once do not retry in lock-step
+    uint8_t shift = std::min(op.retry_count, FAN_MAX_BACKOFF_SHIFT);
+    uint32_t timeout = std::min(op.rtt->get_timeout_ms() << shift, FAN_MAX_REPLY_TIMEOUT_MS);
+    return timeout + random_uint32() % (timeout / 4 + 1);
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::start_transmit(PendingOperation &op) {
+    // The radio may have served another unit since this operation last ran
+    radio_->set_tx_address(op.link_id);
+    radio_->set_rx_address(op.link_id);
+
+    // Anything still buffered belongs to an earlier exchange
+    discard_stale_frames(op, false);
+    radio_->set_mode_idle();
+    set_state(op, RadioOperationState::PREPARING_TX);
+    // The frame is loaded once process() sees the radio in IDLE
+}
+
+template<typename Radio>
+bool ZehnderFanProtocol<Radio>::is_reply(const PendingOperation &op, const FrameView &frame) const {
+    if (op.type == RadioOperationType::QUERY_STATUS) {
+        // Only the settings of the unit we asked answer a query
+        return frame.command() == FAN_TYPE_FAN_SETTINGS &&
+               frame.is_from(FAN_TYPE_MAIN_UNIT, op.data.query.pairing_info.main_unit_id);
+    }
+    if (op.type == RadioOperationType::PAIRING_JOIN || op.type == RadioOperationType::PAIRING_ACK) {
+        // Only the unit being joined, talking to us
+        const FanPairingInfo &info = op.data.pairing.current_info;
+        return frame.is_from(info.main_unit_type, info.main_unit_id) &&
+               frame.is_to(FAN_TYPE_REMOTE_CONTROL, op.data.pairing.my_device_id);
+    }
+    if (op.type == RadioOperationType::SET_SPEED) {
+        // Only the paired unit acknowledging us; a frame from another remote must not stop the retries
+        const FanPairingInfo &info = op.data.set_speed.pairing_info;
+        return frame.is_from(FAN_TYPE_MAIN_UNIT, info.main_unit_id) &&
+               frame.is_to(FAN_TYPE_REMOTE_CONTROL, info.my_device_id);
+    }
+    return true;
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::handle_response(PendingOperation &op) {
+    if (op.type == RadioOperationType::SET_SPEED) {
+        // is_reply() already checked that the paired unit answered us
         ESP_LOGD(TAG, "Set speed command acknowledged.");
-        complete_operation(true);
+        complete_operation(op, true);
+
+    } else if (op.type == RadioOperationType::QUERY_STATUS) {
+        FrameView reply = rx_frame_.view();
+        FanStatus &status = op.data.query.status;
+        status.speed = reply.param(FAN_SETTINGS_SPEED);
+        status.voltage = reply.param(FAN_SETTINGS_VOLTAGE);
+        status.timer_minutes = reply.param(FAN_SETTINGS_TIMER);
+        ESP_LOGD(TAG, "Fan reports speed %u, voltage %u%%, timer %u min", status.speed, status.voltage,
+                 status.timer_minutes);
+        complete_operation(op, true);
         
-    } else if (pending_op_.type >= RadioOperationType::PAIRING_DISCOVER && 
-               pending_op_.type <= RadioOperationType::PAIRING_ACK) {
-        handle_pairing_response();
+    } else if (op.type >= RadioOperationType::PAIRING_DISCOVER && 
+               op.type <= RadioOperationType::PAIRING_ACK) {
+        handle_pairing_response(op);
+    }
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::discard_stale_frames(PendingOperation &op, bool sent) {
+    while (pop_rx_frame()) {
+        // A loop that got to the sent frame late may find the reply queued already
+        if (sent && (int32_t) (rx_frame_.timestamp_us - op.tx_time_us) >= 0) {
+            rx_frame_held_ = true;
+            return;
+        }
+        if (op.type == RadioOperationType::PAIRING_DISCOVER) {
+            add_pairing_candidate(op, rx_frame_);
+        }
     }
 }
 
-void ZehnderFanProtocol::retry_or_fail() {
-    pending_op_.retry_count++;
+template<typename Radio> void ZehnderFanProtocol<Radio>::process_discovery(PendingOperation &op) {
+    // Keep listening for the whole window; every open unit may answer
+    while (pop_rx_frame()) {
+        add_pairing_candidate(op, rx_frame_);
+    }
+    if (!reply_timed_out(op)) {
+        return;
+    }
+
+    auto &pairing = op.data.pairing;
+    bool last_attempt = op.retry_count + 1 >= op.max_retries || millis() - op.op_start_time >= operation_timeout_ms_;
+    if (pairing.candidate_count > 0 && ((int32_t) (millis() - pairing.collect_until) >= 0 || last_attempt)) {
+        finish_discovery(op);
+    } else {
+        // Nobody answered yet: send the next discovery frame
+        retry_or_fail(op);
+    }
+}
+
+template<typename Radio>
+void ZehnderFanProtocol<Radio>::add_pairing_candidate(PendingOperation &op, const RxFrame &frame) {
+    auto &pairing = op.data.pairing;
+    FrameView view = frame.view();
+    // Other traffic on the pairing link, including JOIN_OPEN meant for another remote, is not for us
+    if (!view.is_valid() || view.command() != FAN_NETWORK_JOIN_OPEN ||
+        !view.is_to(FAN_TYPE_REMOTE_CONTROL, pairing.my_device_id)) {
+        ESP_LOGV(TAG, "Ignoring frame 0x%02X from 0x%02X during discovery", view.command(), view.src_id());
+        return;
+    }
+
+    FanPairingInfo info{view.param_u32le(0), view.src_id(), view.src_type(), pairing.my_device_id};
+    float rssi = frame.rssi_dbm();
+    PairingCandidate *slot = nullptr;
+    for (uint8_t i = 0; i < pairing.candidate_count; i++) {
+        PairingCandidate &known = pairing.candidates[i];
+        if (known.info.network_id == info.network_id && known.info.main_unit_id == info.main_unit_id) {
+            known.rssi_dbm = std::max(known.rssi_dbm, rssi);
+            return;
+        }
+        if (slot == nullptr || known.rssi_dbm < slot->rssi_dbm) {
+            slot = &known;
+        }
+    }
+    if (pairing.candidate_count == 0) {
+        // Give the other open units a moment to answer as well
+        pairing.collect_until = millis() + FAN_DISCOVERY_COLLECT_MS;
+    }
+    if (pairing.candidate_count < FAN_MAX_PAIRING_CANDIDATES) {
+        slot = &pairing.candidates[pairing.candidate_count++];
+    } else if (slot->rssi_dbm >= rssi) {
+        return;  // Weaker than every unit already found
+    }
+
+    ESP_LOGD(TAG, "Found fan unit ID 0x%02X on network 0x%08" PRIX32 " at %.1f dBm", info.main_unit_id, info.network_id,
+             rssi);
+    *slot = PairingCandidate{info, rssi};
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::finish_discovery(PendingOperation &op) {
+    auto &pairing = op.data.pairing;
+    ESP_LOGD(TAG, "Discovery found %u fan unit(s) in %" PRIu32 " ms", pairing.candidate_count,
+             millis() - op.op_start_time);
+
+    if (!pairing.auto_join && pairing.candidate_count > 1) {
+        // Leave the choice to the user
+        complete_operation(op, true);
+        return;
+    }
+
+    const PairingCandidate *best = &pairing.candidates[0];
+    for (uint8_t i = 1; i < pairing.candidate_count; i++) {
+        if (pairing.candidates[i].rssi_dbm > best->rssi_dbm) {
+            best = &pairing.candidates[i];
+        }
+    }
+    pairing.current_info = best->info;
+    ESP_LOGD(TAG, "Requesting to join fan unit ID 0x%02X on network 0x%08" PRIX32 "...", best->info.main_unit_id,
+             best->info.network_id);
+    setup_pairing_join(op);
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::retry_or_fail(PendingOperation &op) {
+    op.retry_count++;
     
-    if (pending_op_.retry_count < pending_op_.max_retries) {
-        ESP_LOGD(TAG, "Radio timeout, retrying (%d/%d)", pending_op_.retry_count, pending_op_.max_retries);
-        start_transmit();
+    if (millis() - op.op_start_time >= operation_timeout_ms_) {
+        ESP_LOGW(TAG, "Radio operation failed: No reply within %" PRIu32 " ms (%d attempts)", operation_timeout_ms_,
+                 op.retry_count);
+        calibration_requested_ = true;  // Rule out synthesizer drift before the next operation
+        complete_operation(op, false);
+    } else if (op.retry_count < op.max_retries) {
+        ESP_LOGD(TAG, "Radio timeout, retrying (%d/%d)", op.retry_count, op.max_retries);
+        set_state(op, RadioOperationState::QUEUED);
     } else {
-        ESP_LOGW(TAG, "Radio operation failed after %d retries", pending_op_.max_retries);
-        complete_operation(false);
+        ESP_LOGW(TAG, "Radio operation failed after %d retries", op.max_retries);
+        calibration_requested_ = true;
+        complete_operation(op, false);
     }
 }
 
-void ZehnderFanProtocol::complete_operation(bool success) {
-    pending_op_.state = RadioOperationState::OPERATION_COMPLETE;
-    last_operation_success_ = success;
-    radio_->set_mode_idle();
+template<typename Radio> uint32_t ZehnderFanProtocol<Radio>::collision_backoff_ms(uint8_t attempts) const {
+    // Random slot in a window that doubles with every busy or collided attempt
+    uint8_t shift = std::min<uint8_t>(attempts, FAN_MAX_BACKOFF_SHIFT);
+    return 1 + random_uint32() % (FAN_CCA_BACKOFF_MS << shift);
 }
 
-std::optional<FanPairingInfo> ZehnderFanProtocol::get_pairing_result() {
-    if (pending_op_.type == RadioOperationType::PAIRING_ACK && 
-        pending_op_.state == RadioOperationState::OPERATION_COMPLETE &&
-        last_operation_success_) {
-        return pairing_result_;
+template<typename Radio> void ZehnderFanProtocol<Radio>::defer_transmit(PendingOperation &op) {
+    // Nothing was sent, so this does not count as a retry; only the overall
+    // deadline limits how long we wait for a clear channel
+    op.cca_deferrals++;
+    stats_for(op).add_deferral();
+    radio_->set_mode_idle();
+    if (millis() - op.op_start_time >= operation_timeout_ms_) {
+        ESP_LOGW(TAG, "Radio operation failed: Channel busy for %" PRIu32 " ms", operation_timeout_ms_);
+        complete_operation(op, false);
+        return;
     }
-    return std::nullopt;
+    uint32_t backoff = collision_backoff_ms(op.cca_deferrals);
+    ESP_LOGD(TAG, "Attempt %u: carrier sense deferred, backing off %" PRIu32 " ms", op.retry_count + 1, backoff);
+    op.not_before = millis() + backoff;
+    set_state(op, RadioOperationState::QUEUED);
 }
 
-void ZehnderFanProtocol::reset_operation_state() {
-    pending_op_.state = RadioOperationState::IDLE;
-    pending_op_.type = RadioOperationType::NONE;
+template<typename Radio> void ZehnderFanProtocol<Radio>::complete_operation(PendingOperation &op, bool success) {
+    op.state = RadioOperationState::OPERATION_COMPLETE;
+    op.success = success;
     radio_->set_mode_idle();
+
+    SpiStats cost = radio_->get_spi_stats() - op.spi_at_start;
+    ESP_LOGD(TAG, "Radio operation cost: %" PRIu32 " SPI transactions, %" PRIu32 " bytes, %" PRIu32 " us blocked",
+             cost.transactions, cost.bytes, cost.blocked_us);
+
+    stats_for(op).record(success, millis() - op.op_start_time, op.frames_sent,
+                         op.frames_sent * radio_->get_frame_airtime_us());
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::log_stats() const {
+    stats_[FAN_STATS_SET_SPEED].log("Set speed");
+    stats_[FAN_STATS_PAIRING].log("Pairing");
+    stats_[FAN_STATS_QUERY].log("Status query");
+}
+
+template<typename Radio> void ZehnderFanProtocol<Radio>::finish_operation(PendingOperation &op) {
+    FanOperationResult result{};
+    result.outcome = op.success ? FanOperationOutcome::ACKED : FanOperationOutcome::TIMED_OUT;
+    result.retries = op.retry_count;
+    result.elapsed_ms = millis() - op.op_start_time;
+    if (op.success && op.type == RadioOperationType::QUERY_STATUS) {
+        result.status = op.data.query.status;
+    }
+    if (op.type >= RadioOperationType::PAIRING_DISCOVER && op.type <= RadioOperationType::PAIRING_ACK) {
+        if (op.success && op.type == RadioOperationType::PAIRING_ACK) {
+            result.pairing = op.data.pairing.current_info;
+        }
+        result.candidate_count = op.data.pairing.candidate_count;
+        std::copy(op.data.pairing.candidates, op.data.pairing.candidates + result.candidate_count,
+                  result.candidates);
+    }
+
+    // The radio itself was already idled on completion and may now serve another unit
+    op.state = RadioOperationState::IDLE;
+    op.type = RadioOperationType::NONE;
+    FanCompletionCallback on_complete = std::move(on_complete_[&op - ops_]);
+    on_complete_[&op - ops_] = nullptr;
+    if (on_complete) {
+        on_complete(result);
+    }
 }
 
 // Pairing state machine implementation
-void ZehnderFanProtocol::setup_pairing_discover() {
-    radio_->set_mode_idle();
-    radio_->set_tx_address(NETWORK_LINK_ID);
-    radio_->set_rx_address(NETWORK_LINK_ID);
-    
-    pending_op_.max_retries = FAN_TX_RETRIES;
-    pending_op_.retry_count = 0;
-    pending_op_.timeout_ms = FAN_REPLY_TIMEOUT_MS;
+template<typename Radio> void ZehnderFanProtocol<Radio>::setup_pairing_discover(PendingOperation &op) {
+    op.link_id = NETWORK_LINK_ID;
+    op.max_retries = FAN_TX_RETRIES;
+    op.retry_count = 0;
+    op.rtt = get_peer_rtt(NETWORK_LINK_ID, FAN_TYPE_BROADCAST);
     
-    // Prepare discovery payload
-    memset(pending_op_.tx_payload, 0, FAN_FRAMESIZE);
-    pending_op_.tx_payload[0] = 0x04;
-    pending_op_.tx_payload[1] = 0x00;
-    pending_op_.tx_payload[2] = FAN_TYPE_REMOTE_CONTROL;
-    pending_op_.tx_payload[3] = pending_op_.data.pairing.my_device_id;
-    pending_op_.tx_payload[4] = 0xFA;
-    pending_op_.tx_payload[5] = FAN_NETWORK_JOIN_ACK;
-    pending_op_.tx_payload[6] = 0x04;
-    pending_op_.tx_payload[7] = 0xa5;
-    pending_op_.tx_payload[8] = 0x5a;
-    pending_op_.tx_payload[9] = 0x5a;
-    pending_op_.tx_payload[10] = 0xa5;
+    build_discover_frame(op.tx_payload, op.data.pairing.my_device_id);
     
-    start_transmit();
+    set_state(op, RadioOperationState::QUEUED);
 }
 
-void ZehnderFanProtocol::setup_pairing_join() {
-    auto &info = pending_op_.data.pairing.current_info;
+template<typename Radio> void ZehnderFanProtocol<Radio>::setup_pairing_join(PendingOperation &op) {
+    auto &info = op.data.pairing.current_info;
     
-    radio_->set_tx_address(info.network_id);
-    radio_->set_rx_address(info.network_id);
+    op.type = RadioOperationType::PAIRING_JOIN;
+    op.link_id = info.network_id;
+    op.retry_count = 0;
+    op.rtt = get_peer_rtt(info.network_id, info.main_unit_id);
     
-    pending_op_.type = RadioOperationType::PAIRING_JOIN;
-    pending_op_.retry_count = 0;
+    build_join_request_frame(op.tx_payload, info.main_unit_id, op.data.pairing.my_device_id, info.network_id);
     
-    // Prepare join payload
-    memset(pending_op_.tx_payload, 0, FAN_FRAMESIZE);
-    pending_op_.tx_payload[0] = FAN_TYPE_MAIN_UNIT;
-    pending_op_.tx_payload[1] = info.main_unit_id;
-    pending_op_.tx_payload[2] = FAN_TYPE_REMOTE_CONTROL;
-    pending_op_.tx_payload[3] = pending_op_.data.pairing.my_device_id;
-    pending_op_.tx_payload[4] = 0xFA;
-    pending_op_.tx_payload[5] = FAN_NETWORK_JOIN_REQUEST;
-    pending_op_.tx_payload[7] = (info.network_id >> 0) & 0xFF;
-    pending_op_.tx_payload[8] = (info.network_id >> 8) & 0xFF;
-    pending_op_.tx_payload[9] = (info.network_id >> 16) & 0xFF;
-    pending_op_.tx_payload[10] = (info.network_id >> 24) & 0xFF;
-    
-    start_transmit();
+    set_state(op, RadioOperationState::QUEUED);
 }
 
-void ZehnderFanProtocol::setup_pairing_ack() {
-    auto &info = pending_op_.data.pairing.current_info;
+template<typename Radio> void ZehnderFanProtocol<Radio>::setup_pairing_ack(PendingOperation &op) {
+    auto &info = op.data.pairing.current_info;
     
-    pending_op_.type = RadioOperationType::PAIRING_ACK;
-    pending_op_.retry_count = 0;
-    pending_op_.max_retries = 1; // Fire and forget
+    op.type = RadioOperationType::PAIRING_ACK;
+    op.retry_count = 0;
+    op.max_retries = 1; // Fire and forget
     
-    // Prepare ack payload
-    memset(pending_op_.tx_payload, 0, FAN_FRAMESIZE);
-    pending_op_.tx_payload[0] = FAN_TYPE_MAIN_UNIT;
-    pending_op_.tx_payload[1] = info.main_unit_id;
-    pending_op_.tx_payload[2] = FAN_TYPE_REMOTE_CONTROL;
-    pending_op_.tx_payload[3] = pending_op_.data.pairing.my_device_id;
-    pending_op_.tx_payload[4] = 0xFA;
-    pending_op_.tx_payload[5] = FAN_FRAME_0B;
+    build_join_ack_frame(op.tx_payload, info.main_unit_id, op.data.pairing.my_device_id);
     
-    start_transmit();
+    set_state(op, RadioOperationState::QUEUED);
 }
 
-void ZehnderFanProtocol::handle_pairing_response() {
-    if (pending_op_.type == RadioOperationType::PAIRING_DISCOVER) {
-        if (rx_buffer_[5] != FAN_NETWORK_JOIN_OPEN) {
-            ESP_LOGW(TAG, "Pairing failed: Received unexpected frame type 0x%02X.", rx_buffer_[5]);
-            complete_operation(false);
-            return;
-        }
-        
-        // Extract pairing info from response
-        auto &info = pending_op_.data.pairing.current_info;
-        info.main_unit_type = rx_buffer_[2];
-        info.main_unit_id = rx_buffer_[3];
-        info.network_id = (uint32_t)rx_buffer_[7] | ((uint32_t)rx_buffer_[8] << 8) | 
-                         ((uint32_t)rx_buffer_[9] << 16) | ((uint32_t)rx_buffer_[10] << 24);
-        info.my_device_id = pending_op_.data.pairing.my_device_id;
-        
-        ESP_LOGD(TAG, "Found fan unit ID 0x%02X on network 0x%08X. Requesting to join...", 
-                 info.main_unit_id, info.network_id);
-        
-        // Move to join phase
-        setup_pairing_join();
-        
-    } else if (pending_op_.type == RadioOperationType::PAIRING_JOIN) {
+template<typename Radio> void ZehnderFanProtocol<Radio>::handle_pairing_response(PendingOperation &op) {
+    // Discovery replies are collected by process_discovery()
+    if (op.type == RadioOperationType::PAIRING_JOIN) {
         // Join acknowledged, send final ack
         ESP_LOGD(TAG, "Join request acknowledged, sending final ack...");
-        setup_pairing_ack();
+        setup_pairing_ack(op);
         
-    } else if (pending_op_.type == RadioOperationType::PAIRING_ACK) {
+    } else if (op.type == RadioOperationType::PAIRING_ACK) {
         // Pairing complete!
-        auto &info = pending_op_.data.pairing.current_info;
-        pairing_result_ = info;
+        auto &info = op.data.pairing.current_info;
         
         ESP_LOGI(TAG, "Pairing successful! Network ID: 0x%08X, Fan ID: 0x%02X, My Device ID: 0x%02X",
                  info.network_id, info.main_unit_id, info.my_device_id);
         
-        complete_operation(true);
+        complete_operation(op, true);
     }
 }
 
+template class ZehnderFanProtocol<FanRadio>;
+
 
 // =========================================================================
-// 3. ZehnderFanComponent Implementation
+// ZehnderFanComponent Implementation
 // =========================================================================
 
-void ZehnderFanComponent::setup() {
-    ESP_LOGCONFIG(TAG, "Setting up Zehnder Fan...");
+// Maps the fan entity state and speed level to a protocol speed
+static uint8_t to_fan_speed(bool state, int speed) {
+    if (!state) {
+        return FAN_SPEED_AUTO; // Off
+    }
+    switch (speed) {
+        case 1: return FAN_SPEED_LOW;
+        case 2: return FAN_SPEED_MEDIUM;
+        case 3: return FAN_SPEED_HIGH;
+        case 4: return FAN_SPEED_MAX;
+        default: return FAN_SPEED_AUTO;
+    }
+}
+
+// Maps a protocol speed back to the fan entity speed level (0 = off)
+static int from_fan_speed(uint8_t fan_speed) {
+    switch (fan_speed) {
+        case FAN_SPEED_LOW: return 1;
+        case FAN_SPEED_MEDIUM: return 2;
+        case FAN_SPEED_HIGH: return 3;
+        case FAN_SPEED_MAX: return 4;
+        default: return 0;
+    }
+}
 
-    // Initialize CC1101 SPI device
-    this->cc1101_radio_.set_spi_parent(this->spi_parent_);
-    this->cc1101_radio_.set_cs_pin(this->cs_pin_);
-    this->cc1101_radio_.setup_pins(this->gdo0_pin_, this->gdo2_pin_);
-    this->cc1101_radio_.init();
+// Reason passed to on_command_failed
+static std::string outcome_to_string(FanOperationOutcome outcome) {
+    switch (outcome) {
+        case FanOperationOutcome::ACKED: return "acked";
+        case FanOperationOutcome::TIMED_OUT: return "timed_out";
+        case FanOperationOutcome::REJECTED: return "rejected";
+        case FanOperationOutcome::PREEMPTED: return "preempted";
+        default: return "unknown";
+    }
+}
 
-    this->fan_protocol_ = make_unique<ZehnderFanProtocol>(&this->cc1101_radio_);
+#ifdef USE_SELECT
+// Pairing select option shown while no discovered unit is joined
+static const char *const FAN_PAIRING_SELECT_NONE = "None";
+
+static std::string format_candidate(const PairingCandidate &candidate) {
+    return str_sprintf("0x%02X on 0x%08X (%.0f dBm)", candidate.info.main_unit_id, candidate.info.network_id,
+                       candidate.rssi_dbm);
+}
+#endif
+
+bool FanCommandQueue::push(const FanCommand &command, bool *replaced) {
+    // Coalesce with a queued command of the same type: the newest request wins
+    for (uint8_t i = 0; i < this->count_; i++) {
+        FanCommand &queued = this->commands_[(this->head_ + i) % FAN_COMMAND_QUEUE_SIZE];
+        if (queued.type == command.type) {
+            queued = command;
+            if (replaced != nullptr) {
+                *replaced = true;
+            }
+            return true;
+        }
+    }
+    if (this->count_ == FAN_COMMAND_QUEUE_SIZE) {
+        return false;
+    }
+    this->commands_[(this->head_ + this->count_) % FAN_COMMAND_QUEUE_SIZE] = command;
+    this->count_++;
+    return true;
+}
+
+bool FanCommandQueue::pop(FanCommand &command) {
+    if (this->count_ == 0) {
+        return false;
+    }
+    command = this->commands_[this->head_];
+    this->head_ = (this->head_ + 1) % FAN_COMMAND_QUEUE_SIZE;
+    this->count_--;
+    return true;
+}
+
+void ZehnderRadio::setup() {
+    ESP_LOGCONFIG(TAG, "Setting up Zehnder radio...");
+
+    // Pins and backend options were handed to the radio by the setters
+    this->radio_.init();
+
+    this->fan_protocol_ = make_unique<FanProtocol>(&this->radio_);
+    this->fan_protocol_->set_operation_timeout(this->operation_timeout_ms_);
+    this->fan_protocol_->set_calibration_interval(this->calibration_interval_ms_);
+    this->fan_protocol_->set_listen(this->listen_);
+    this->fan_protocol_->set_wake_on_radio(this->wake_on_radio_);
+    this->fan_protocol_->set_frame_listener([this](const RxFrame &frame) {
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+        RadioEvent event{RadioEventType::FRAME_HEARD, {}};
+        event.frame = frame;
+        this->post_event(event);
+#else
+        this->handle_frame(frame);
+#endif
+    });
     
     // Initialize NVS
     esp_err_t err = nvs_flash_init();
@@ -504,37 +939,510 @@ void ZehnderFanComponent::setup() {
     }
     ESP_ERROR_CHECK(err);
 
-    if (this->load_pairing_info()) {
-        ESP_LOGI(TAG, "Loaded pairing info from NVS.");
-    } else {
-        ESP_LOGW(TAG, "No pairing info found. Fan needs to be paired.");
+    this->load_record();
+    this->assign_unit_slots();
+    if (this->migrate_legacy_pairing()) {
+        this->record_dirty_ = true;
     }
+    if (this->record_dirty_) {
+        this->save_record();
+    }
+    if (this->record_.calibration.valid && this->record_.radio_config == this->radio_.get_config_hash()) {
+        // Skip the boot-time SCAL; the timer recalibrates later anyway
+        this->radio_.restore_calibration(this->record_.calibration);
+        this->calibration_seen_ = this->record_.calibration;
+    } else if (this->record_.calibration.valid) {
+        ESP_LOGI(TAG, "Radio configuration changed, discarding stored calibration");
+    }
+
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    // From here on only the task touches the radio and the protocol
+    if (xTaskCreate(ZehnderRadio::radio_task, "zehnder_radio", FAN_RADIO_TASK_STACK_SIZE, this,
+                    FAN_RADIO_TASK_PRIORITY, &this->radio_task_handle_) != pdPASS) {
+        ESP_LOGE(TAG, "Could not start the radio task");
+        this->mark_failed();
+        return;
+    }
+#ifdef USE_ZEHNDER_FAN_CC1101
+    this->radio_.set_wake_task(this->radio_task_handle_);
+#endif
+#endif
 }
 
-void ZehnderFanComponent::loop() {
-    // Process async radio operations
+void ZehnderRadio::loop() {
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    // Hand the task's results to the units; the task wakes this loop again
+    // when it posts the next one
+    RadioCompletion completion;
+    while (this->completions_.pop(completion)) {
+        FanCompletionCallback on_complete = std::move(this->on_complete_[completion.unit]);
+        this->on_complete_[completion.unit] = nullptr;
+        if (on_complete) {
+            on_complete(completion.result);
+        }
+    }
+    RadioEvent event;
+    while (this->events_.pop(event)) {
+        switch (event.type) {
+            case RadioEventType::FRAME_HEARD:
+                this->handle_frame(event.frame);
+                break;
+            case RadioEventType::LINK_QUALITY:
+                this->handle_link_quality(event.link_quality.rssi_dbm, event.link_quality.lqi);
+                break;
+            case RadioEventType::CALIBRATION:
+                this->handle_calibration(event.calibration);
+                break;
+        }
+    }
+    this->disable_loop();
+#else
+    // Process async radio operations; units hear about results through their callbacks
     this->fan_protocol_->process();
-    
-    // Handle operation completion
-    if (this->fan_protocol_->is_operation_complete()) {
-        this->handle_operation_complete();
+    this->sync_radio_state();
+
+    // Radio state changes take microseconds; don't wait a full loop interval for each
+    if (this->fan_protocol_->is_busy()) {
+        this->high_freq_.start();
+    } else {
+        this->high_freq_.stop();
+    }
+
+    // Nothing to do until a unit starts an operation or the next recalibration is due
+    uint32_t idle_ms = this->fan_protocol_->get_idle_time_ms();
+    if (idle_ms > 0) {
+        this->disable_loop();
+        this->set_timeout("recalibrate", idle_ms, [this]() { this->enable_loop(); });
+    }
+#endif
+}
+
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+void ZehnderRadio::radio_task(void *arg) {
+    auto *radio = static_cast<ZehnderRadio *>(arg);
+    while (true) {
+        radio->process_commands();
+        radio->fan_protocol_->process();
+        radio->sync_radio_state();
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+        if (radio->capture_dump_requested_.exchange(false, std::memory_order_acquire)) {
+            radio->fan_protocol_->dump_capture();
+        }
+#endif
+
+        // Poll every tick while an exchange runs or the radio listens. Otherwise
+        // sleep until a command, a GDO0 edge or the next recalibration.
+        uint32_t idle_ms = radio->fan_protocol_->get_idle_time_ms();
+        ulTaskNotifyTake(pdTRUE, idle_ms == 0 ? 1 : pdMS_TO_TICKS(idle_ms));
+    }
+}
+
+void ZehnderRadio::start_command(const RadioCommand &command, FanCompletionCallback &&on_complete) {
+    this->on_complete_[command.unit] = std::move(on_complete);
+    if (!this->commands_.push(command)) {
+        // Cannot happen with one operation per unit, but never leave a unit waiting
+        ESP_LOGE(TAG, "Radio command queue full");
+        FanOperationResult result{};
+        result.outcome = FanOperationOutcome::REJECTED;
+        FanCompletionCallback callback = std::move(this->on_complete_[command.unit]);
+        this->on_complete_[command.unit] = nullptr;
+        callback(result);
+        return;
+    }
+    xTaskNotifyGive(this->radio_task_handle_);
+}
+
+void ZehnderRadio::process_commands() {
+    RadioCommand command;
+    while (this->commands_.pop(command)) {
+        uint8_t unit = command.unit;
+        FanCompletionCallback on_complete = [this, unit](const FanOperationResult &result) {
+            this->completions_.push(RadioCompletion{unit, result});
+            this->enable_loop_soon_any_context();
+        };
+        switch (command.type) {
+            case RadioCommandType::PAIR:
+                this->fan_protocol_->start_pairing(unit, command.auto_join, std::move(on_complete));
+                break;
+            case RadioCommandType::PAIR_JOIN:
+                this->fan_protocol_->start_pairing_join(unit, command.pairing_info, std::move(on_complete));
+                break;
+            case RadioCommandType::SET_SPEED:
+                this->fan_protocol_->start_set_speed(unit, command.pairing_info, command.speed, command.timer_minutes,
+                                                     std::move(on_complete));
+                break;
+            case RadioCommandType::QUERY_STATUS:
+                this->fan_protocol_->start_query_status(unit, command.pairing_info, std::move(on_complete));
+                break;
+        }
+    }
+}
+
+void ZehnderRadio::post_event(const RadioEvent &event) {
+    if (this->events_.push(event)) {
+        this->enable_loop_soon_any_context();
+    }
+}
+#endif
+
+void ZehnderRadio::start_pairing(uint8_t unit, bool auto_join, FanCompletionCallback &&on_complete) {
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    RadioCommand command{RadioCommandType::PAIR, unit, {}, 0, 0, auto_join};
+    this->start_command(command, std::move(on_complete));
+#else
+    this->fan_protocol_->start_pairing(unit, auto_join, std::move(on_complete));
+    // The loop sleeps while no unit has work for the radio
+    this->enable_loop();
+#endif
+}
+
+void ZehnderRadio::start_pairing_join(uint8_t unit, const FanPairingInfo &candidate,
+                                      FanCompletionCallback &&on_complete) {
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    RadioCommand command{RadioCommandType::PAIR_JOIN, unit, candidate, 0, 0, false};
+    this->start_command(command, std::move(on_complete));
+#else
+    this->fan_protocol_->start_pairing_join(unit, candidate, std::move(on_complete));
+    this->enable_loop();
+#endif
+}
+
+void ZehnderRadio::start_set_speed(uint8_t unit, const FanPairingInfo &pairing_info, uint8_t speed,
+                                   uint8_t timer_minutes, FanCompletionCallback &&on_complete) {
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    RadioCommand command{RadioCommandType::SET_SPEED, unit, pairing_info, speed, timer_minutes, false};
+    this->start_command(command, std::move(on_complete));
+#else
+    this->fan_protocol_->start_set_speed(unit, pairing_info, speed, timer_minutes, std::move(on_complete));
+    this->enable_loop();
+#endif
+}
+
+void ZehnderRadio::start_query_status(uint8_t unit, const FanPairingInfo &pairing_info,
+                                      FanCompletionCallback &&on_complete) {
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    RadioCommand command{RadioCommandType::QUERY_STATUS, unit, pairing_info, 0, 0, false};
+    this->start_command(command, std::move(on_complete));
+#else
+    this->fan_protocol_->start_query_status(unit, pairing_info, std::move(on_complete));
+    this->enable_loop();
+#endif
+}
+
+void ZehnderRadio::dump_capture() {
+#if !defined(USE_ZEHNDER_FAN_CAPTURE)
+    ESP_LOGW(TAG, "Frame capture is off, enable it with capture: true");
+#elif defined(USE_ZEHNDER_FAN_RADIO_TASK)
+    // The capture belongs to the radio task, which dumps it on its next pass
+    this->capture_dump_requested_.store(true, std::memory_order_release);
+    xTaskNotifyGive(this->radio_task_handle_);
+#else
+    this->fan_protocol_->dump_capture();
+#endif
+}
+
+void ZehnderRadio::sync_radio_state() {
+    const LinkQuality &quality = this->radio_.get_link_quality();
+    if (quality.get_samples() != this->link_quality_samples_) {
+        this->link_quality_samples_ = quality.get_samples();
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+        RadioEvent event{RadioEventType::LINK_QUALITY, {}};
+        event.link_quality = {quality.get_rssi_dbm(), quality.get_lqi()};
+        this->post_event(event);
+#else
+        this->handle_link_quality(quality.get_rssi_dbm(), quality.get_lqi());
+#endif
+    }
+
+    const FanCalibrationRecord &calibration = this->radio_.get_calibration();
+    if (calibration.valid && memcmp(&calibration, &this->calibration_seen_, sizeof(FanCalibrationRecord)) != 0) {
+        this->calibration_seen_ = calibration;
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+        RadioEvent event{RadioEventType::CALIBRATION, {}};
+        event.calibration = calibration;
+        this->post_event(event);
+#else
+        this->handle_calibration(calibration);
+#endif
+    }
+}
+
+void ZehnderRadio::handle_frame(const RxFrame &frame) {
+    for (uint8_t unit = 0; unit < this->unit_count_; unit++) {
+        this->units_[unit]->handle_overheard_frame(frame);
+    }
+}
+
+void ZehnderRadio::handle_link_quality(float rssi_dbm, float lqi) {
+#ifdef USE_SENSOR
+    if (this->rssi_sensor_ != nullptr) {
+        this->rssi_sensor_->publish_state(rssi_dbm);
+    }
+    if (this->lqi_sensor_ != nullptr) {
+        this->lqi_sensor_->publish_state(lqi);
+    }
+#endif
+}
+
+void ZehnderRadio::handle_calibration(const FanCalibrationRecord &calibration) {
+    this->record_.calibration = calibration;
+    this->record_.radio_config = this->radio_.get_config_hash();
+    this->schedule_save(false);
+}
+
+void ZehnderRadio::on_shutdown() {
+    // Don't lose a speed change still waiting for its deferred write
+    if (this->record_dirty_) {
+        this->save_record();
+    }
+}
+
+void ZehnderRadio::dump_config() {
+    ESP_LOGCONFIG(TAG, "Zehnder Radio:");
+    this->radio_.dump_config();
+    ESP_LOGCONFIG(TAG, "  Operation Timeout: %" PRIu32 " ms", this->operation_timeout_ms_);
+    ESP_LOGCONFIG(TAG, "  Calibration Interval: %" PRIu32 " s", this->calibration_interval_ms_ / 1000);
+    ESP_LOGCONFIG(TAG, "  Listen: %s", YESNO(this->listen_));
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+    ESP_LOGCONFIG(TAG, "  Frame Capture: %u records", (unsigned) FAN_CAPTURE_SIZE);
+#endif
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    // Statistics below are read while the task updates them; a line may mix old and new counts
+    ESP_LOGCONFIG(TAG, "  Radio Task: priority %u, %" PRIu32 " dropped events", FAN_RADIO_TASK_PRIORITY,
+                  this->events_.dropped());
+#endif
+    ESP_LOGCONFIG(TAG, "  Fan Units: %u", this->unit_count_);
+    const SpiStats &spi = this->radio_.get_spi_stats();
+    ESP_LOGCONFIG(TAG, "  SPI Usage: %" PRIu32 " transactions, %" PRIu32 " bytes, %" PRIu32 " us blocked",
+                  spi.transactions, spi.bytes, spi.blocked_us);
+    if (this->fan_protocol_ != nullptr) {
+        this->fan_protocol_->log_stats();
+    }
+#ifdef USE_SENSOR
+    LOG_SENSOR("  ", "RSSI", this->rssi_sensor_);
+    LOG_SENSOR("  ", "LQI", this->lqi_sensor_);
+#endif
+}
+
+
+void ZehnderRadio::set_record_key(const std::string &id) {
+    snprintf(this->record_key_, sizeof(this->record_key_), "record_%08" PRIx32, fnv1_hash(id));
+}
+
+void ZehnderRadio::load_record() {
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &this->nvs_handle_);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
+        return;
+    }
+    this->nvs_open_ = true;
+
+    FanPersistentRecord loaded;
+    size_t size = sizeof(loaded);
+    err = nvs_get_blob(this->nvs_handle_, this->record_key_, &loaded, &size);
+    if (err == ESP_OK && size == sizeof(loaded) && loaded.version == FAN_RECORD_VERSION &&
+        loaded.crc == crc16(reinterpret_cast<const uint8_t *>(&loaded), offsetof(FanPersistentRecord, crc))) {
+        this->record_ = loaded;
+        ESP_LOGD(TAG, "Loaded persistent record");
+        return;
+    }
+
+    if (err == ESP_OK) {
+        ESP_LOGW(TAG, "Persistent record is invalid or outdated, starting fresh");
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Error (%s) reading persistent record!", esp_err_to_name(err));
+    }
+    this->record_ = FanPersistentRecord{};
+}
+
+void ZehnderRadio::assign_unit_slots() {
+    bool taken[FAN_MAX_UNITS]{};
+    uint32_t keys[FAN_MAX_UNITS];
+    for (uint8_t unit = 0; unit < this->unit_count_; unit++) {
+        keys[unit] = this->units_[unit]->get_object_id_hash();
+        this->unit_slots_[unit] = FAN_NO_SLOT;
+    }
+
+    // A fan keeps the slot it had
+    for (uint8_t unit = 0; unit < this->unit_count_; unit++) {
+        for (uint8_t slot = 0; slot < FAN_MAX_UNITS; slot++) {
+            if (!taken[slot] && this->record_.unit_keys[slot] == keys[unit]) {
+                this->unit_slots_[unit] = slot;
+                taken[slot] = true;
+                break;
+            }
+        }
+    }
+
+    // New fans start from an empty slot, preferably one nobody claimed;
+    // otherwise from the slot of a fan that is no longer configured
+    for (uint8_t unit = 0; unit < this->unit_count_; unit++) {
+        if (this->unit_slots_[unit] != FAN_NO_SLOT) {
+            continue;
+        }
+        uint8_t free_slot = FAN_NO_SLOT;
+        for (uint8_t slot = 0; slot < FAN_MAX_UNITS; slot++) {
+            if (taken[slot]) {
+                continue;
+            }
+            if (this->record_.unit_keys[slot] == 0) {
+                free_slot = slot;
+                break;
+            }
+            if (free_slot == FAN_NO_SLOT) {
+                free_slot = slot;
+            }
+        }
+        // There are as many slots as units, so one is always left
+        if (this->record_.unit_keys[free_slot] != 0) {
+            ESP_LOGI(TAG, "Dropping pairing of a fan that is no longer configured");
+        }
+        this->unit_slots_[unit] = free_slot;
+        taken[free_slot] = true;
+        this->record_.units[free_slot] = FanUnitRecord{};
+        this->record_.unit_keys[free_slot] = keys[unit];
+        this->record_dirty_ = true;
+    }
+}
+
+bool ZehnderRadio::migrate_legacy_pairing() {
+    // Single-fan firmware kept its pairing in a blob of its own; the first fan takes it over
+    FanPairingInfo info;
+    size_t size = sizeof(info);
+    if (this->unit_count_ == 0 || !this->nvs_open_ ||
+        nvs_get_blob(this->nvs_handle_, NVS_PAIRING_KEY, &info, &size) != ESP_OK || size != sizeof(info)) {
+        return false;
+    }
+
+    FanUnitRecord &record = this->record_.units[this->unit_slots_[0]];
+    if (!(record.flags & FAN_RECORD_PAIRED)) {
+        ESP_LOGI(TAG, "Migrating pairing info to the persistent record");
+        record.pairing = info;
+        record.flags = FAN_RECORD_PAIRED;
+    }
+    nvs_erase_key(this->nvs_handle_, NVS_PAIRING_KEY);
+    return true;
+}
+
+void ZehnderRadio::update_unit_record(uint8_t unit, const FanUnitRecord &record, bool urgent) {
+    FanUnitRecord &current = this->record_.units[this->unit_slots_[unit]];
+    if (memcmp(&current, &record, sizeof(FanUnitRecord)) == 0) {
+        return;
+    }
+    current = record;
+    this->schedule_save(urgent);
+}
+
+void ZehnderRadio::schedule_save(bool urgent) {
+    if (urgent) {
+        this->cancel_timeout("save_record");
+        this->save_record();
+        return;
+    }
+    // The first change arms the timeout and later ones join the same write,
+    // so a steady stream of changes still reaches flash every 30 s
+    if (!this->record_dirty_) {
+        this->set_timeout("save_record", FAN_RECORD_WRITE_DELAY_MS, [this]() { this->save_record(); });
+    }
+    this->record_dirty_ = true;
+}
+
+void ZehnderRadio::save_record() {
+    this->record_dirty_ = false;
+    if (!this->nvs_open_) {
+        return;
+    }
+
+    this->record_.version = FAN_RECORD_VERSION;
+    this->record_.crc = crc16(reinterpret_cast<const uint8_t *>(&this->record_), offsetof(FanPersistentRecord, crc));
+
+    esp_err_t err = nvs_set_blob(this->nvs_handle_, this->record_key_, &this->record_, sizeof(FanPersistentRecord));
+    if (err == ESP_OK) {
+        err = nvs_commit(this->nvs_handle_);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) writing persistent record to NVS!", esp_err_to_name(err));
+    } else {
+        ESP_LOGD(TAG, "Persistent record saved to NVS");
+    }
+}
+
+void ZehnderRadio::register_unit(ZehnderFanComponent *unit) {
+    if (this->unit_count_ >= FAN_MAX_UNITS) {
+        return;
+    }
+    unit->set_unit(this->unit_count_);
+    this->units_[this->unit_count_++] = unit;
+}
+
+void ZehnderFanComponent::setup() {
+    this->restore_state();
+    // Confirm the restored state soon after boot
+    this->reset_status_interval();
+}
+
+void ZehnderFanComponent::restore_state() {
+    const FanUnitRecord &record = this->parent_->get_unit_record(this->unit_);
+    if (!(record.flags & FAN_RECORD_PAIRED)) {
+        ESP_LOGW(TAG, "No pairing info found. Fan needs to be paired.");
+        return;
+    }
+    this->pairing_info_ = record.pairing;
+    ESP_LOGI(TAG, "Loaded pairing info: Network ID 0x%08" PRIX32 ", Fan ID 0x%02X, My Device ID 0x%02X",
+             record.pairing.network_id, record.pairing.main_unit_id, record.pairing.my_device_id);
+
+    if (record.flags & FAN_RECORD_SPEED_VALID) {
+        // Show the last confirmed speed right away instead of "off" until the next change
+        int level = from_fan_speed(record.fan_speed);
+        this->confirmed_fan_speed_ = record.fan_speed;
+        this->pending_fan_state_ = level > 0;
+        if (level > 0) {
+            this->pending_fan_speed_ = level;
+        }
+        this->state = this->pending_fan_state_;
+        this->speed = this->pending_fan_speed_;
+        this->publish_state();
     }
 }
 
 void ZehnderFanComponent::update() {
-    // Required by PollingComponent, but not needed for this implementation
+    // Reads the state back from the fan, so changes made by a wall remote, a
+    // timer or a power cycle show up even when nothing was overheard
+    if (!this->pairing_info_.has_value() || this->component_state_ != ComponentOperationState::IDLE) {
+        return;
+    }
+    if (millis() - this->last_status_query_ < this->status_interval_ms_) {
+        return;
+    }
+    this->last_status_query_ = millis();
+    this->command_queue_.push(FanCommand{FanCommandType::QUERY_STATUS, false, 0, 0});
+    this->dispatch_next_command();
+}
+
+void ZehnderFanComponent::reset_status_interval() {
+    this->status_interval_ms_ = this->min_status_interval_ms_;
+    this->last_status_query_ = millis();
+}
+
+void ZehnderFanComponent::backoff_status_interval() {
+    this->status_interval_ms_ = std::min(this->status_interval_ms_ * 2, this->max_status_interval_ms_);
 }
 
 void ZehnderFanComponent::dump_config() {
     ESP_LOGCONFIG(TAG, "Zehnder Fan Component:");
-    LOG_PIN("  GDO0 Pin: ", this->gdo0_pin_);
-    LOG_PIN("  GDO2 Pin: ", this->gdo2_pin_);
+    ESP_LOGCONFIG(TAG, "  Unit: %u", this->unit_);
     if (this->pairing_info_.has_value()) {
         ESP_LOGCONFIG(TAG, "  Paired Network ID: 0x%08X", this->pairing_info_->network_id);
         ESP_LOGCONFIG(TAG, "  Paired Fan ID: 0x%02X", this->pairing_info_->main_unit_id);
+        ESP_LOGCONFIG(TAG, "  Status Interval: %" PRIu32 "-%" PRIu32 " s (now %" PRIu32 " s)",
+                      this->min_status_interval_ms_ / 1000, this->max_status_interval_ms_ / 1000,
+                      this->status_interval_ms_ / 1000);
     } else {
         ESP_LOGCONFIG(TAG, "  Device is not paired.");
     }
+#ifdef USE_SELECT
+    LOG_SELECT("  ", "Pairing Select", this->pairing_select_);
+#endif
 }
 
 fan::FanTraits ZehnderFanComponent::get_traits() {
@@ -545,171 +1453,298 @@ fan::FanTraits ZehnderFanComponent::get_traits() {
 void ZehnderFanComponent::control(const fan::FanCall &call) {
     if (!this->pairing_info_.has_value()) {
         ESP_LOGE(TAG, "Cannot control fan: Not paired.");
-        return;
-    }
-    
-    // Check if radio is busy
-    if (this->component_state_ != ComponentOperationState::IDLE) {
-        ESP_LOGW(TAG, "Cannot control fan: Radio operation in progress, ignoring request.");
+        this->report_command(FanOperationOutcome::REJECTED, 0, 0);
         return;
     }
 
-    // Store pending state changes
     if (call.get_state().has_value()) {
         this->pending_fan_state_ = *call.get_state();
-        this->pending_state_change_ = true;
     }
     if (call.get_speed().has_value()) {
         this->pending_fan_speed_ = *call.get_speed();
-        this->pending_state_change_ = true;
     }
 
-    uint8_t fan_speed = FAN_SPEED_AUTO; // Off
-    if (this->pending_fan_state_) {
-        switch (this->pending_fan_speed_) {
-            case 1: fan_speed = FAN_SPEED_LOW; break;
-            case 2: fan_speed = FAN_SPEED_MEDIUM; break;
-            case 3: fan_speed = FAN_SPEED_HIGH; break;
-            case 4: fan_speed = FAN_SPEED_MAX; break;
-        }
+    ESP_LOGD(TAG, "Requesting fan speed level %d", this->pending_fan_speed_);
+
+    FanCommand command{FanCommandType::SET_SPEED, this->pending_fan_state_, this->pending_fan_speed_, 0};
+    bool replaced = false;
+    if (!this->command_queue_.push(command, &replaced)) {
+        ESP_LOGW(TAG, "Cannot control fan: Command queue full, ignoring request.");
+        this->report_command(FanOperationOutcome::REJECTED, 0, 0);
+        return;
     }
-    
-    // For now, timer is not implemented via Home Assistant fan model. Could be a separate service.
-    uint8_t timer = 0; 
-    
-    ESP_LOGD(TAG, "Setting fan speed to level %d", this->pending_fan_speed_);
-    
-    // Start async operation
-    this->component_state_ = ComponentOperationState::SETTING_SPEED;
-    this->fan_protocol_->start_set_speed(this->pairing_info_.value(), fan_speed, timer);
+    if (replaced) {
+        // The older setpoint never went out
+        this->report_command(FanOperationOutcome::PREEMPTED, 0, 0);
+    }
+    this->dispatch_next_command();
 }
 
 void ZehnderFanComponent::start_pairing() {
     ESP_LOGI(TAG, "Pairing service called. Attempting to discover and pair with fan...");
-    
-    // Check if radio is busy
-    if (this->component_state_ != ComponentOperationState::IDLE) {
-        ESP_LOGW(TAG, "Cannot start pairing: Radio operation in progress.");
+
+    if (!this->command_queue_.push(FanCommand{FanCommandType::PAIR, false, 0, 0})) {
+        ESP_LOGW(TAG, "Cannot start pairing: Command queue full.");
         return;
     }
-    
-    // Start async pairing operation
-    this->component_state_ = ComponentOperationState::PAIRING;
-    this->fan_protocol_->start_pairing();
+    this->dispatch_next_command();
+}
+
+#ifdef USE_SELECT
+void ZehnderFanComponent::select_pairing_candidate(const std::string &label) {
+    for (uint8_t i = 0; i < this->pairing_candidate_count_; i++) {
+        if (format_candidate(this->pairing_candidates_[i]) != label) {
+            continue;
+        }
+        ESP_LOGI(TAG, "Joining fan unit ID 0x%02X selected for pairing", this->pairing_candidates_[i].info.main_unit_id);
+        if (!this->command_queue_.push(FanCommand{FanCommandType::JOIN, false, 0, i})) {
+            ESP_LOGW(TAG, "Cannot start pairing: Command queue full.");
+            return;
+        }
+        this->dispatch_next_command();
+        return;
+    }
+    ESP_LOGW(TAG, "Unknown pairing candidate '%s'", label.c_str());
+}
+
+void ZehnderPairingSelect::control(const std::string &value) {
+    if (value != FAN_PAIRING_SELECT_NONE) {
+        this->parent_->select_pairing_candidate(value);
+    }
 }
+#endif
+
+void ZehnderFanComponent::dispatch_next_command() {
+    auto on_complete = [this](const FanOperationResult &result) { this->handle_operation_complete(result); };
+    FanCommand command;
+    while (this->component_state_ == ComponentOperationState::IDLE && this->command_queue_.pop(command)) {
+        this->active_command_ = command;
+        if (command.type == FanCommandType::PAIR) {
+            this->component_state_ = ComponentOperationState::PAIRING;
+            // With a select the user picks among several units, otherwise the strongest is joined
+#ifdef USE_SELECT
+            bool auto_join = this->pairing_select_ == nullptr;
+#else
+            bool auto_join = true;
+#endif
+            this->parent_->start_pairing(this->unit_, auto_join, on_complete);
+            return;
+        }
+        if (command.type == FanCommandType::JOIN) {
+            this->component_state_ = ComponentOperationState::PAIRING;
+            this->parent_->start_pairing_join(this->unit_, this->pairing_candidates_[command.candidate].info,
+                                              on_complete);
+            return;
+        }
+
+        if (!this->pairing_info_.has_value()) {
+            ESP_LOGW(TAG, "Dropping fan command: Not paired.");
+            if (command.type == FanCommandType::SET_SPEED) {
+                this->report_command(FanOperationOutcome::REJECTED, 0, 0);
+            }
+            continue;
+        }
 
-void ZehnderFanComponent::handle_operation_complete() {
-    bool success = this->fan_protocol_->last_operation_successful();
+        if (command.type == FanCommandType::QUERY_STATUS) {
+            this->component_state_ = ComponentOperationState::QUERYING;
+            this->parent_->start_query_status(this->unit_, this->pairing_info_.value(), on_complete);
+            return;
+        }
+
+        uint8_t fan_speed = to_fan_speed(command.state, command.speed);
+        if (this->confirmed_fan_speed_ == fan_speed) {
+            // Fan already runs at this setpoint, nothing to transmit
+            ESP_LOGD(TAG, "Fan already at requested speed, not sending.");
+            this->state = command.state;
+            this->speed = command.speed;
+            this->publish_state();
+            this->report_command(FanOperationOutcome::ACKED, 0, 0);
+            continue;
+        }
+
+        // For now, timer is not implemented via Home Assistant fan model. Could be a separate service.
+        uint8_t timer = 0;
+
+        ESP_LOGD(TAG, "Setting fan speed to level %d", command.speed);
+        this->component_state_ = ComponentOperationState::SETTING_SPEED;
+        this->parent_->start_set_speed(this->unit_, this->pairing_info_.value(), fan_speed, timer, on_complete);
+    }
+}
+
+void ZehnderFanComponent::handle_operation_complete(const FanOperationResult &result) {
+    bool success = result.outcome == FanOperationOutcome::ACKED;
     
     if (this->component_state_ == ComponentOperationState::SETTING_SPEED) {
         if (success) {
-            // Apply the pending state changes
-            if (this->pending_state_change_) {
-                this->state = this->pending_fan_state_;
-                this->speed = this->pending_fan_speed_;
-                this->pending_state_change_ = false;
-                this->publish_state();
-                ESP_LOGD(TAG, "Fan speed set successfully");
-            }
+            this->confirmed_fan_speed_ = to_fan_speed(this->active_command_.state, this->active_command_.speed);
+            this->save_fan_speed(*this->confirmed_fan_speed_);
+            this->state = this->active_command_.state;
+            this->speed = this->active_command_.speed;
+            this->publish_state();
+            this->reset_status_interval();
+            ESP_LOGD(TAG, "Fan speed set successfully");
         } else {
             ESP_LOGW(TAG, "Failed to set fan speed");
         }
+        this->report_command(result.outcome, result.retries, result.elapsed_ms);
+
+    } else if (this->component_state_ == ComponentOperationState::QUERYING) {
+        if (result.status.has_value()) {
+            this->handle_status(result.status.value());
+        } else {
+            // Unit out of reach or busy: no point asking again at full rate
+            ESP_LOGD(TAG, "No status reply from fan");
+            this->backoff_status_interval();
+        }
         
     } else if (this->component_state_ == ComponentOperationState::PAIRING) {
-        if (success) {
-            auto result = this->fan_protocol_->get_pairing_result();
-            if (result.has_value()) {
-                this->save_pairing_info(result.value());
-                this->load_pairing_info(); // Reload into component state
-                ESP_LOGI(TAG, "Pairing successful and info saved to flash.");
-            }
+        if (this->active_command_.type == FanCommandType::PAIR) {
+            std::copy(result.candidates, result.candidates + result.candidate_count, this->pairing_candidates_);
+            this->pairing_candidate_count_ = result.candidate_count;
+        }
+        if (result.pairing.has_value()) {
+            const FanPairingInfo &info = result.pairing.value();
+            this->save_pairing_info(info);
+            ESP_LOGI(TAG, "Pairing successful and info saved to flash.");
+            this->paired_callback_.call(info.network_id, info.main_unit_id);
+        } else if (success) {
+            ESP_LOGI(TAG, "Found %u fan units, choose one in the pairing select.", this->pairing_candidate_count_);
         } else {
             ESP_LOGE(TAG, "Pairing failed.");
         }
+#ifdef USE_SELECT
+        this->publish_pairing_candidates(result.pairing.has_value() ? &result.pairing.value() : nullptr);
+#endif
     }
     
-    // Reset operation state and radio protocol state
     this->component_state_ = ComponentOperationState::IDLE;
-    this->fan_protocol_->reset_operation_state();
+
+    // Continue with whatever was requested in the meantime
+    this->dispatch_next_command();
 }
 
-void ZehnderFanComponent::save_pairing_info(const FanPairingInfo &info) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
-        return;
+void ZehnderFanComponent::report_command(FanOperationOutcome outcome, uint8_t retries, uint32_t elapsed_ms) {
+    if (outcome == FanOperationOutcome::ACKED) {
+        this->command_acked_callback_.call(retries, elapsed_ms);
+    } else {
+        this->command_failed_callback_.call(outcome_to_string(outcome), retries, elapsed_ms);
     }
+}
 
-    err = nvs_set_blob(nvs_handle, NVS_PAIRING_KEY, &info, sizeof(FanPairingInfo));
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) writing pairing info to NVS!", esp_err_to_name(err));
-    } else {
-        err = nvs_commit(nvs_handle);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Error (%s) committing NVS!", esp_err_to_name(err));
-        } else {
-            ESP_LOGD(TAG, "Pairing info saved to NVS successfully.");
+#ifdef USE_SELECT
+void ZehnderFanComponent::publish_pairing_candidates(const FanPairingInfo *joined) {
+    if (this->pairing_select_ == nullptr) {
+        return;
+    }
+    std::vector<std::string> options{FAN_PAIRING_SELECT_NONE};
+    std::string state = FAN_PAIRING_SELECT_NONE;
+    for (uint8_t i = 0; i < this->pairing_candidate_count_; i++) {
+        const PairingCandidate &candidate = this->pairing_candidates_[i];
+        options.push_back(format_candidate(candidate));
+        if (joined != nullptr && joined->network_id == candidate.info.network_id &&
+            joined->main_unit_id == candidate.info.main_unit_id) {
+            state = options.back();
         }
     }
-
-    nvs_close(nvs_handle);
+    this->pairing_select_->traits.set_options(options);
+    this->pairing_select_->publish_state(state);
 }
+#endif
 
-bool ZehnderFanComponent::load_pairing_info() {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Error (%s) opening NVS handle for reading!", esp_err_to_name(err));
-        this->pairing_info_ = std::nullopt;
-        return false;
+void ZehnderFanComponent::handle_overheard_frame(const RxFrame &frame) {
+    if (!this->pairing_info_.has_value()) {
+        return;
+    }
+    const auto &info = this->pairing_info_.value();
+    FrameView view = frame.view();
+
+    // Settings our main unit reports to another remote are as good as a query
+    if (view.is_from(FAN_TYPE_MAIN_UNIT, info.main_unit_id) && view.command() == FAN_TYPE_FAN_SETTINGS) {
+        ESP_LOGD(TAG, "Overheard fan settings, speed %u", view.param(FAN_SETTINGS_SPEED));
+        this->handle_status(FanStatus{view.param(FAN_SETTINGS_SPEED), view.param(FAN_SETTINGS_VOLTAGE),
+                                      view.param(FAN_SETTINGS_TIMER)});
+        this->last_status_query_ = millis();
+        return;
     }
 
-    FanPairingInfo loaded_info;
-    size_t required_size = sizeof(FanPairingInfo);
-    err = nvs_get_blob(nvs_handle, NVS_PAIRING_KEY, &loaded_info, &required_size);
-    nvs_close(nvs_handle);
+    // Only speed commands another device sent to our main unit
+    if (!view.is_to(FAN_TYPE_MAIN_UNIT, info.main_unit_id)) {
+        return;
+    }
+    if (view.is_from(FAN_TYPE_REMOTE_CONTROL, info.my_device_id)) {
+        return;
+    }
+    if (view.command() != FAN_FRAME_SETSPEED && view.command() != FAN_FRAME_SETTIMER) {
+        return;
+    }
 
-    if (err == ESP_OK && required_size == sizeof(FanPairingInfo)) {
-        ESP_LOGI(TAG, "Loaded pairing info: Network ID 0x%08X, Fan ID 0x%02X, My Device ID 0x%02X",
-                 loaded_info.network_id, loaded_info.main_unit_id, loaded_info.my_device_id);
-        this->pairing_info_ = loaded_info;
-        return true;
-    } else {
-        if (err == ESP_ERR_NVS_NOT_FOUND) {
-            ESP_LOGW(TAG, "No pairing info found in NVS. Device is not paired.");
-        } else {
-            ESP_LOGW(TAG, "Error (%s) reading pairing info from NVS!", esp_err_to_name(err));
-        }
-        this->pairing_info_ = std::nullopt;
-        return false;
+    uint8_t fan_speed = view.param(0);
+    if (fan_speed > FAN_SPEED_MAX) {
+        ESP_LOGW(TAG, "Overheard remote 0x%02X setting unknown speed %u", view.src_id(), fan_speed);
+        return;
     }
+    ESP_LOGD(TAG, "Overheard remote 0x%02X setting speed %u", view.src_id(), fan_speed);
+    this->sync_fan_speed(fan_speed);
+    // Something else is controlling the fan; read back what it settles on
+    this->reset_status_interval();
 }
 
-void ZehnderFanComponent::clear_pairing_info() {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle for clearing!", esp_err_to_name(err));
+void ZehnderFanComponent::handle_status(const FanStatus &status) {
+    if (status.speed > FAN_SPEED_MAX) {
+        ESP_LOGW(TAG, "Fan reports unknown speed %u", status.speed);
         return;
     }
-
-    err = nvs_erase_key(nvs_handle, NVS_PAIRING_KEY);
-    if (err == ESP_OK) {
-        err = nvs_commit(nvs_handle);
-        if (err == ESP_OK) {
-            ESP_LOGD(TAG, "Pairing info cleared from NVS successfully.");
-        } else {
-            ESP_LOGE(TAG, "Error (%s) committing NVS after clearing!", esp_err_to_name(err));
-        }
-    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGD(TAG, "No pairing info to clear in NVS.");
+    if (this->sync_fan_speed(status.speed)) {
+        ESP_LOGI(TAG, "Fan speed changed outside Home Assistant, now %u", status.speed);
+        this->reset_status_interval();
     } else {
-        ESP_LOGE(TAG, "Error (%s) clearing pairing info from NVS!", esp_err_to_name(err));
+        this->backoff_status_interval();
+    }
+    if (status.timer_minutes > 0) {
+        // The fan falls back to its previous speed when the timer ends
+        this->status_interval_ms_ = std::min<uint32_t>(this->status_interval_ms_, status.timer_minutes * 60 * 1000U);
     }
+}
 
-    nvs_close(nvs_handle);
+bool ZehnderFanComponent::sync_fan_speed(uint8_t fan_speed) {
+    int level = from_fan_speed(fan_speed);
+    this->confirmed_fan_speed_ = fan_speed;
+    this->save_fan_speed(fan_speed);
+    this->pending_fan_state_ = level > 0;
+    if (level > 0) {
+        this->pending_fan_speed_ = level;
+    }
+    if (this->state == this->pending_fan_state_ && this->speed == this->pending_fan_speed_) {
+        return false;
+    }
+    this->state = this->pending_fan_state_;
+    this->speed = this->pending_fan_speed_;
+    this->publish_state();
+    return true;
+}
+
+void ZehnderFanComponent::save_pairing_info(const FanPairingInfo &info) {
+    // A new pairing invalidates whatever speed the old link confirmed
+    FanUnitRecord record{};
+    record.pairing = info;
+    record.flags = FAN_RECORD_PAIRED;
+    this->parent_->update_unit_record(this->unit_, record, true);
+
+    this->pairing_info_ = info;
+    this->confirmed_fan_speed_.reset();
+}
+
+void ZehnderFanComponent::save_fan_speed(uint8_t fan_speed) {
+    FanUnitRecord record = this->parent_->get_unit_record(this->unit_);
+    record.flags |= FAN_RECORD_SPEED_VALID;
+    record.fan_speed = fan_speed;
+    this->parent_->update_unit_record(this->unit_, record, false);
+}
+
+void ZehnderFanComponent::clear_pairing_info() {
+    this->parent_->update_unit_record(this->unit_, FanUnitRecord{}, true);
     this->pairing_info_ = std::nullopt;
+    this->confirmed_fan_speed_.reset();
 }
 
 } // namespace zehnder_fan
@@ -1,72 +1,73 @@
 #pragma once
 
+#include "esphome/core/defines.h"
+#include "esphome/core/automation.h"
 #include "esphome/core/component.h"
 #include "esphome/core/hal.h"
-#include "esphome/components/spi/spi.h"
+#include "esphome/core/helpers.h"
 #include "esphome/components/fan/fan.h"
-
+#include "nvs.h"
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+#ifdef USE_SELECT
+#include "esphome/components/select/select.h"
+#endif
+#include "fan_frame.h"
+#include "radio.h"
+#include "cc1101_radio.h"
+#include "nrf905_radio.h"
+#include "mock_radio.h"
+#include "ring_buffer.h"
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+#include "capture.h"
+#endif
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#include <atomic>
+#include <functional>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace esphome {
 namespace zehnder_fan {
 
 // Constants extracted from the original fan.h and config.h
-static const uint8_t FAN_FRAMESIZE = 16;
 static const uint8_t FAN_TX_FRAMES = 4;
 static const uint8_t FAN_TX_RETRIES = 50;
-static const uint32_t FAN_REPLY_TIMEOUT_MS = 500;
-static const uint32_t NETWORK_LINK_ID = 0xA55A5AA5;
-
-// CC1101 Command Strobes
-static const uint8_t CC1101_SRES = 0x30;      // Reset chip
-static const uint8_t CC1101_SFSTXON = 0x31;   // Enable and calibrate frequency synthesizer
-static const uint8_t CC1101_SCAL = 0x33;      // Calibrate frequency synthesizer
-static const uint8_t CC1101_SRX = 0x34;       // Enable RX
-static const uint8_t CC1101_STX = 0x35;       // Enable TX
-static const uint8_t CC1101_SIDLE = 0x36;     // Exit RX/TX
-static const uint8_t CC1101_SFRX = 0x3A;      // Flush RX FIFO
-static const uint8_t CC1101_SFTX = 0x3B;      // Flush TX FIFO
-
-// CC1101 Register Access
-static const uint8_t CC1101_WRITE_BURST = 0x40;
-static const uint8_t CC1101_READ_SINGLE = 0x80;
-static const uint8_t CC1101_READ_BURST = 0xC0;
-
-// CC1101 FIFO Access
-static const uint8_t CC1101_TXFIFO = 0x3F;
-static const uint8_t CC1101_RXFIFO = 0x3F;
-
-// CC1101 Status Registers
-static const uint8_t CC1101_RXBYTES = 0x3B;
-static const uint8_t CC1101_MARCSTATE = 0x35;
-
-// CC1101 Configuration Registers
-static const uint8_t CC1101_IOCFG2 = 0x00;  // Configuration register start address
-
-// Fan device types and commands
-enum {
-    FAN_TYPE_BROADCAST = 0x00,
-    FAN_TYPE_MAIN_UNIT = 0x01,
-    FAN_TYPE_REMOTE_CONTROL = 0x03,
-};
-enum {
-    FAN_FRAME_SETSPEED = 0x02,
-    FAN_FRAME_SETTIMER = 0x03,
-    FAN_NETWORK_JOIN_REQUEST = 0x04,
-    FAN_FRAME_SETSPEED_REPLY = 0x05,
-    FAN_NETWORK_JOIN_OPEN = 0x06,
-    FAN_TYPE_FAN_SETTINGS = 0x07,
-    FAN_FRAME_0B = 0x0B,
-    FAN_NETWORK_JOIN_ACK = 0x0C,
-};
-enum {
-    FAN_SPEED_AUTO = 0x00,
-    FAN_SPEED_LOW = 0x01,
-    FAN_SPEED_MEDIUM = 0x02,
-    FAN_SPEED_HIGH = 0x03,
-    FAN_SPEED_MAX = 0x04,
-};
-
+static const uint8_t FAN_QUERY_RETRIES = 3;              // Status queries are repeated later rather than retried hard
+static const uint32_t FAN_REPLY_TIMEOUT_MS = 500;        // Reply timeout before any RTT was measured
+static const uint32_t FAN_MIN_REPLY_TIMEOUT_MS = 40;
+static const uint32_t FAN_MAX_REPLY_TIMEOUT_MS = 2000;
+static const uint8_t FAN_MAX_BACKOFF_SHIFT = 4;          // Reply timeout doubles per retry, at most 16x
+static const uint32_t FAN_OPERATION_TIMEOUT_MS = 10000;  // Default overall deadline per operation
+static const uint8_t FAN_MAX_UNITS = 4;                  // Fan entities sharing one radio
+static const uint8_t FAN_MAX_PEERS = FAN_MAX_UNITS + 1;  // Peers with their own RTT estimate, incl. the pairing link
+static const uint8_t FAN_COMMAND_QUEUE_SIZE = 4;
+
+static const uint32_t FAN_RADIO_STATE_TIMEOUT_MS = 20;  // Longest a strobe may take to reach its target state
+static const uint32_t FAN_CCA_DECISION_US = 1000;  // Margin on top of the RX->TX turnaround before judging CCA
+static const uint32_t FAN_CCA_BACKOFF_MS = 8;      // Initial random backoff window, doubles per deferral/collision
+static const uint8_t FAN_RXTX_TURNAROUND_BITS = 10;  // RX->TX switch takes ~9.6 bit periods on the CC1101
+static const uint8_t FAN_STATS_WINDOW = 64;  // Operations kept for the time-to-ack percentiles
+static const uint32_t FAN_CALIBRATION_INTERVAL_MS = 10 * 60 * 1000;  // Default synthesizer recalibration period
+static const uint32_t FAN_MIN_STATUS_INTERVAL_MS = 5 * 1000;         // Status query delay right after a change
+static const uint32_t FAN_DISCOVERY_LISTEN_MS = 250;   // Listening time after each discovery frame
+static const uint32_t FAN_DISCOVERY_COLLECT_MS = 1000;  // Further listening once the first unit answered
+static const uint8_t FAN_MAX_PAIRING_CANDIDATES = 4;
+static const uint32_t FAN_MAX_STATUS_INTERVAL_MS = 15 * 60 * 1000;   // Status query delay once nothing changes
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+static const uint32_t FAN_RADIO_TASK_STACK_SIZE = 4096;
+static const UBaseType_t FAN_RADIO_TASK_PRIORITY = 5;  // Above the main loop (1) and the network stack
+// Each unit has at most one operation in flight, so these two never fill up
+static const size_t FAN_RADIO_COMMAND_QUEUE_SIZE = 2 * FAN_MAX_UNITS;
+static const size_t FAN_RADIO_COMPLETION_QUEUE_SIZE = 2 * FAN_MAX_UNITS;
+static const size_t FAN_RADIO_EVENT_QUEUE_SIZE = 16;  // Overheard frames and radio state; may drop
+#endif
 
 struct FanPairingInfo {
     uint32_t network_id;
@@ -75,53 +76,144 @@ struct FanPairingInfo {
     uint8_t my_device_id;
 };
 
-// =========================================================================
-// 1. Low-Level CC1101 Radio Controller
-// =========================================================================
-class CC1101Controller : public spi::SPIDevice<spi::BIT_ORDER_MSB_FIRST,
-                                               spi::CLOCK_POLARITY_LOW,
-                                               spi::CLOCK_PHASE_LEADING,
-                                               spi::DATA_RATE_4MHZ> {
-public:
-    void setup_pins(GPIOPin *gdo0_pin, GPIOPin *gdo2_pin);
-    void set_cs_pin(GPIOPin *cs_pin) { this->cs_ = cs_pin; }
-    bool init();
-    
-    void set_mode_idle();
-    void set_mode_receive();
-    void set_mode_transmit();
+// A main unit that answered pairing discovery with JOIN_OPEN
+struct PairingCandidate {
+    FanPairingInfo info;
+    float rssi_dbm;  // Strongest reception of its JOIN_OPEN
+};
 
-    void set_tx_address(uint32_t address);
-    void set_rx_address(uint32_t address);
+// Settings the main unit reports in FAN_TYPE_FAN_SETTINGS
+struct FanStatus {
+    uint8_t speed;
+    uint8_t voltage;
+    uint8_t timer_minutes;  // Remaining timer, 0 when no timer runs
+};
 
-    void write_tx_payload(const uint8_t *payload, size_t size);
-    bool read_rx_payload(uint8_t *buffer, size_t size);
+// How an operation ended. The fan protocol has no negative reply, so the
+// unit itself never rejects: REJECTED and PREEMPTED are reported by the
+// component for commands it could not send, or that a newer command of the
+// same kind replaced while they were queued.
+enum class FanOperationOutcome : uint8_t {
+    ACKED,
+    TIMED_OUT,
+    REJECTED,
+    PREEMPTED
+};
 
-    bool is_data_ready() { return this->gdo0_pin_->digital_read(); }
+// Passed to the completion callback of an operation. The result data is a
+// copy; the operation slot is free again by the time the callback runs.
+struct FanOperationResult {
+    FanOperationOutcome outcome;
+    uint8_t retries;      // Retransmissions of the last frame of the exchange
+    uint32_t elapsed_ms;  // From start_*() to completion
+    std::optional<FanStatus> status;          // Successful status query
+    std::optional<FanPairingInfo> pairing;    // Successful pairing
+    uint8_t candidate_count;                  // Units found by pairing discovery
+    PairingCandidate candidates[FAN_MAX_PAIRING_CANDIDATES];
+};
 
-private:
-    void reset();
-    void write_register(uint8_t reg, uint8_t value);
-    uint8_t read_register(uint8_t reg);
-    void write_burst_register(uint8_t reg, const uint8_t *buffer, size_t len);
-    void send_strobe(uint8_t strobe);
-    void flush_rx();
-    void flush_tx();
-    void configure_868mhz();
-    void set_address(uint32_t address);  // Helper for setting address register
-    
-    GPIOPin *gdo0_pin_{nullptr};
-    GPIOPin *gdo2_pin_{nullptr};
+using FanCompletionCallback = std::function<void(const FanOperationResult &)>;
+
+// Persistent state, kept as one CRC-checked NVS blob for the whole radio so
+// boot needs a single read. Bump FAN_RECORD_VERSION when the layout changes.
+static const uint8_t FAN_RECORD_VERSION = 1;
+static const uint32_t FAN_RECORD_WRITE_DELAY_MS = 30000;  // Speed changes are coalesced before writing flash
+
+enum : uint8_t {
+    FAN_RECORD_PAIRED = 1 << 0,
+    FAN_RECORD_SPEED_VALID = 1 << 1,
+};
+
+struct FanUnitRecord {
+    FanPairingInfo pairing;
+    uint8_t flags;
+    uint8_t fan_speed;  // Last speed code the fan confirmed; AUTO means off
+};
+
+struct FanPersistentRecord {
+    uint8_t version;
+    FanUnitRecord units[FAN_MAX_UNITS];
+    uint32_t unit_keys[FAN_MAX_UNITS];  // Object id hash of the fan owning each slot, 0 while unclaimed
+    FanCalibrationRecord calibration;
+    uint32_t radio_config;  // get_config_hash() of the radio the calibration was taken with
+    uint16_t crc;  // Over all bytes before this field
 };
 
+// The radio backend is fixed at compile time, so the protocol calls the
+// driver directly instead of through a vtable
+#if defined(USE_ZEHNDER_FAN_NRF905)
+using FanRadio = NRF905Controller;
+#elif defined(USE_ZEHNDER_FAN_MOCK)
+using FanRadio = MockRadio;
+#elif defined(USE_ZEHNDER_FAN_CC1101)
+using FanRadio = CC1101Controller;
+#else
+#error "No zehnder_fan radio backend selected"
+#endif
 
 // =========================================================================
-// 2. High-Level Fan Communication Protocol
+// High-Level Fan Communication Protocol
 // =========================================================================
 
+// Smoothed round-trip time and variance for one peer (Jacobson/Karels, RFC 6298).
+// Kept in fixed point: srtt is scaled by 8 and rttvar by 4.
+class RttEstimator {
+public:
+    void add_sample(uint32_t rtt_ms);
+    // srtt + 4 * rttvar, clamped; FAN_REPLY_TIMEOUT_MS until the first sample
+    uint32_t get_timeout_ms() const;
+    bool has_samples() const { return this->samples_ > 0; }
+    uint32_t get_srtt_ms() const { return this->srtt_x8_ >> 3; }
+
+protected:
+    uint32_t srtt_x8_{0};
+    uint32_t rttvar_x4_{0};
+    uint32_t samples_{0};
+};
+
+// Outcome of the operations of one kind: success rate, time from start to
+// acknowledgement and radio usage. Lets protocol changes be judged on numbers
+// taken from the real link.
+class OperationStats {
+public:
+    void record(bool success, uint32_t time_to_ack_ms, uint32_t frames, uint32_t airtime_us);
+    void add_deferral() { this->deferrals_++; }
+    void add_collision() { this->collisions_++; }
+    // Percentile of the time to ack over the last FAN_STATS_WINDOW successful operations
+    uint32_t get_time_to_ack_ms(uint8_t percentile) const;
+    void log(const char *name) const;
+
+protected:
+    uint32_t time_to_ack_ms_[FAN_STATS_WINDOW]{};
+    uint32_t acked_{0};
+    uint32_t operations_{0};
+    uint32_t frames_{0};
+    uint64_t airtime_us_{0};
+    uint32_t deferrals_{0};
+    uint32_t collisions_{0};
+};
+
+enum FanStatsKind : uint8_t {
+    FAN_STATS_SET_SPEED,
+    FAN_STATS_PAIRING,
+    FAN_STATS_QUERY,
+    FAN_STATS_KINDS,
+};
+
+struct PeerLink {
+    uint32_t network_id;
+    uint8_t unit_id;
+    bool in_use;
+    RttEstimator rtt;
+};
+
 enum class RadioOperationState {
     IDLE,
-    TRANSMITTING,
+    QUEUED,            // Waiting for its turn on the shared radio
+    PREPARING_TX,      // Waiting for the radio to reach IDLE before loading the TX FIFO
+    CARRIER_SENSE,     // In RX with the frame loaded, letting RSSI settle for clear channel assessment
+    CHANNEL_CHECK,     // STX issued, checking whether CCA let it through
+    TRANSMITTING,      // Frame on the air, waiting for it to finish
     WAITING_RESPONSE,
     OPERATION_COMPLETE
 };
@@ -129,6 +221,7 @@ enum class RadioOperationState {
 enum class RadioOperationType {
     NONE,
     SET_SPEED,
+    QUERY_STATUS,
     PAIRING_DISCOVER,
     PAIRING_JOIN,
     PAIRING_ACK
@@ -137,11 +230,22 @@ enum class RadioOperationType {
 struct PendingOperation {
     RadioOperationType type;
     RadioOperationState state;
-    uint32_t start_time;
+    bool success;            // Result, valid once state is OPERATION_COMPLETE
+    uint32_t link_id;        // Network ID the radio addresses for this operation
+    uint32_t start_time;     // millis() when the current state was entered
+    uint32_t start_time_us;  // micros() when the current state was entered
+    uint32_t not_before;     // millis() before which a queued attempt must not start (backoff)
+    uint8_t cca_deferrals;   // Attempts the channel was busy for
+    uint32_t crc_errors_at_tx;  // Radio CRC error count when the frame went out
+    uint32_t frames_sent;    // Frames that actually went on the air
     uint8_t retry_count;
     uint8_t max_retries;
-    uint32_t timeout_ms;
+    uint32_t timeout_ms;     // Reply timeout of the current attempt
+    uint32_t op_start_time;  // millis() when the operation was started, for the overall deadline
+    uint32_t tx_time_us;     // micros() when the current frame finished transmitting
+    RttEstimator *rtt;       // Estimator of the peer this operation talks to
     uint8_t tx_payload[FAN_FRAMESIZE];
+    SpiStats spi_at_start;  // Driver cost snapshot taken when the operation began
     
     // Operation-specific data
     union {
@@ -150,109 +254,497 @@ struct PendingOperation {
             uint8_t speed;
             uint8_t timer_minutes;
         } set_speed;
+
+        struct {
+            FanPairingInfo pairing_info;
+            FanStatus status;
+        } query;
         
         struct {
             uint8_t my_device_id;
             FanPairingInfo current_info;
-            uint8_t pairing_step; // 0=discover, 1=join, 2=ack
+            bool auto_join;          // Join the strongest candidate instead of leaving the choice to the user
+            uint32_t collect_until;  // millis() at which discovery stops waiting for more candidates
+            uint8_t candidate_count;
+            PairingCandidate candidates[FAN_MAX_PAIRING_CANDIDATES];
         } pairing;
     } data;
 };
 
-class ZehnderFanProtocol {
-public:
-    ZehnderFanProtocol(CC1101Controller *radio);
+// Runs one operation per unit on a single shared radio. Operations only hold
+// the radio for one attempt (transmit + reply window); a retry goes back into
+// the queue, and queued operations are served round-robin so the retries of one
+// unit cannot starve the others. Radio is one of the backends described in
+// radio.h.
+template<typename Radio> class ZehnderFanProtocol {
+    static_assert(std::is_same<decltype(std::declval<Radio &>().get_state()), RadioState>::value,
+                  "Radio backends report the protocol-level RadioState");
 
-    // Async interface - returns immediately
-    void start_pairing();
-    void start_set_speed(const FanPairingInfo &pairing_info, uint8_t speed, uint8_t timer_minutes);
+public:
+    ZehnderFanProtocol(Radio *radio);
+
+    // Async interface - returns immediately. on_complete is called once from
+    // process() when the operation has ended; it may start the next one.
+    // Discovers the main units that are open for pairing. With auto_join the
+    // strongest one is joined; otherwise a single candidate is joined and
+    // several are left to start_pairing_join().
+    void start_pairing(uint8_t unit, bool auto_join, FanCompletionCallback &&on_complete);
+    void start_pairing_join(uint8_t unit, const FanPairingInfo &candidate, FanCompletionCallback &&on_complete);
+    void start_set_speed(uint8_t unit, const FanPairingInfo &pairing_info, uint8_t speed, uint8_t timer_minutes,
+                         FanCompletionCallback &&on_complete);
+    void start_query_status(uint8_t unit, const FanPairingInfo &pairing_info, FanCompletionCallback &&on_complete);
     
     // Process state machine - call from loop()
     void process();
     
-    // Check if operation is complete
-    bool is_operation_complete() const { return pending_op_.state == RadioOperationState::OPERATION_COMPLETE; }
-    bool last_operation_successful() const { return last_operation_success_; }
-    
-    // Reset state machine for next operation
-    void reset_operation_state();
-    
-    // Get pairing result if available
-    std::optional<FanPairingInfo> get_pairing_result();
+    // True while any unit has an operation running or the radio calibrates
+    bool is_busy() const;
+    // Time until process() has work without a new operation: 0 while busy or
+    // listening, otherwise the time until the next synthesizer recalibration
+    uint32_t get_idle_time_ms() const;
+
+    // Overall deadline for one operation including all retries
+    void set_operation_timeout(uint32_t timeout_ms) { operation_timeout_ms_ = timeout_ms; }
+
+    // Keep the radio in RX between operations and pass every frame heard there
+    // to the listener
+    void set_listen(bool listen) { listen_ = listen; }
+    // Synthesizer recalibration period; a failed operation also triggers one
+    void set_calibration_interval(uint32_t interval_ms) { calibration_interval_ms_ = interval_ms; }
+
+    // Listen with the radio's Wake-on-Radio polling instead of full RX
+    void set_wake_on_radio(bool wake_on_radio) { wake_on_radio_ = wake_on_radio; }
+    void set_frame_listener(std::function<void(const RxFrame &)> &&listener) { frame_listener_ = std::move(listener); }
+
+    // Logs success rate, p50/p99 time to ack and airtime per kind of operation
+    void log_stats() const;
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+    // Logs the captured frames, oldest first, one hex encoded FanCaptureRecord per line
+    void dump_capture() const;
+#endif
 
 private:
-    void start_transmit();
-    void handle_response();
-    void retry_or_fail();
-    void complete_operation(bool success);
+    void init_operation(PendingOperation &op, RadioOperationType type, FanCompletionCallback &&on_complete);
+    bool process_calibration();
+    void process_listen();
+    // Pops the next received frame into rx_frame_ and captures it
+    bool pop_rx_frame();
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+    void capture_frame(FanCaptureDirection direction, const uint8_t *data, const uint8_t *status,
+                       uint32_t timestamp_us);
+#endif
+    PendingOperation *next_queued_operation();
+    RttEstimator *get_peer_rtt(uint32_t network_id, uint8_t unit_id);
+    uint32_t backoff_timeout_ms(const PendingOperation &op) const;
+    void set_state(PendingOperation &op, RadioOperationState state);
+    bool state_timed_out(const PendingOperation &op, uint32_t timeout_ms) const {
+        return millis() - op.start_time >= timeout_ms;
+    }
+    bool reply_timed_out(const PendingOperation &op) const {
+        return micros() - op.tx_time_us >= op.timeout_ms * 1000;
+    }
+    void start_transmit(PendingOperation &op);
+    // False for frames that arrive during the reply window but do not answer op
+    bool is_reply(const PendingOperation &op, const FrameView &frame) const;
+    void handle_response(PendingOperation &op);
+    // Frames that arrive outside the reply window are dropped, except JOIN_OPEN during discovery.
+    // With sent, frames that ended after op's frame are kept for the reply window.
+    void discard_stale_frames(PendingOperation &op, bool sent);
+    void process_discovery(PendingOperation &op);
+    void add_pairing_candidate(PendingOperation &op, const RxFrame &frame);
+    void finish_discovery(PendingOperation &op);
+    void retry_or_fail(PendingOperation &op);
+    uint32_t collision_backoff_ms(uint8_t attempts) const;
+    void defer_transmit(PendingOperation &op);
+    OperationStats &stats_for(const PendingOperation &op) {
+        switch (op.type) {
+            case RadioOperationType::SET_SPEED: return stats_[FAN_STATS_SET_SPEED];
+            case RadioOperationType::QUERY_STATUS: return stats_[FAN_STATS_QUERY];
+            default: return stats_[FAN_STATS_PAIRING];
+        }
+    }
+    void complete_operation(PendingOperation &op, bool success);
+    // Frees the slot of a completed operation and reports its result
+    void finish_operation(PendingOperation &op);
     
     // Pairing state machine helpers
-    void setup_pairing_discover();
-    void setup_pairing_join();
-    void setup_pairing_ack();
-    void handle_pairing_response();
+    void setup_pairing_discover(PendingOperation &op);
+    void setup_pairing_join(PendingOperation &op);
+    void setup_pairing_ack(PendingOperation &op);
+    void handle_pairing_response(PendingOperation &op);
     
-    CC1101Controller *radio_;
-    uint8_t rx_buffer_[FAN_FRAMESIZE]{0};
-    PendingOperation pending_op_{};
-    bool last_operation_success_{false};
-    std::optional<FanPairingInfo> pairing_result_;
+    Radio *radio_;
+    RxFrame rx_frame_{};
+    bool rx_frame_held_{false};  // rx_frame_ goes out again with the next pop_rx_frame()
+    PendingOperation ops_[FAN_MAX_UNITS]{};
+    FanCompletionCallback on_complete_[FAN_MAX_UNITS];
+    PendingOperation *active_op_{nullptr};  // Operation currently holding the radio
+    uint8_t last_served_unit_{FAN_MAX_UNITS - 1};
+    PeerLink peers_[FAN_MAX_PEERS]{};
+    OperationStats stats_[FAN_STATS_KINDS];
+    uint8_t next_peer_slot_{0};
+    uint32_t operation_timeout_ms_{FAN_OPERATION_TIMEOUT_MS};
+    bool listen_{false};
+    bool listening_{false};
+    bool wake_on_radio_{false};
+    uint32_t calibration_interval_ms_{FAN_CALIBRATION_INTERVAL_MS};
+    uint32_t last_calibration_{0};
+    uint32_t calibration_start_{0};
+    bool calibrating_{false};
+    bool calibration_requested_{false};
+    std::function<void(const RxFrame &)> frame_listener_;
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+    FanCapture capture_;
+#endif
+};
+
+
+using FanProtocol = ZehnderFanProtocol<FanRadio>;
+
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+// Messages between the main loop and the radio task. They only travel
+// through RingBuffers, one producer and one consumer each, so the two sides
+// share no other state once the task runs.
+enum class RadioCommandType : uint8_t {
+    PAIR,
+    PAIR_JOIN,
+    SET_SPEED,
+    QUERY_STATUS
+};
+
+struct RadioCommand {
+    RadioCommandType type;
+    uint8_t unit;
+    FanPairingInfo pairing_info;  // Paired unit, or the candidate to join
+    uint8_t speed;
+    uint8_t timer_minutes;
+    bool auto_join;
+};
+
+struct RadioCompletion {
+    uint8_t unit;
+    FanOperationResult result;
 };
 
+enum class RadioEventType : uint8_t {
+    FRAME_HEARD,
+    LINK_QUALITY,
+    CALIBRATION
+};
+
+struct RadioEvent {
+    RadioEventType type;
+    union {
+        RxFrame frame;
+        struct {
+            float rssi_dbm;
+            float lqi;
+        } link_quality;
+        FanCalibrationRecord calibration;
+    };
+};
+#endif
 
 // =========================================================================
-// 3. ESPHome Component
+// ESPHome Component
 // =========================================================================
 
 enum class ComponentOperationState {
     IDLE,
     SETTING_SPEED,
+    QUERYING,
     PAIRING
 };
 
-class ZehnderFanComponent : public fan::Fan, public PollingComponent {
+enum class FanCommandType : uint8_t {
+    SET_SPEED,
+    QUERY_STATUS,
+    PAIR,
+    JOIN
+};
+
+struct FanCommand {
+    FanCommandType type;
+    bool state;
+    int speed;          // Fan entity speed level (1-4)
+    uint8_t candidate;  // JOIN: index into the discovered pairing candidates
+};
+
+// Bounded FIFO of commands waiting for the radio. A command replaces a queued
+// one of the same type, so only the latest setpoint is ever transmitted.
+class FanCommandQueue {
+public:
+    // replaced is set when the command took the place of a queued one
+    bool push(const FanCommand &command, bool *replaced = nullptr);
+    bool pop(FanCommand &command);
+    bool empty() const { return this->count_ == 0; }
+
+protected:
+    FanCommand commands_[FAN_COMMAND_QUEUE_SIZE]{};
+    uint8_t head_{0};
+    uint8_t count_{0};
+};
+
+class ZehnderFanComponent;
+
+#ifdef USE_SELECT
+// Lists the main units found by the last pairing discovery; picking one
+// joins it
+class ZehnderPairingSelect : public select::Select {
+public:
+    void set_parent(ZehnderFanComponent *parent) { this->parent_ = parent; }
+
+protected:
+    void control(const std::string &value) override;
+
+    ZehnderFanComponent *parent_;
+};
+#endif
+
+// Owns the radio and the protocol; any number of fan entities (up to
+// FAN_MAX_UNITS) attach to it, each with its own pairing record.
+class ZehnderRadio : public Component {
 public:
     void setup() override;
     void loop() override;
     void dump_config() override;
+    void on_shutdown() override;
+    float get_setup_priority() const override { return setup_priority::HARDWARE; }
+
+    // Backend configuration from YAML, passed straight to the radio
+#if defined(USE_ZEHNDER_FAN_CC1101) || defined(USE_ZEHNDER_FAN_NRF905)
+    void set_cs_pin(GPIOPin *pin) { this->radio_.set_cs_pin(pin); }
+    void set_spi_parent(spi::SPIComponent *parent) { this->radio_.set_spi_parent(parent); }
+#endif
+#ifdef USE_ZEHNDER_FAN_CC1101
+    void set_gdo0_pin(InternalGPIOPin *pin) { this->radio_.set_gdo0_pin(pin); }
+    void set_gdo2_pin(InternalGPIOPin *pin) { this->radio_.set_gdo2_pin(pin); }
+    void set_rx_interrupt(bool rx_interrupt) { this->radio_.set_rx_interrupt(rx_interrupt); }
+    void set_wake_on_radio(uint16_t event0, uint8_t rx_time) {
+        this->wake_on_radio_ = true;
+        this->radio_.set_wake_on_radio(event0, rx_time);
+    }
+#endif
+#ifdef USE_ZEHNDER_FAN_NRF905
+    void set_trx_ce_pin(GPIOPin *pin) { this->radio_.set_trx_ce_pin(pin); }
+    void set_tx_en_pin(GPIOPin *pin) { this->radio_.set_tx_en_pin(pin); }
+    void set_pwr_up_pin(GPIOPin *pin) { this->radio_.set_pwr_up_pin(pin); }
+    void set_dr_pin(GPIOPin *pin) { this->radio_.set_dr_pin(pin); }
+    void set_cd_pin(GPIOPin *pin) { this->radio_.set_cd_pin(pin); }
+#endif
+#ifdef USE_ZEHNDER_FAN_MOCK
+    void set_reply_delay(uint32_t delay_ms) { this->radio_.set_reply_delay(delay_ms); }
+    void set_reply_loss(uint8_t percent) { this->radio_.set_reply_loss(percent); }
+#endif
+    void set_operation_timeout(uint32_t timeout_ms) { this->operation_timeout_ms_ = timeout_ms; }
+    void set_calibration_interval(uint32_t interval_ms) { this->calibration_interval_ms_ = interval_ms; }
+    void set_listen(bool listen) { this->listen_ = listen; }
+#ifdef USE_SENSOR
+    void set_rssi_sensor(sensor::Sensor *sensor) { this->rssi_sensor_ = sensor; }
+    void set_lqi_sensor(sensor::Sensor *sensor) { this->lqi_sensor_ = sensor; }
+#endif
+
+    // Names the NVS key of this radio's record after its id, so several radios
+    // each keep their own pairings
+    void set_record_key(const std::string &id);
+    // Attaches a fan entity before setup(); fan.py limits a radio to FAN_MAX_UNITS
+    void register_unit(ZehnderFanComponent *unit);
+
+    // Operations of the units, as in ZehnderFanProtocol. on_complete always
+    // runs in the main loop, also when the protocol runs in the radio task.
+    void start_pairing(uint8_t unit, bool auto_join, FanCompletionCallback &&on_complete);
+    void start_pairing_join(uint8_t unit, const FanPairingInfo &candidate, FanCompletionCallback &&on_complete);
+    void start_set_speed(uint8_t unit, const FanPairingInfo &pairing_info, uint8_t speed, uint8_t timer_minutes,
+                         FanCompletionCallback &&on_complete);
+    void start_query_status(uint8_t unit, const FanPairingInfo &pairing_info, FanCompletionCallback &&on_complete);
+
+    // Persistent state of one unit, loaded once in setup(). Updates are written
+    // after FAN_RECORD_WRITE_DELAY_MS unless urgent, so bursts of speed
+    // changes end up as a single flash write.
+    const FanUnitRecord &get_unit_record(uint8_t unit) const { return this->record_.units[this->unit_slots_[unit]]; }
+    void update_unit_record(uint8_t unit, const FanUnitRecord &record, bool urgent);
+
+    // Logs the frame capture, wherever the protocol runs
+    void dump_capture();
+
+protected:
+    void load_record();
+    // Gives every unit the record slot of its fan entity, so pairings follow
+    // the fan when others are added, removed or reordered
+    void assign_unit_slots();
+    bool migrate_legacy_pairing();
+    void schedule_save(bool urgent);
+    void save_record();
+    // Picks up link quality and calibration changes; runs wherever the protocol runs
+    void sync_radio_state();
+    void handle_frame(const RxFrame &frame);
+    void handle_link_quality(float rssi_dbm, float lqi);
+    void handle_calibration(const FanCalibrationRecord &calibration);
+
+    FanRadio radio_;
+    std::unique_ptr<FanProtocol> fan_protocol_;
+    uint32_t link_quality_samples_{0};
+    FanCalibrationRecord calibration_seen_{};
+
+#ifdef USE_ZEHNDER_FAN_RADIO_TASK
+    static void radio_task(void *arg);
+    void start_command(const RadioCommand &command, FanCompletionCallback &&on_complete);
+    void process_commands();
+    void post_event(const RadioEvent &event);
+
+    TaskHandle_t radio_task_handle_{nullptr};
+    FanCompletionCallback on_complete_[FAN_MAX_UNITS];  // Main loop side only
+    RingBuffer<RadioCommand, FAN_RADIO_COMMAND_QUEUE_SIZE> commands_;
+    RingBuffer<RadioCompletion, FAN_RADIO_COMPLETION_QUEUE_SIZE> completions_;
+    RingBuffer<RadioEvent, FAN_RADIO_EVENT_QUEUE_SIZE> events_;
+#ifdef USE_ZEHNDER_FAN_CAPTURE
+    std::atomic<bool> capture_dump_requested_{false};
+#endif
+#endif
+
+    uint32_t operation_timeout_ms_{FAN_OPERATION_TIMEOUT_MS};
+    uint32_t calibration_interval_ms_{FAN_CALIBRATION_INTERVAL_MS};
+    bool listen_{false};
+    bool wake_on_radio_{false};
+
+    ZehnderFanComponent *units_[FAN_MAX_UNITS]{};
+    uint8_t unit_count_{0};
+    uint8_t unit_slots_[FAN_MAX_UNITS]{};  // Record slot of each unit
+    HighFrequencyLoopRequester high_freq_;  // Fast loop while a radio operation runs
+
+    nvs_handle_t nvs_handle_{0};
+    bool nvs_open_{false};
+    char record_key_[16]{"record_0"};  // NVS keys hold at most 15 characters
+    FanPersistentRecord record_{};
+    bool record_dirty_{false};
+
+#ifdef USE_SENSOR
+    sensor::Sensor *rssi_sensor_{nullptr};
+    sensor::Sensor *lqi_sensor_{nullptr};
+#endif
+};
+
+class ZehnderFanComponent : public fan::Fan, public PollingComponent {
+public:
+    void setup() override;
+    void dump_config() override;
     void update() override;
+    float get_setup_priority() const override { return setup_priority::DATA; }
 
     fan::FanTraits get_traits() override;
     void control(const fan::FanCall &call) override;
 
     // Service function to initiate pairing
     void start_pairing();
-
-    // Pin Setters from YAML
-    void set_gdo0_pin(GPIOPin *pin) { this->gdo0_pin_ = pin; }
-    void set_gdo2_pin(GPIOPin *pin) { this->gdo2_pin_ = pin; }
-    void set_cs_pin(GPIOPin *pin) { this->cs_pin_ = pin; }
-    void set_spi_parent(spi::SPIComponent *parent) { this->spi_parent_ = parent; }
+#ifdef USE_SELECT
+    void set_pairing_select(ZehnderPairingSelect *select) { this->pairing_select_ = select; }
+    // Joins the discovered unit shown as label in the pairing select
+    void select_pairing_candidate(const std::string &label);
+#endif
+
+    void set_parent(ZehnderRadio *parent) { this->parent_ = parent; }
+    void set_unit(uint8_t unit) { this->unit_ = unit; }
+    // Bounds of the adaptive status query interval
+    void set_status_interval(uint32_t min_ms, uint32_t max_ms) {
+        this->min_status_interval_ms_ = min_ms;
+        this->max_status_interval_ms_ = max_ms;
+    }
+
+    // Speed commands end in exactly one of acked or failed; failed carries
+    // the reason ("timed_out", "rejected" or "preempted")
+    void add_on_command_acked_callback(std::function<void(uint8_t, uint32_t)> &&callback) {
+        this->command_acked_callback_.add(std::move(callback));
+    }
+    void add_on_command_failed_callback(std::function<void(std::string, uint8_t, uint32_t)> &&callback) {
+        this->command_failed_callback_.add(std::move(callback));
+    }
+    void add_on_paired_callback(std::function<void(uint32_t, uint8_t)> &&callback) {
+        this->paired_callback_.add(std::move(callback));
+    }
+
+    // Called by the radio for frames overheard while listening
+    void handle_overheard_frame(const RxFrame &frame);
 
 protected:
+    void restore_state();
     void save_pairing_info(const FanPairingInfo &info);
-    bool load_pairing_info();
+    void save_fan_speed(uint8_t fan_speed);
     void clear_pairing_info();
+    // Takes a speed the fan reported or was heard to accept, returns true if it differs from the published state
+    bool sync_fan_speed(uint8_t fan_speed);
+    void handle_status(const FanStatus &status);
+    // Query again soon after a change; back off while the fan reports nothing new
+    void reset_status_interval();
+    void backoff_status_interval();
+#ifdef USE_SELECT
+    void publish_pairing_candidates(const FanPairingInfo *joined);
+#endif
     
-    void handle_operation_complete();
+    void dispatch_next_command();
+    // Completion callback of every operation this unit starts
+    void handle_operation_complete(const FanOperationResult &result);
+    // Fires on_command_acked or on_command_failed for a speed command
+    void report_command(FanOperationOutcome outcome, uint8_t retries, uint32_t elapsed_ms);
 
-    CC1101Controller cc1101_radio_;
-    std::unique_ptr<ZehnderFanProtocol> fan_protocol_;
-    
-    // Pins from YAML
-    GPIOPin *gdo0_pin_;
-    GPIOPin *gdo2_pin_;
-    GPIOPin *cs_pin_;
-    spi::SPIComponent *spi_parent_;
+    ZehnderRadio *parent_;
+    uint8_t unit_{0};
 
     std::optional<FanPairingInfo> pairing_info_;
     ComponentOperationState component_state_{ComponentOperationState::IDLE};
     
-    // Pending fan call data
-    bool pending_state_change_{false};
+    // Latest requested fan state, used to complete partial fan calls
     bool pending_fan_state_{false};
     int pending_fan_speed_{1};
+
+    FanCommandQueue command_queue_;
+    FanCommand active_command_{};
+    std::optional<uint8_t> confirmed_fan_speed_;  // Last speed the fan acknowledged
+
+    uint32_t min_status_interval_ms_{FAN_MIN_STATUS_INTERVAL_MS};
+    uint32_t max_status_interval_ms_{FAN_MAX_STATUS_INTERVAL_MS};
+    uint32_t status_interval_ms_{FAN_MIN_STATUS_INTERVAL_MS};
+    uint32_t last_status_query_{0};
+
+    PairingCandidate pairing_candidates_[FAN_MAX_PAIRING_CANDIDATES]{};
+    uint8_t pairing_candidate_count_{0};
+#ifdef USE_SELECT
+    ZehnderPairingSelect *pairing_select_{nullptr};
+#endif
+
+    CallbackManager<void(uint8_t, uint32_t)> command_acked_callback_;
+    CallbackManager<void(std::string, uint8_t, uint32_t)> command_failed_callback_;
+    CallbackManager<void(uint32_t, uint8_t)> paired_callback_;
+};
+
+class CommandAckedTrigger : public Trigger<uint8_t, uint32_t> {
+public:
+    explicit CommandAckedTrigger(ZehnderFanComponent *parent) {
+        parent->add_on_command_acked_callback(
+            [this](uint8_t retries, uint32_t elapsed_ms) { this->trigger(retries, elapsed_ms); });
+    }
+};
+
+class CommandFailedTrigger : public Trigger<std::string, uint8_t, uint32_t> {
+public:
+    explicit CommandFailedTrigger(ZehnderFanComponent *parent) {
+        parent->add_on_command_failed_callback([this](std::string reason, uint8_t retries, uint32_t elapsed_ms) {
+            this->trigger(reason, retries, elapsed_ms);
+        });
+    }
+};
+
+class PairedTrigger : public Trigger<uint32_t, uint8_t> {
+public:
+    explicit PairedTrigger(ZehnderFanComponent *parent) {
+        parent->add_on_paired_callback(
+            [this](uint32_t network_id, uint8_t main_unit_id) { this->trigger(network_id, main_unit_id); });
+    }
+};
+
+template<typename... Ts> class DumpCaptureAction : public Action<Ts...>, public Parented<ZehnderRadio> {
+public:
+    void play(Ts... x) override { this->parent_->dump_capture(); }
 };
 
 } // namespace zehnder_fan
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
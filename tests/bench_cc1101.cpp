@@ -0,0 +1,153 @@
+// Driver micro-benchmarks. The protocol runs on the real CC1101 driver, which
+// talks to the register-level emulator over the host SPI bus, and a simulated
+// main unit answers every frame. For each operation the SPI transactions,
+// bytes and blocked time are taken from the driver's SpiStats, with the
+// clock advanced by the SPI wire time at 4 MHz, so the numbers compare
+// driver changes rather than host speed. Exits non-zero if an operation fails.
+
+#include "cc1101_emulator.h"
+#include "check.h"
+#include "host.h"
+#include "sim_main_unit.h"
+#include "zehnder_fan.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <optional>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static const uint32_t LOOP_INTERVAL_US = 1000;   // process() calls with the high frequency loop running
+static const uint32_t REPLY_DELAY_US = 15000;    // Main unit turnaround before its reply starts
+static const uint32_t OPERATION_LIMIT_MS = 30000;
+static const uint8_t SET_SPEED_RUNS = 16;
+static const uint8_t PAIRING_RUNS = 4;
+static const uint32_t NETWORK_ID = 0x6B1A2C3D;
+static const uint8_t MAIN_UNIT_ID = 0x42;
+static const uint8_t MY_DEVICE_ID = 0x21;
+
+// One remote and one main unit on a clean channel
+struct BenchRig {
+    explicit BenchRig(bool rx_interrupt) : unit(NETWORK_ID, MAIN_UNIT_ID) {
+        this->radio.set_spi_parent(&this->chip);
+        this->radio.set_cs_pin(&this->cs);
+        this->radio.set_gdo0_pin(&this->gdo0);
+        this->radio.set_gdo2_pin(&this->gdo2);
+        this->radio.set_rx_interrupt(rx_interrupt);
+        this->chip.set_gdo0_pin(&this->gdo0);
+        this->chip.set_gdo2_pin(&this->gdo2);
+        this->chip.set_transmit_listener([this](const uint8_t *frame, uint32_t end_us) {
+            if (this->unit.answer(frame, this->reply)) {
+                this->reply_pending = true;
+                this->reply_due_us = end_us + REPLY_DELAY_US + this->chip.get_frame_airtime_us();
+            }
+        });
+        this->unit.set_pairing_open(true);
+        this->radio.init();
+        this->protocol = std::make_unique<FanProtocol>(&this->radio);
+    }
+
+    void step() {
+        host::advance_us(LOOP_INTERVAL_US);
+        this->chip.update();
+        if (this->reply_pending && (int32_t) (micros() - this->reply_due_us) >= 0) {
+            this->reply_pending = false;
+            this->chip.receive(this->reply, -60.0f, true);
+        }
+        this->protocol->process();
+    }
+
+    CC1101Emulator chip;
+    InternalGPIOPin gdo0;
+    InternalGPIOPin gdo2;
+    GPIOPin cs;
+    CC1101Controller radio;
+    SimMainUnit unit;
+    std::unique_ptr<FanProtocol> protocol;
+
+    bool reply_pending{false};
+    uint32_t reply_due_us{0};
+    uint8_t reply[FAN_FRAMESIZE]{};
+};
+
+struct Totals {
+    uint32_t runs{0};
+    uint32_t acked{0};
+    SpiStats spi{};
+    uint32_t elapsed_ms{0};
+
+    void print(const char *mode, const char *operation) const {
+        printf("%-10s %-10s %5" PRIu32 " %6" PRIu32 " %9.1f %9.1f %11.1f %9.1f\n", mode, operation, this->runs,
+               this->acked, (double) this->spi.transactions / this->runs, (double) this->spi.bytes / this->runs,
+               (double) this->spi.blocked_us / this->runs, (double) this->elapsed_ms / this->runs);
+    }
+};
+
+// Runs one operation to completion and adds its cost to totals
+template<typename Start> static std::optional<FanOperationResult> run(BenchRig &rig, Totals &totals, Start start) {
+    SpiStats before = rig.radio.get_spi_stats();
+    uint32_t start_ms = millis();
+    std::optional<FanOperationResult> result;
+    start([&result](const FanOperationResult &r) { result = r; });
+    while (!result && millis() - start_ms < OPERATION_LIMIT_MS) {
+        rig.step();
+    }
+    SpiStats cost = rig.radio.get_spi_stats() - before;
+    totals.runs++;
+    totals.spi.transactions += cost.transactions;
+    totals.spi.bytes += cost.bytes;
+    totals.spi.blocked_us += cost.blocked_us;
+    totals.elapsed_ms += millis() - start_ms;
+    if (result && result->outcome == FanOperationOutcome::ACKED) {
+        totals.acked++;
+    }
+    return result;
+}
+
+static void bench(bool rx_interrupt) {
+    const char *mode = rx_interrupt ? "interrupt" : "polling";
+    BenchRig rig(rx_interrupt);
+    // The first process() calls calibrate the synthesizer
+    for (uint32_t i = 0; i < 100 && !rig.radio.is_calibrated(); i++) {
+        rig.step();
+    }
+    CHECK(rig.radio.is_calibrated());
+
+    Totals set_speed;
+    FanPairingInfo pairing{NETWORK_ID, MAIN_UNIT_ID, FAN_TYPE_MAIN_UNIT, MY_DEVICE_ID};
+    for (uint8_t i = 0; i < SET_SPEED_RUNS; i++) {
+        uint8_t speed = FAN_SPEED_LOW + i % FAN_SPEED_MAX;
+        run(rig, set_speed, [&](FanCompletionCallback &&done) {
+            rig.protocol->start_set_speed(0, pairing, speed, 0, std::move(done));
+        });
+        CHECK(rig.unit.get_speed() == speed);
+    }
+    CHECK(set_speed.acked == SET_SPEED_RUNS);
+    set_speed.print(mode, "set_speed");
+
+    Totals pairings;
+    for (uint8_t i = 0; i < PAIRING_RUNS; i++) {
+        auto result = run(rig, pairings, [&](FanCompletionCallback &&done) {
+            rig.protocol->start_pairing(0, true, std::move(done));
+        });
+        CHECK(result && result->pairing && result->pairing->network_id == NETWORK_ID &&
+              result->pairing->main_unit_id == MAIN_UNIT_ID);
+    }
+    CHECK(pairings.acked == PAIRING_RUNS);
+    pairings.print(mode, "pairing");
+}
+
+int main() {
+    host::set_manual_clock(true);
+    host::set_random_seed(1);
+
+    printf("Per operation averages, loop every %" PRIu32 " us, main unit replies after %" PRIu32 " ms\n",
+           LOOP_INTERVAL_US, REPLY_DELAY_US / 1000);
+    printf("%-10s %-10s %5s %6s %9s %9s %11s %9s\n", "rx mode", "operation", "runs", "acked", "spi txn", "spi bytes",
+           "blocked us", "time ms");
+    bench(true);
+    bench(false);
+    return check_result();
+}
@@ -0,0 +1,389 @@
+#include "capture_log.h"
+#include "zehnder_fan.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+
+namespace esphome {
+namespace zehnder_fan {
+
+static const char *const BEGIN_MARKER = "Capture begin: ";
+static const char *const END_MARKER = "Capture end";
+static const char *const RECORD_MARKER = "Capture: ";
+
+static bool starts_with(const char *text, size_t length, const char *prefix) {
+    size_t prefix_length = strlen(prefix);
+    return length >= prefix_length && memcmp(text, prefix, prefix_length) == 0;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// Exactly 2 * length hex digits; anything after them (a colour reset, '\r') is ignored
+static bool parse_hex(const char *text, size_t text_length, uint8_t *out, size_t length) {
+    if (text_length < 2 * length || (text_length > 2 * length && hex_digit(text[2 * length]) >= 0)) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        int high = hex_digit(text[2 * i]);
+        int low = hex_digit(text[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        out[i] = (high << 4) | low;
+    }
+    return true;
+}
+
+void CaptureLogReader::add_line(const char *line, size_t length) {
+    const char *found = static_cast<const char *>(memmem(line, length, "Capture", 7));
+    if (found == nullptr) {
+        return;
+    }
+    length -= found - line;
+    line = found;
+
+    if (starts_with(line, length, BEGIN_MARKER)) {
+        std::string text(line, length);
+        unsigned version;
+        this->in_dump_ = sscanf(text.c_str(), "Capture begin: version %u", &version) == 1 &&
+                         version == FAN_CAPTURE_VERSION;
+        if (this->in_dump_) {
+            this->dumps_++;
+        } else {
+            this->bad_lines_++;
+        }
+        return;
+    }
+    if (starts_with(line, length, END_MARKER)) {
+        this->in_dump_ = false;
+        return;
+    }
+    if (!this->in_dump_ || !starts_with(line, length, RECORD_MARKER)) {
+        return;
+    }
+    size_t offset = strlen(RECORD_MARKER);
+    FanCaptureRecord record;
+    if (!parse_hex(line + offset, length - offset, reinterpret_cast<uint8_t *>(&record), sizeof(record))) {
+        this->bad_lines_++;
+        return;
+    }
+    this->add_record(record);
+}
+
+void CaptureLogReader::add_record(const FanCaptureRecord &record) {
+    if (this->have_sequence_) {
+        int16_t step = static_cast<int16_t>(record.sequence - this->last_sequence_);
+        if (step <= 0) {
+            // A later dump repeats what an earlier one held; anything else
+            // with an old sequence number comes from a device that restarted
+            size_t recent = std::min(this->records_.size(), FAN_CAPTURE_SIZE);
+            for (size_t i = this->records_.size() - recent; i < this->records_.size(); i++) {
+                if (memcmp(&this->records_[i], &record, sizeof(record)) == 0) {
+                    return;
+                }
+            }
+        } else {
+            this->missed_ += step - 1;
+        }
+    }
+    this->have_sequence_ = true;
+    this->last_sequence_ = record.sequence;
+    this->records_.push_back(record);
+    if (this->record_listener_) {
+        this->record_listener_(record);
+    }
+}
+
+bool CaptureLogReader::read_file(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const char *text = static_cast<const char *>(mapped);
+    const char *end = text + size;
+    while (text < end) {
+        const char *newline = static_cast<const char *>(memchr(text, '\n', end - text));
+        const char *line_end = newline != nullptr ? newline : end;
+        this->add_line(text, line_end - text);
+        text = line_end + 1;
+    }
+    munmap(mapped, size);
+    return true;
+}
+
+bool CaptureLogReader::read_stream(FILE *stream) {
+    char *line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, stream)) >= 0) {
+        if (length > 0 && line[length - 1] == '\n') {
+            length--;
+        }
+        this->add_line(line, length);
+    }
+    free(line);
+    return !ferror(stream);
+}
+
+static std::string format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static std::string format(const char *fmt, ...) {
+    char buffer[160];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    return buffer;
+}
+
+static const char *speed_name(uint8_t speed) {
+    switch (speed) {
+        case FAN_SPEED_AUTO:
+            return "AUTO";
+        case FAN_SPEED_LOW:
+            return "LOW";
+        case FAN_SPEED_MEDIUM:
+            return "MEDIUM";
+        case FAN_SPEED_HIGH:
+            return "HIGH";
+        case FAN_SPEED_MAX:
+            return "MAX";
+        default:
+            return "?";
+    }
+}
+
+static std::string device_name(uint8_t type, uint8_t id) {
+    switch (type) {
+        case FAN_TYPE_BROADCAST:
+            return "broadcast";
+        case FAN_TYPE_MAIN_UNIT:
+            return format("main 0x%02X", id);
+        case FAN_TYPE_REMOTE_CONTROL:
+            return format("remote 0x%02X", id);
+        case FAN_TYPE_DISCOVERY:
+            return "discovery";
+        default:
+            return format("type 0x%02X id 0x%02X", type, id);
+    }
+}
+
+std::string describe_frame(const uint8_t *frame) {
+    FrameView view(frame);
+    std::string text = device_name(view.src_type(), view.src_id()) + " -> " +
+                       device_name(view.dest_type(), view.dest_id()) + ": ";
+    switch (view.command()) {
+        case FAN_FRAME_SETSPEED:
+            return text + format("SETSPEED speed=%s", speed_name(view.param(0)));
+        case FAN_FRAME_SETTIMER:
+            return text + format("SETTIMER speed=%s timer=%umin", speed_name(view.param(0)), view.param(1));
+        case FAN_NETWORK_JOIN_REQUEST:
+            return text + format("JOIN_REQUEST network=0x%08" PRIX32, view.param_u32le(0));
+        case FAN_FRAME_SETSPEED_REPLY:
+            return text + "SETSPEED_REPLY";
+        case FAN_NETWORK_JOIN_OPEN:
+            return text + format("JOIN_OPEN network=0x%08" PRIX32, view.param_u32le(0));
+        case FAN_TYPE_FAN_SETTINGS:
+            return text + format("FAN_SETTINGS speed=%s voltage=%u%% timer=%umin",
+                                 speed_name(view.param(FAN_SETTINGS_SPEED)), view.param(FAN_SETTINGS_VOLTAGE),
+                                 view.param(FAN_SETTINGS_TIMER));
+        case FAN_FRAME_0B:
+            return text + "FRAME_0B";
+        case FAN_NETWORK_JOIN_ACK:
+            return text + format("JOIN_ACK network=0x%08" PRIX32, view.param_u32le(0));
+        case FAN_TYPE_QUERY_DEVICE:
+            return text + "QUERY_DEVICE";
+        default:
+            text += format("command 0x%02X", view.command());
+            for (uint8_t i = 0; i < std::min(view.param_count(), FAN_FRAME_MAX_PARAMS); i++) {
+                text += format(" %02X", view.param(i));
+            }
+            return text;
+    }
+}
+
+const char *operation_type_name(uint8_t type) {
+    switch (static_cast<RadioOperationType>(type)) {
+        case RadioOperationType::NONE:
+            return "none";
+        case RadioOperationType::SET_SPEED:
+            return "set_speed";
+        case RadioOperationType::QUERY_STATUS:
+            return "query_status";
+        case RadioOperationType::PAIRING_DISCOVER:
+            return "pairing_discover";
+        case RadioOperationType::PAIRING_JOIN:
+            return "pairing_join";
+        case RadioOperationType::PAIRING_ACK:
+            return "pairing_ack";
+    }
+    return "?";
+}
+
+const char *operation_state_name(uint8_t state) {
+    switch (static_cast<RadioOperationState>(state)) {
+        case RadioOperationState::IDLE:
+            return "idle";
+        case RadioOperationState::QUEUED:
+            return "queued";
+        case RadioOperationState::PREPARING_TX:
+            return "preparing_tx";
+        case RadioOperationState::CARRIER_SENSE:
+            return "carrier_sense";
+        case RadioOperationState::CHANNEL_CHECK:
+            return "channel_check";
+        case RadioOperationState::TRANSMITTING:
+            return "transmitting";
+        case RadioOperationState::WAITING_RESPONSE:
+            return "waiting_response";
+        case RadioOperationState::OPERATION_COMPLETE:
+            return "complete";
+    }
+    return "?";
+}
+
+std::string describe_record(const FanCaptureRecord &record, uint32_t first_us) {
+    bool tx = record.direction == static_cast<uint8_t>(FanCaptureDirection::TX);
+    std::string text = format("%5u %10.3f ms %s ", record.sequence, (record.timestamp_us - first_us) / 1000.0,
+                              tx ? "TX" : "RX");
+    if (record.unit == FAN_CAPTURE_NO_UNIT) {
+        text += "listening";
+    } else {
+        text += format("unit %u %s/%s attempt %u", record.unit, operation_type_name(record.op_type),
+                       operation_state_name(record.op_state), record.attempt + 1);
+    }
+    text += "  " + describe_frame(record.data);
+    if (!tx) {
+        RxFrame frame{};
+        memcpy(frame.status, record.status, sizeof(frame.status));
+        text += format("  (%.1f dBm, LQI %u)", frame.rssi_dbm(), frame.lqi());
+    }
+    return text;
+}
+
+uint16_t capture_peer(const FanCaptureRecord &record) {
+    FrameView view(record.data);
+    if (record.direction == static_cast<uint8_t>(FanCaptureDirection::TX)) {
+        return view.dest_type() == FAN_TYPE_DISCOVERY ? CaptureStats::DISCOVERY_PEER : view.dest_id();
+    }
+    return view.src_id();
+}
+
+uint32_t CapturePeerStats::get_latency_percentile_us(uint8_t percentile) const {
+    if (this->latency_us.empty()) {
+        return 0;
+    }
+    std::vector<uint32_t> sorted = this->latency_us;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[(sorted.size() - 1) * percentile / 100];
+}
+
+void CaptureStats::add(const std::vector<FanCaptureRecord> &records) {
+    struct Pending {
+        uint32_t tx_end_us;
+        bool answered;
+    };
+    std::map<uint16_t, Pending> pending;
+
+    for (const FanCaptureRecord &record : records) {
+        uint16_t peer = capture_peer(record);
+        if (record.direction == static_cast<uint8_t>(FanCaptureDirection::TX)) {
+            CapturePeerStats &stats = this->peers_[peer];
+            auto previous = pending.find(peer);
+            if (previous != pending.end() && !previous->second.answered) {
+                stats.unanswered++;
+            }
+            pending[peer] = Pending{record.timestamp_us, false};
+            stats.frames_sent++;
+            if (record.attempt == 0) {
+                stats.operations++;
+            } else {
+                stats.retries++;
+            }
+            stats.max_attempt = std::max<uint8_t>(stats.max_attempt, record.attempt + 1);
+            continue;
+        }
+
+        // Open units answer the discovery broadcast with JOIN_OPEN
+        FrameView view(record.data);
+        if (view.command() == FAN_NETWORK_JOIN_OPEN && pending.count(CaptureStats::DISCOVERY_PEER) != 0) {
+            peer = CaptureStats::DISCOVERY_PEER;
+        }
+        auto sent = pending.find(peer);
+        if (record.unit == FAN_CAPTURE_NO_UNIT || view.dest_type() != FAN_TYPE_REMOTE_CONTROL ||
+            sent == pending.end()) {
+            this->overheard_++;
+            continue;
+        }
+        CapturePeerStats &stats = this->peers_[peer];
+        stats.replies++;
+        if (!sent->second.answered) {
+            sent->second.answered = true;
+            stats.latency_us.push_back(record.timestamp_us - sent->second.tx_end_us);
+        }
+    }
+
+    for (const auto &entry : pending) {
+        if (!entry.second.answered) {
+            this->peers_[entry.first].unanswered++;
+        }
+    }
+}
+
+void CaptureStats::print(FILE *out) const {
+    fprintf(out, "%-10s %6s %6s %7s %11s %7s %10s %10s %10s %10s\n", "peer", "ops", "frames", "retries",
+            "max attempt", "replies", "unanswered", "p50 ms", "p99 ms", "max ms");
+    for (const auto &entry : this->peers_) {
+        const CapturePeerStats &stats = entry.second;
+        char peer[16];
+        if (entry.first == DISCOVERY_PEER) {
+            snprintf(peer, sizeof(peer), "discovery");
+        } else {
+            snprintf(peer, sizeof(peer), "main 0x%02X", entry.first);
+        }
+        fprintf(out, "%-10s %6" PRIu32 " %6" PRIu32 " %7" PRIu32 " %11u", peer, stats.operations, stats.frames_sent,
+                stats.retries, stats.max_attempt);
+        fprintf(out, " %7" PRIu32 " %10" PRIu32 " %10.1f %10.1f %10.1f\n", stats.replies, stats.unanswered,
+                stats.get_latency_percentile_us(50) / 1000.0, stats.get_latency_percentile_us(99) / 1000.0,
+                stats.get_latency_percentile_us(100) / 1000.0);
+    }
+    fprintf(out, "%" PRIu32 " received frames answered nothing sent\n", this->overheard_);
+}
+
+} // namespace zehnder_fan
+} // namespace esphome
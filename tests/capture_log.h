@@ -0,0 +1,100 @@
+#pragma once
+
+#include "capture.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace zehnder_fan {
+
+// Pulls the FanCaptureRecords out of a log with zehnder_fan.dump_capture
+// output in it, as saved from the ESPHome logs or piped in while it runs.
+// Log prefixes and colour codes around the capture lines are skipped.
+// Several dumps may follow each other; records that an earlier dump already
+// held are dropped by sequence number, so the result is every frame once,
+// oldest first.
+class CaptureLogReader {
+public:
+    // Feeds one log line, without the line end
+    void add_line(const char *line, size_t length);
+
+    // Maps the file and reads it in one pass
+    bool read_file(const char *path);
+    // Reads line by line, e.g. from a pipe
+    bool read_stream(FILE *stream);
+    // Called for every new record as soon as its line was read
+    void set_record_listener(std::function<void(const FanCaptureRecord &)> &&listener) {
+        this->record_listener_ = std::move(listener);
+    }
+
+    const std::vector<FanCaptureRecord> &get_records() const { return this->records_; }
+    uint32_t get_dumps() const { return this->dumps_; }
+    // Records overwritten on the device before any dump got them
+    uint32_t get_missed() const { return this->missed_; }
+    // Capture lines that could not be decoded, or dumps of another version
+    uint32_t get_bad_lines() const { return this->bad_lines_; }
+
+protected:
+    void add_record(const FanCaptureRecord &record);
+
+    std::vector<FanCaptureRecord> records_;
+    std::function<void(const FanCaptureRecord &)> record_listener_;
+    bool in_dump_{false};
+    bool have_sequence_{false};
+    uint16_t last_sequence_{0};
+    uint32_t dumps_{0};
+    uint32_t missed_{0};
+    uint32_t bad_lines_{0};
+};
+
+// One line per record: time since the first record, direction, operation and
+// the decoded frame
+std::string describe_record(const FanCaptureRecord &record, uint32_t first_us);
+// Command and parameters of any FAN_* frame, e.g. "SETSPEED speed=HIGH"
+std::string describe_frame(const uint8_t *frame);
+const char *operation_type_name(uint8_t type);
+const char *operation_state_name(uint8_t state);
+
+// Exchange statistics per peer: every main unit the remote talked to, plus
+// the pairing discovery broadcast. A received frame from the peer that
+// follows a sent frame to it counts as the reply to that frame.
+struct CapturePeerStats {
+    uint32_t operations{0};  // First attempts seen
+    uint32_t frames_sent{0};
+    uint32_t retries{0};     // Frames sent with an attempt number above zero
+    uint8_t max_attempt{0};
+    uint32_t replies{0};     // Frames received in answer; discovery can get several per frame
+    uint32_t unanswered{0};  // Sent frames the capture holds no reply to
+    std::vector<uint32_t> latency_us;  // From the end of a sent frame to the end of its reply
+
+    uint32_t get_latency_percentile_us(uint8_t percentile) const;
+};
+
+class CaptureStats {
+public:
+    // Adds a whole capture, oldest record first
+    void add(const std::vector<FanCaptureRecord> &records);
+
+    // Keyed by main unit id; DISCOVERY_PEER for the pairing broadcast
+    static constexpr uint16_t DISCOVERY_PEER = 0x100;
+    const std::map<uint16_t, CapturePeerStats> &get_peers() const { return this->peers_; }
+    uint32_t get_overheard() const { return this->overheard_; }
+
+    void print(FILE *out) const;
+
+protected:
+    std::map<uint16_t, CapturePeerStats> peers_;
+    uint32_t overheard_{0};  // Received frames that answered nothing we sent
+};
+
+// The peer a sent frame is addressed to, or a received frame came from
+uint16_t capture_peer(const FanCaptureRecord &record);
+
+} // namespace zehnder_fan
+} // namespace esphome
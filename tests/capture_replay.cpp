@@ -0,0 +1,239 @@
+#include "capture_replay.h"
+#include "capture_log.h"
+#include "host.h"
+
+#include <cinttypes>
+#include <cstring>
+
+namespace esphome {
+namespace zehnder_fan {
+
+static const uint32_t STEP_US = 100;
+static const uint32_t START_LEAD_US = 5000;             // Operations start this long before their first frame ended
+static const uint32_t REPLY_WAIT_LIMIT_US = 2000000;    // Longest a received frame waits for the frame it answers
+static const uint32_t DRAIN_LIMIT_US = 60 * 1000000;    // For the operations still running after the last record
+
+static bool is_pairing(uint8_t op_type) {
+    auto type = static_cast<RadioOperationType>(op_type);
+    return type == RadioOperationType::PAIRING_DISCOVER || type == RadioOperationType::PAIRING_JOIN ||
+           type == RadioOperationType::PAIRING_ACK;
+}
+
+void CaptureReplayResult::print(FILE *out) const {
+    fprintf(out, "%" PRIu32 " operations replayed: %" PRIu32 " acked, %" PRIu32 " failed\n", this->operations,
+            this->acked, this->failed);
+    fprintf(out, "Sent frames: %" PRIu32 " as captured, %" PRIu32 " different, %" PRIu32 " extra, %" PRIu32
+            " missing\n", this->frames_matched, this->frames_differing, this->frames_extra, this->frames_missing);
+    fprintf(out, "Received frames: %" PRIu32 " heard, %" PRIu32 " sent while the radio was not listening\n",
+            this->frames_delivered, this->frames_not_heard);
+    if (this->skipped_records > 0) {
+        fprintf(out, "%" PRIu32 " leading records skipped, their operation started before the capture\n",
+                this->skipped_records);
+    }
+}
+
+CaptureReplay::CaptureReplay(const std::vector<FanCaptureRecord> &records) {
+    this->radio_.set_spi_parent(&this->chip_);
+    this->radio_.set_cs_pin(&this->cs_);
+    this->radio_.set_gdo0_pin(&this->gdo0_);
+    this->radio_.set_gdo2_pin(&this->gdo2_);
+    this->chip_.set_gdo0_pin(&this->gdo0_);
+    this->chip_.set_gdo2_pin(&this->gdo2_);
+    this->chip_.set_transmit_listener(
+        [this](const uint8_t *frame, uint32_t end_us) { this->on_transmit(frame, end_us); });
+    this->radio_.init();
+    this->protocol_ = std::make_unique<FanProtocol>(&this->radio_);
+
+    // An operation whose first attempt was overwritten can't be started again
+    size_t first = 0;
+    while (first < records.size() && !this->starts_operation(records[first])) {
+        first++;
+    }
+    this->result_.skipped_records = first;
+    this->records_.assign(records.begin() + first, records.end());
+
+    int64_t time_us = 0;
+    for (size_t i = 0; i < this->records_.size(); i++) {
+        const FanCaptureRecord &record = this->records_[i];
+        if (i > 0) {
+            time_us += static_cast<int32_t>(record.timestamp_us - this->records_[i - 1].timestamp_us);
+        }
+        this->times_us_.push_back(time_us);
+        this->sent_before_.push_back(this->sent_.size());
+        if (record.direction == static_cast<uint8_t>(FanCaptureDirection::TX)) {
+            this->sent_.push_back(i);
+        }
+
+        // Frames only carry the network id while joining
+        FrameView view(record.data);
+        if (view.command() == FAN_NETWORK_JOIN_OPEN && view.src_type() == FAN_TYPE_MAIN_UNIT) {
+            this->network_ids_[view.src_id()] = view.param_u32le(0);
+        } else if (view.command() == FAN_NETWORK_JOIN_REQUEST && view.dest_type() == FAN_TYPE_MAIN_UNIT) {
+            this->network_ids_[view.dest_id()] = view.param_u32le(0);
+        }
+    }
+}
+
+bool CaptureReplay::starts_operation(const FanCaptureRecord &record) const {
+    if (record.direction != static_cast<uint8_t>(FanCaptureDirection::TX) || record.attempt != 0 ||
+        record.unit >= FAN_MAX_UNITS) {
+        return false;
+    }
+    switch (static_cast<RadioOperationType>(record.op_type)) {
+        case RadioOperationType::SET_SPEED:
+        case RadioOperationType::QUERY_STATUS:
+        case RadioOperationType::PAIRING_DISCOVER:
+            return true;
+        case RadioOperationType::PAIRING_JOIN:
+            // Follows discovery within the same operation, unless the user picked the unit
+            return !this->running_[record.unit];
+        default:
+            return false;
+    }
+}
+
+void CaptureReplay::start_operation(const FanCaptureRecord &record) {
+    uint8_t unit = record.unit;
+    FrameView view(record.data);
+    FanPairingInfo pairing{0, view.dest_id(), view.dest_type(), view.src_id()};
+    auto network = this->network_ids_.find(view.dest_id());
+    if (network != this->network_ids_.end()) {
+        pairing.network_id = network->second;
+    }
+    auto on_complete = [this, unit](const FanOperationResult &result) {
+        this->running_[unit] = false;
+        if (result.outcome == FanOperationOutcome::ACKED) {
+            this->result_.acked++;
+        } else {
+            this->result_.failed++;
+        }
+    };
+
+    switch (static_cast<RadioOperationType>(record.op_type)) {
+        case RadioOperationType::SET_SPEED: {
+            uint8_t timer_minutes = view.command() == FAN_FRAME_SETTIMER ? view.param(1) : 0;
+            this->protocol_->start_set_speed(unit, pairing, view.param(0), timer_minutes, std::move(on_complete));
+            break;
+        }
+        case RadioOperationType::QUERY_STATUS:
+            this->protocol_->start_query_status(unit, pairing, std::move(on_complete));
+            break;
+        case RadioOperationType::PAIRING_DISCOVER:
+            this->protocol_->start_pairing(unit, true, std::move(on_complete));
+            break;
+        case RadioOperationType::PAIRING_JOIN:
+            pairing.network_id = view.param_u32le(0);
+            this->protocol_->start_pairing_join(unit, pairing, std::move(on_complete));
+            break;
+        default:
+            return;
+    }
+    this->running_[unit] = true;
+    this->result_.operations++;
+}
+
+void CaptureReplay::deliver(const FanCaptureRecord &record) {
+    uint8_t frame[FAN_FRAMESIZE];
+    memcpy(frame, record.data, sizeof(frame));
+    if (frame[FRAME_DEST_TYPE] == FAN_TYPE_REMOTE_CONTROL) {
+        auto id = this->device_ids_.find(frame[FRAME_DEST_ID]);
+        if (id != this->device_ids_.end()) {
+            frame[FRAME_DEST_ID] = id->second;
+        }
+    }
+    RxFrame status{};
+    memcpy(status.status, record.status, sizeof(status.status));
+    if (this->chip_.receive(frame, status.rssi_dbm(), status.crc_ok())) {
+        this->result_.frames_delivered++;
+    } else {
+        this->result_.frames_not_heard++;
+    }
+}
+
+bool CaptureReplay::same_frame(const FanCaptureRecord &captured, const uint8_t *frame) {
+    if (memcmp(captured.data, frame, FAN_FRAMESIZE) == 0) {
+        return true;
+    }
+    if (!is_pairing(captured.op_type)) {
+        return false;
+    }
+    uint8_t readdressed[FAN_FRAMESIZE];
+    memcpy(readdressed, frame, sizeof(readdressed));
+    readdressed[FRAME_SRC_ID] = captured.data[FRAME_SRC_ID];
+    if (memcmp(captured.data, readdressed, FAN_FRAMESIZE) != 0) {
+        return false;
+    }
+    this->device_ids_[captured.data[FRAME_SRC_ID]] = frame[FRAME_SRC_ID];
+    return true;
+}
+
+void CaptureReplay::on_transmit(const uint8_t *frame, uint32_t end_us) {
+    if (this->next_sent_ >= this->sent_.size()) {
+        this->result_.frames_extra++;
+        if (this->verbose_ != nullptr) {
+            fprintf(this->verbose_, "Extra frame: %s\n", describe_frame(frame).c_str());
+        }
+        return;
+    }
+    size_t index = this->sent_[this->next_sent_++];
+    const FanCaptureRecord &captured = this->records_[index];
+    if (this->same_frame(captured, frame)) {
+        this->result_.frames_matched++;
+    } else {
+        this->result_.frames_differing++;
+        if (this->verbose_ != nullptr) {
+            fprintf(this->verbose_, "Captured: %s\n    sent: %s\n", describe_frame(captured.data).c_str(),
+                    describe_frame(frame).c_str());
+        }
+    }
+    // Later records keep their timing relative to this frame
+    int64_t now_us = host::now_us();
+    int64_t replay_end_us = now_us + static_cast<int32_t>(end_us - static_cast<uint32_t>(now_us));
+    this->offset_us_ = replay_end_us - this->times_us_[index];
+}
+
+CaptureReplayResult CaptureReplay::run() {
+    this->offset_us_ = static_cast<int64_t>(host::now_us()) + START_LEAD_US;
+
+    size_t next = 0;
+    while (next < this->records_.size()) {
+        const FanCaptureRecord &record = this->records_[next];
+        int64_t now_us = host::now_us();
+        int64_t due_us = this->times_us_[next] + this->offset_us_;
+        bool done;
+        if (record.direction == static_cast<uint8_t>(FanCaptureDirection::TX)) {
+            // Retries and the later frames of an exchange come from the protocol itself
+            done = !this->starts_operation(record);
+            if (!done && now_us >= due_us - START_LEAD_US && !this->running_[record.unit]) {
+                this->start_operation(record);
+                done = true;
+            }
+        } else {
+            // A reply waits for the frame it answers, in case the replay runs late
+            bool answered_sent = this->next_sent_ >= this->sent_before_[next];
+            done = now_us >= due_us && (answered_sent || now_us >= due_us + REPLY_WAIT_LIMIT_US);
+            if (done) {
+                this->deliver(record);
+            }
+        }
+        if (done) {
+            next++;
+            continue;
+        }
+        host::advance_us(STEP_US);
+        this->chip_.update();
+        this->protocol_->process();
+    }
+
+    uint64_t drain_start_us = host::now_us();
+    while (this->protocol_->is_busy() && host::now_us() - drain_start_us < DRAIN_LIMIT_US) {
+        host::advance_us(STEP_US);
+        this->chip_.update();
+        this->protocol_->process();
+    }
+    this->result_.frames_missing = this->sent_.size() - this->result_.frames_matched - this->result_.frames_differing;
+    return this->result_;
+}
+
+} // namespace zehnder_fan
+} // namespace esphome
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "capture.h"
+#include "cc1101_emulator.h"
+#include "zehnder_fan.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace esphome {
+namespace zehnder_fan {
+
+struct CaptureReplayResult {
+    uint32_t skipped_records{0};  // Leading records of an operation whose start was overwritten
+    uint32_t operations{0};       // Started on the protocol
+    uint32_t acked{0};
+    uint32_t failed{0};
+    uint32_t frames_matched{0};
+    uint32_t frames_differing{0};  // Sent where the capture has another frame
+    uint32_t frames_extra{0};      // Sent after the captured frames ran out
+    uint32_t frames_missing{0};    // Captured frames the protocol never sent
+    uint32_t frames_delivered{0};  // Received frames put on the air and heard
+    uint32_t frames_not_heard{0};  // Received frames put on the air while the radio was not in RX
+
+    bool matches() const { return frames_differing == 0 && frames_extra == 0 && frames_missing == 0; }
+    void print(FILE *out) const;
+};
+
+// Replays a capture against the real protocol and CC1101 driver on the
+// emulator, on the manual host clock. Each operation the capture shows
+// starting is started again at the same point in time, and each received
+// frame goes on the air with the same delay after the frame it followed.
+// The frames the protocol sends are checked against the captured ones, so a
+// protocol change shows up as a different exchange for the same traffic.
+//
+// The remote's own device id during pairing is random, so a sent pairing
+// frame that differs from the capture only in that id still matches, and
+// the captured replies are readdressed to the new id.
+class CaptureReplay {
+public:
+    explicit CaptureReplay(const std::vector<FanCaptureRecord> &records);
+
+    // Describes every frame that did not match to out
+    void set_verbose(FILE *out) { this->verbose_ = out; }
+
+    CaptureReplayResult run();
+
+protected:
+    bool starts_operation(const FanCaptureRecord &record) const;
+    void start_operation(const FanCaptureRecord &record);
+    void deliver(const FanCaptureRecord &record);
+    void on_transmit(const uint8_t *frame, uint32_t end_us);
+    bool same_frame(const FanCaptureRecord &captured, const uint8_t *frame);
+
+    std::vector<FanCaptureRecord> records_;
+    std::vector<int64_t> times_us_;     // Of each record, since the first one
+    std::vector<size_t> sent_;          // Indices of the captured frames sent by the remote
+    std::vector<size_t> sent_before_;   // Per record, how many of those precede it
+    size_t next_sent_{0};               // Frames the replay sent so far
+    int64_t offset_us_{0};              // Replay time minus capture time, as of the last frame sent
+    std::map<uint8_t, uint32_t> network_ids_;  // By main unit id, learned from the join exchange
+    std::map<uint8_t, uint8_t> device_ids_;    // Captured pairing device id to the one the replay picked
+    bool running_[FAN_MAX_UNITS]{};
+    FILE *verbose_{nullptr};
+    CaptureReplayResult result_;
+
+    CC1101Emulator chip_;
+    InternalGPIOPin gdo0_;
+    InternalGPIOPin gdo2_;
+    GPIOPin cs_;
+    CC1101Controller radio_;
+    std::unique_ptr<FanProtocol> protocol_;
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
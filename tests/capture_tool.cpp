@@ -0,0 +1,108 @@
+// Frame capture tool. Reads the zehnder_fan.dump_capture output from ESPHome
+// logs and works on the FanCaptureRecords in it:
+//
+//   capture_tool decode [FILE...]                      every frame, decoded
+//   capture_tool stats [FILE...]                       retries and reply latency per main unit
+//   capture_tool replay [--check] [--verbose] [FILE...]
+//
+// replay runs the capture against the protocol and CC1101 driver on the
+// emulated chip, see CaptureReplay. With --check it fails unless the protocol
+// sent exactly the captured frames; --verbose lists the ones it did not.
+//
+// Files are mapped into memory. Without a file, or with "-", the log is read
+// from stdin as it comes, so `esphome logs fan.yaml | capture_tool decode`
+// decodes each dump while the device runs.
+
+#include "capture_log.h"
+#include "capture_replay.h"
+#include "esphome/core/log.h"
+#include "host.h"
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static int usage() {
+    fprintf(stderr, "usage: capture_tool decode|stats|replay [--check] [--verbose] [FILE...]\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        return usage();
+    }
+    std::string command = argv[1];
+    if (command != "decode" && command != "stats" && command != "replay") {
+        return usage();
+    }
+    bool check = false;
+    bool verbose = false;
+    std::vector<const char *> paths;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        paths.push_back("-");
+    }
+    host::set_log_level(HOST_LOG_LEVEL_ERROR);
+
+    CaptureLogReader reader;
+    if (command == "decode") {
+        // Line buffered, so a live log is decoded as it arrives
+        setvbuf(stdout, nullptr, _IOLBF, 0);
+        bool first = true;
+        uint32_t first_us = 0;
+        reader.set_record_listener([&first, &first_us](const FanCaptureRecord &record) {
+            if (first) {
+                first = false;
+                first_us = record.timestamp_us;
+            }
+            printf("%s\n", describe_record(record, first_us).c_str());
+        });
+    }
+    for (const char *path : paths) {
+        bool ok = strcmp(path, "-") == 0 ? reader.read_stream(stdin) : reader.read_file(path);
+        if (!ok) {
+            fprintf(stderr, "Cannot read %s: %s\n", path, strerror(errno));
+            return 2;
+        }
+    }
+    printf("%zu records from %" PRIu32 " dumps, %" PRIu32 " overwritten before they were dumped",
+           reader.get_records().size(), reader.get_dumps(), reader.get_missed());
+    if (reader.get_bad_lines() > 0) {
+        printf(", %" PRIu32 " capture lines not understood", reader.get_bad_lines());
+    }
+    printf("\n");
+
+    if (command == "stats") {
+        CaptureStats stats;
+        stats.add(reader.get_records());
+        stats.print(stdout);
+    } else if (command == "replay") {
+        host::set_manual_clock(true);
+        CaptureReplay replay(reader.get_records());
+        if (verbose) {
+            replay.set_verbose(stdout);
+        }
+        CaptureReplayResult result = replay.run();
+        result.print(stdout);
+        if (check && !result.matches()) {
+            return 1;
+        }
+    }
+    return 0;
+}
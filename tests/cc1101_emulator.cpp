@@ -0,0 +1,415 @@
+#include "cc1101_emulator.h"
+#include "host.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace esphome {
+namespace zehnder_fan {
+
+// Register addresses and fields the emulator acts on, from the CC1101 datasheet
+static const uint8_t REG_PKTLEN = 0x06;
+static const uint8_t REG_PKTCTRL0 = 0x08;
+static const uint8_t REG_MDMCFG4 = 0x10;
+static const uint8_t REG_MDMCFG3 = 0x11;
+static const uint8_t REG_MDMCFG2 = 0x12;
+static const uint8_t REG_MDMCFG1 = 0x13;
+static const uint8_t REG_MCSM1 = 0x17;
+static const uint8_t REG_MCSM0 = 0x18;
+static const uint8_t REG_AGCCTRL1 = 0x1C;
+static const uint8_t REG_FSCAL3 = 0x23;
+static const uint8_t REG_FSCAL2 = 0x24;
+static const uint8_t REG_FSCAL1 = 0x25;
+static const uint8_t REG_PATABLE = 0x3E;
+static const uint8_t REG_FIFO = 0x3F;
+
+static const uint8_t STATUS_PARTNUM = 0x30;
+static const uint8_t STATUS_VERSION = 0x31;
+static const uint8_t STATUS_LQI = 0x33;
+static const uint8_t STATUS_RSSI = 0x34;
+static const uint8_t STATUS_MARCSTATE = 0x35;
+static const uint8_t STATUS_PKTSTATUS = 0x38;
+static const uint8_t STATUS_TXBYTES = 0x3A;
+static const uint8_t STATUS_RXBYTES = 0x3B;
+
+static const uint8_t STROBE_SRES = 0x30;
+static const uint8_t STROBE_SFSTXON = 0x31;
+static const uint8_t STROBE_SCAL = 0x33;
+static const uint8_t STROBE_SRX = 0x34;
+static const uint8_t STROBE_STX = 0x35;
+static const uint8_t STROBE_SIDLE = 0x36;
+static const uint8_t STROBE_SWOR = 0x38;
+static const uint8_t STROBE_SPWD = 0x39;
+static const uint8_t STROBE_SFRX = 0x3A;
+static const uint8_t STROBE_SFTX = 0x3B;
+
+static const uint8_t HEADER_READ = 0x80;
+static const uint8_t HEADER_BURST = 0x40;
+static const uint8_t EMULATED_LQI = 20;
+static const uint32_t XOSC_HZ = 26000000;
+
+CC1101Emulator::CC1101Emulator() { this->reset(); }
+
+void CC1101Emulator::reset() {
+    // Reset values of the registers the emulator interprets
+    memset(this->regs_, 0, sizeof(this->regs_));
+    this->regs_[REG_PKTLEN] = 0xFF;
+    this->regs_[REG_PKTCTRL0] = 0x45;
+    this->regs_[REG_MDMCFG4] = 0x8C;
+    this->regs_[REG_MDMCFG3] = 0x22;
+    this->regs_[REG_MDMCFG2] = 0x02;
+    this->regs_[REG_MDMCFG1] = 0x22;
+    this->regs_[REG_MCSM1] = 0x30;
+    this->regs_[REG_MCSM0] = 0x04;
+    this->regs_[REG_AGCCTRL1] = 0x40;
+    this->patable_ = 0xC6;
+    this->rx_head_ = 0;
+    this->rx_count_ = 0;
+    this->tx_count_ = 0;
+    this->waking_ = false;
+    this->enter(State::IDLE);
+}
+
+void CC1101Emulator::select() {
+    this->update();
+    this->selected_ = true;
+    this->access_ = Access::HEADER;
+    if (this->state_ == State::SLEEP && !this->waking_) {
+        // Pulling CS low starts the crystal; the chip is in IDLE once it runs
+        this->waking_ = true;
+        this->state_until_us_ = micros() + WAKE_US;
+    }
+}
+
+void CC1101Emulator::deselect() {
+    this->selected_ = false;
+    this->access_ = Access::HEADER;
+}
+
+void CC1101Emulator::transfer(uint8_t *data, size_t length) {
+    this->update();
+    for (size_t i = 0; i < length; i++) {
+        data[i] = this->exchange(data[i]);
+    }
+    this->wire_ns_ += static_cast<uint32_t>(uint64_t(length) * 8 * 1000000000 / this->spi_clock_hz_);
+    host::advance_us(this->wire_ns_ / 1000);
+    this->wire_ns_ %= 1000;
+}
+
+uint8_t CC1101Emulator::status_byte(bool read) const {
+    static const uint8_t state_codes[] = {
+        0,  // SLEEP reports through CHIP_RDYn
+        0,  // IDLE
+        1,  // RX
+        2,  // TX
+        3,  // FSTXON
+        4,  // CALIBRATE
+        6,  // RXFIFO_OVERFLOW
+        7,  // TXFIFO_UNDERFLOW
+    };
+    uint8_t status = state_codes[static_cast<uint8_t>(this->state_)] << 4;
+    if (this->state_ == State::SLEEP) {
+        status |= 0x80;
+    }
+    size_t fifo = read ? this->rx_count_ : FIFO_SIZE - this->tx_count_;
+    return status | static_cast<uint8_t>(std::min<size_t>(fifo, 0x0F));
+}
+
+uint8_t CC1101Emulator::exchange(uint8_t in) {
+    switch (this->access_) {
+        case Access::HEADER: {
+            this->header_read_ = (in & HEADER_READ) != 0;
+            uint8_t out = this->status_byte(this->header_read_);
+            if (this->state_ == State::SLEEP) {
+                // No access is decoded before the crystal runs
+                return out;
+            }
+            bool burst = (in & HEADER_BURST) != 0;
+            this->address_ = in & 0x3F;
+            if (this->address_ >= 0x30 && this->address_ <= 0x3D) {
+                if (burst && this->header_read_) {
+                    this->access_ = Access::READ_SINGLE;  // Status register
+                } else {
+                    this->strobe(this->address_);
+                }
+            } else if (this->header_read_) {
+                this->access_ = burst ? Access::READ_BURST : Access::READ_SINGLE;
+            } else {
+                this->access_ = burst ? Access::WRITE_BURST : Access::WRITE_SINGLE;
+            }
+            return out;
+        }
+        case Access::WRITE_SINGLE:
+            this->write(this->address_, in);
+            this->access_ = Access::HEADER;
+            return this->status_byte(false);
+        case Access::WRITE_BURST:
+            this->write(this->address_, in);
+            if (this->address_ < sizeof(this->regs_)) {
+                this->address_++;
+            }
+            return this->status_byte(false);
+        case Access::READ_SINGLE: {
+            uint8_t value = this->address_ >= 0x30 && this->address_ <= 0x3D
+                                ? this->read_status_register(this->address_)
+                                : this->read(this->address_);
+            this->access_ = Access::HEADER;
+            return value;
+        }
+        case Access::READ_BURST: {
+            uint8_t value = this->read(this->address_);
+            if (this->address_ < sizeof(this->regs_)) {
+                this->address_++;
+            }
+            return value;
+        }
+    }
+    return 0;
+}
+
+void CC1101Emulator::write(uint8_t address, uint8_t value) {
+    if (address < sizeof(this->regs_)) {
+        this->regs_[address] = value;
+    } else if (address == REG_PATABLE) {
+        this->patable_ = value;
+    } else if (address == REG_FIFO) {
+        if (this->tx_count_ < FIFO_SIZE) {
+            this->tx_fifo_[this->tx_count_++] = value;
+        }
+    }
+}
+
+uint8_t CC1101Emulator::read(uint8_t address) {
+    if (address < sizeof(this->regs_)) {
+        return this->regs_[address];
+    }
+    if (address == REG_PATABLE) {
+        return this->patable_;
+    }
+    if (address == REG_FIFO && this->rx_count_ > 0) {
+        uint8_t value = this->rx_fifo_[this->rx_head_];
+        this->rx_head_ = (this->rx_head_ + 1) % FIFO_SIZE;
+        this->rx_count_--;
+        return value;
+    }
+    return 0;
+}
+
+uint8_t CC1101Emulator::read_status_register(uint8_t address) {
+    switch (address) {
+        case STATUS_PARTNUM: return 0x00;
+        case STATUS_VERSION: return 0x14;
+        case STATUS_LQI: return this->last_lqi_;
+        case STATUS_RSSI: return static_cast<uint8_t>(static_cast<int8_t>(std::lround((this->last_rssi_dbm_ + 74) * 2)));
+        case STATUS_MARCSTATE: {
+            static const uint8_t marcstates[] = {0x00, 0x01, 0x0D, 0x13, 0x12, 0x08, 0x11, 0x16};
+            return marcstates[static_cast<uint8_t>(this->state_)];
+        }
+        case STATUS_PKTSTATUS:
+            // CS (bit 6) and CCA (bit 4)
+            return this->carrier_ ? 0x40 : 0x10;
+        case STATUS_TXBYTES:
+            return (this->state_ == State::TXFIFO_UNDERFLOW ? 0x80 : 0x00) | static_cast<uint8_t>(this->tx_count_);
+        case STATUS_RXBYTES:
+            return (this->state_ == State::RXFIFO_OVERFLOW ? 0x80 : 0x00) | static_cast<uint8_t>(this->rx_count_);
+        default: return 0x00;
+    }
+}
+
+void CC1101Emulator::strobe(uint8_t command) {
+    this->strobes_[command & 0x0F]++;
+    switch (command) {
+        case STROBE_SRES:
+            this->reset();
+            break;
+        case STROBE_SFSTXON:
+            if (this->state_ == State::IDLE) {
+                this->enter(State::FSTXON);
+            }
+            break;
+        case STROBE_SCAL:
+            if (this->state_ == State::IDLE) {
+                this->after_calibration_ = State::IDLE;
+                this->enter(State::CALIBRATE);
+            }
+            break;
+        case STROBE_SRX:
+            if (this->state_ == State::IDLE) {
+                this->start_from_idle(State::RX);
+            } else if (this->state_ == State::TX || this->state_ == State::FSTXON) {
+                this->enter(State::RX);
+            }
+            break;
+        case STROBE_STX:
+            if (this->state_ == State::IDLE) {
+                // Clear channel assessment only applies to STX issued in RX
+                this->start_from_idle(State::TX);
+            } else if (this->state_ == State::RX) {
+                bool cca = (this->regs_[REG_MCSM1] & 0x30) != 0;
+                if (!(cca && this->carrier_)) {
+                    this->start_tx();
+                }
+            } else if (this->state_ == State::FSTXON) {
+                this->start_tx();
+            }
+            break;
+        case STROBE_SIDLE:
+            if (this->state_ == State::TX) {
+                this->set_gdo(this->gdo2_, false);
+            }
+            if (this->state_ != State::RXFIFO_OVERFLOW && this->state_ != State::TXFIFO_UNDERFLOW &&
+                this->state_ != State::SLEEP) {
+                this->enter(State::IDLE);
+            }
+            break;
+        case STROBE_SWOR:
+        case STROBE_SPWD:
+            if (this->state_ == State::IDLE) {
+                this->enter(State::SLEEP);
+                this->wor_ = command == STROBE_SWOR;
+            }
+            break;
+        case STROBE_SFRX:
+            if (this->state_ == State::IDLE || this->state_ == State::RXFIFO_OVERFLOW) {
+                this->rx_head_ = 0;
+                this->rx_count_ = 0;
+                this->enter(State::IDLE);
+            }
+            break;
+        case STROBE_SFTX:
+            if (this->state_ == State::IDLE || this->state_ == State::TXFIFO_UNDERFLOW) {
+                this->tx_count_ = 0;
+                this->enter(State::IDLE);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void CC1101Emulator::enter(State state) {
+    this->state_ = state;
+    if (state == State::CALIBRATE) {
+        this->state_until_us_ = micros() + CALIBRATION_US;
+    }
+}
+
+void CC1101Emulator::start_from_idle(State target) {
+    // MCSM0 FS_AUTOCAL = 1 calibrates on every IDLE->RX/TX transition
+    if (((this->regs_[REG_MCSM0] >> 4) & 0x03) == 0x01) {
+        this->after_calibration_ = target;
+        this->enter(State::CALIBRATE);
+    } else if (target == State::TX) {
+        this->start_tx();
+    } else {
+        this->enter(target);
+    }
+}
+
+void CC1101Emulator::start_tx() {
+    uint8_t length = this->regs_[REG_PKTLEN];
+    if (this->tx_count_ < length) {
+        this->enter(State::TXFIFO_UNDERFLOW);
+        return;
+    }
+    this->enter(State::TX);
+    this->state_until_us_ = micros() + this->get_frame_airtime_us();
+    this->frames_sent_++;
+    this->set_gdo(this->gdo2_, true);
+    if (this->transmit_listener_) {
+        this->transmit_listener_(this->tx_fifo_, this->state_until_us_);
+    }
+}
+
+void CC1101Emulator::finish_tx() {
+    uint8_t length = this->regs_[REG_PKTLEN];
+    memmove(this->tx_fifo_, this->tx_fifo_ + length, this->tx_count_ - length);
+    this->tx_count_ -= length;
+    this->enter(this->off_mode_state(this->regs_[REG_MCSM1] & 0x03));
+    this->set_gdo(this->gdo2_, false);
+}
+
+CC1101Emulator::State CC1101Emulator::off_mode_state(uint8_t mode) const {
+    switch (mode) {
+        case 1: return State::FSTXON;
+        case 3: return State::RX;
+        default: return State::IDLE;
+    }
+}
+
+void CC1101Emulator::update() {
+    uint32_t now = micros();
+    if (this->waking_ && (int32_t) (now - this->state_until_us_) >= 0) {
+        this->waking_ = false;
+        this->wor_ = false;
+        this->enter(State::IDLE);
+    }
+    if (this->state_ == State::CALIBRATE && (int32_t) (now - this->state_until_us_) >= 0) {
+        this->regs_[REG_FSCAL3] = 0xE9;
+        this->regs_[REG_FSCAL2] = 0x2A;
+        this->regs_[REG_FSCAL1] = 0x17;
+        State target = this->after_calibration_;
+        this->enter(State::IDLE);
+        if (target == State::TX) {
+            this->start_tx();
+        } else {
+            this->enter(target);
+        }
+    }
+    if (this->state_ == State::TX && (int32_t) (now - this->state_until_us_) >= 0) {
+        this->finish_tx();
+    }
+}
+
+bool CC1101Emulator::receive(const uint8_t *frame, float rssi_dbm, bool crc_ok) {
+    this->update();
+    if (this->state_ == State::SLEEP && this->wor_ && !this->waking_) {
+        // Wake-on-Radio found the sync word; RX_TIME_QUAL keeps it in RX
+        this->enter(State::RX);
+    }
+    if (this->state_ != State::RX) {
+        return false;
+    }
+
+    uint8_t length = this->regs_[REG_PKTLEN];
+    this->last_rssi_dbm_ = rssi_dbm;
+    this->last_lqi_ = (crc_ok ? 0x80 : 0x00) | EMULATED_LQI;
+    uint8_t status[2] = {static_cast<uint8_t>(static_cast<int8_t>(std::lround((rssi_dbm + 74) * 2))), this->last_lqi_};
+
+    this->set_gdo(this->gdo0_, true);
+    for (size_t i = 0; i < static_cast<size_t>(length) + 2; i++) {
+        if (this->rx_count_ == FIFO_SIZE) {
+            this->enter(State::RXFIFO_OVERFLOW);
+            break;
+        }
+        uint8_t byte = i < length ? frame[i] : status[i - length];
+        this->rx_fifo_[(this->rx_head_ + this->rx_count_) % FIFO_SIZE] = byte;
+        this->rx_count_++;
+    }
+    this->frames_received_++;
+    this->set_gdo(this->gdo0_, false);
+    return true;
+}
+
+uint32_t CC1101Emulator::get_frame_airtime_us() const {
+    // Data rate = (256 + DRATE_M) * 2^DRATE_E * f_xosc / 2^28
+    uint64_t baud = ((uint64_t) (256 + this->regs_[REG_MDMCFG3]) << (this->regs_[REG_MDMCFG4] & 0x0F)) * XOSC_HZ >> 28;
+    if (baud == 0) {
+        baud = 1;
+    }
+    static const uint8_t preamble_bytes[] = {2, 3, 4, 6, 8, 12, 16, 24};
+    static const uint8_t sync_bytes[] = {0, 2, 2, 4, 0, 2, 2, 4};
+    uint32_t bytes = preamble_bytes[(this->regs_[REG_MDMCFG1] >> 4) & 0x07] + sync_bytes[this->regs_[REG_MDMCFG2] & 0x07] +
+                     this->regs_[REG_PKTLEN] + ((this->regs_[REG_PKTCTRL0] & 0x04) ? 2 : 0);
+    return (uint64_t) bytes * 8 * 1000000 / baud;
+}
+
+void CC1101Emulator::set_gdo(InternalGPIOPin *pin, bool level) {
+    if (pin != nullptr) {
+        pin->set_level(level);
+    }
+}
+
+} // namespace zehnder_fan
+} // namespace esphome
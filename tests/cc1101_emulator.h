@@ -0,0 +1,136 @@
+#pragma once
+
+#include "esphome/components/spi/spi.h"
+#include "esphome/core/hal.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace esphome {
+namespace zehnder_fan {
+
+// Register-level CC1101 stand-in on the host SPI bus. It decodes headers,
+// strobes and bursts like the chip, keeps the configuration registers, the
+// PATABLE and both 64-byte FIFOs, and runs the main radio state machine
+// (IDLE, RX, TX, CALIBRATE, SLEEP and the FIFO error states) against the host
+// clock. GDO0/GDO2 follow IOCFG 0x06: high from sync word to packet end.
+//
+// The radio environment is up to the caller: frames the chip sends go to the
+// transmit listener, receive() puts a frame into the RX FIFO as if it had
+// just ended on the air, and set_carrier() decides what carrier sense sees.
+class CC1101Emulator : public spi::SPIComponent {
+public:
+    enum class State : uint8_t {
+        SLEEP,
+        IDLE,
+        RX,
+        TX,
+        FSTXON,
+        CALIBRATE,
+        RXFIFO_OVERFLOW,
+        TXFIFO_UNDERFLOW,
+    };
+
+    static const uint8_t FIFO_SIZE = 64;
+    static const uint32_t CALIBRATION_US = 720;  // SCAL, or FS_AUTOCAL on IDLE->RX/TX
+    static const uint32_t WAKE_US = 150;         // Crystal start-up after CS wakes the chip from SLEEP
+
+    CC1101Emulator();
+
+    void set_gdo0_pin(InternalGPIOPin *pin) { this->gdo0_ = pin; }
+    void set_gdo2_pin(InternalGPIOPin *pin) { this->gdo2_ = pin; }
+    // SPI clock; every transfer advances the manual host clock by its wire
+    // time, so the driver's blocked time is measured as on the board
+    void set_spi_clock(uint32_t hz) { this->spi_clock_hz_ = hz; }
+    // Called when a frame starts on the air, with the time it will end
+    void set_transmit_listener(std::function<void(const uint8_t *frame, uint32_t end_us)> &&listener) {
+        this->transmit_listener_ = std::move(listener);
+    }
+
+    // Finishes transmissions and calibrations that are due. SPI accesses do
+    // this themselves; call it while idle to get the GDO2 edge on time.
+    void update();
+
+    // A carrier above the carrier-sense threshold; CCA_MODE=11 holds back STX
+    void set_carrier(bool carrier) { this->carrier_ = carrier; }
+    // Delivers a frame that ended on the air just now. Only taken in RX (or
+    // WOR); appends the RSSI and LQI/CRC_OK status bytes. False if not heard.
+    bool receive(const uint8_t *frame, float rssi_dbm, bool crc_ok);
+
+    State get_state() const { return this->state_; }
+    uint8_t get_register(uint8_t reg) const { return this->regs_[reg]; }
+    uint8_t get_patable() const { return this->patable_; }
+    size_t get_rx_fifo_bytes() const { return this->rx_count_; }
+    size_t get_tx_fifo_bytes() const { return this->tx_count_; }
+    uint32_t get_frame_airtime_us() const;
+    // Strobes by command, 0x30-0x3D
+    uint32_t get_strobe_count(uint8_t strobe) const { return this->strobes_[strobe & 0x0F]; }
+    uint32_t get_frames_sent() const { return this->frames_sent_; }
+    uint32_t get_frames_received() const { return this->frames_received_; }
+
+    // spi::SPIComponent
+    void select() override;
+    void deselect() override;
+    void transfer(uint8_t *data, size_t length) override;
+
+protected:
+    enum class Access : uint8_t {
+        HEADER,
+        WRITE_SINGLE,
+        WRITE_BURST,
+        READ_SINGLE,
+        READ_BURST,
+    };
+
+    uint8_t exchange(uint8_t in);
+    uint8_t status_byte(bool read) const;
+    void strobe(uint8_t command);
+    void write(uint8_t address, uint8_t value);
+    uint8_t read(uint8_t address);
+    uint8_t read_status_register(uint8_t address);
+
+    void reset();
+    void enter(State state);
+    // Goes to target, through CALIBRATE first when FS_AUTOCAL asks for it
+    void start_from_idle(State target);
+    void start_tx();
+    void finish_tx();
+    State off_mode_state(uint8_t mode) const;
+    void set_gdo(InternalGPIOPin *pin, bool level);
+
+    uint8_t regs_[0x2F]{};
+    uint8_t patable_{0};
+    uint8_t rx_fifo_[FIFO_SIZE]{};
+    size_t rx_head_{0};
+    size_t rx_count_{0};
+    uint8_t tx_fifo_[FIFO_SIZE]{};
+    size_t tx_count_{0};
+
+    State state_{State::IDLE};
+    State after_calibration_{State::IDLE};
+    uint32_t state_until_us_{0};  // End of TX, CALIBRATE or the wake-up from SLEEP
+    bool waking_{false};
+    bool wor_{false};  // SLEEP entered through SWOR; the chip still hears frames
+    bool carrier_{false};
+    float last_rssi_dbm_{-100.0f};
+    uint8_t last_lqi_{0};
+
+    uint32_t spi_clock_hz_{4000000};
+    uint32_t wire_ns_{0};  // Wire time not yet added to the clock
+    bool selected_{false};
+    Access access_{Access::HEADER};
+    uint8_t address_{0};
+    bool header_read_{false};
+
+    InternalGPIOPin *gdo0_{nullptr};
+    InternalGPIOPin *gdo2_{nullptr};
+    std::function<void(const uint8_t *, uint32_t)> transmit_listener_;
+
+    uint32_t strobes_[16]{};
+    uint32_t frames_sent_{0};
+    uint32_t frames_received_{0};
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
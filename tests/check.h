@@ -0,0 +1,25 @@
+#pragma once
+
+// Minimal checks for the host tests: a failed CHECK is reported and counted,
+// and check_result() turns the count into the exit code
+
+#include <cstdio>
+#include <cstdlib>
+
+inline int check_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            check_failures++; \
+        } \
+    } while (0)
+
+inline int check_result() {
+    if (check_failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", check_failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
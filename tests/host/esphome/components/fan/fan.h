@@ -0,0 +1,84 @@
+#pragma once
+
+// Host stand-in for the fan entity base
+
+#include <cctype>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+namespace fan {
+
+class FanTraits {
+public:
+    FanTraits() = default;
+    FanTraits(bool oscillation, bool speed, bool direction, int speed_count)
+        : oscillation_(oscillation), speed_(speed), direction_(direction), speed_count_(speed_count) {}
+    bool supports_speed() const { return this->speed_; }
+    int supported_speed_count() const { return this->speed_count_; }
+
+protected:
+    bool oscillation_{false};
+    bool speed_{false};
+    bool direction_{false};
+    int speed_count_{0};
+};
+
+class FanCall {
+public:
+    FanCall &set_state(bool state) {
+        this->state_ = state;
+        return *this;
+    }
+    FanCall &set_speed(int speed) {
+        this->speed_ = speed;
+        return *this;
+    }
+    std::optional<bool> get_state() const { return this->state_; }
+    std::optional<int> get_speed() const { return this->speed_; }
+
+protected:
+    std::optional<bool> state_;
+    std::optional<int> speed_;
+};
+
+class Fan {
+public:
+    virtual ~Fan() = default;
+
+    bool state{false};
+    int speed{0};
+
+    virtual FanTraits get_traits() = 0;
+
+    // The object id is the snake_case name, as ESPHome derives it
+    void set_name(const char *name) {
+        this->name_ = name;
+        this->object_id_.clear();
+        for (const char *c = name; *c != '\0'; c++) {
+            this->object_id_ += std::isalnum((unsigned char) *c) ? (char) std::tolower((unsigned char) *c) : '_';
+        }
+    }
+    const std::string &get_name() const { return this->name_; }
+    const std::string &get_object_id() const { return this->object_id_; }
+    uint32_t get_object_id_hash() const { return fnv1_hash(this->object_id_); }
+
+    void publish_state() { this->publish_count_++; }
+    uint32_t get_publish_count() const { return this->publish_count_; }
+
+    // Host only: runs a call the way the frontend would
+    void perform(const FanCall &call) { this->control(call); }
+
+protected:
+    virtual void control(const FanCall &call) = 0;
+
+    std::string name_;
+    std::string object_id_;
+    uint32_t publish_count_{0};
+};
+
+} // namespace fan
+} // namespace esphome
@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for the sensor entity
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+public:
+    void publish_state(float state) { this->state = state; }
+
+    float state{0.0f};
+};
+
+} // namespace sensor
+} // namespace esphome
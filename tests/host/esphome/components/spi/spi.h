@@ -0,0 +1,71 @@
+#pragma once
+
+// Host stand-in for the SPI component. The bus is whatever the test attaches
+// as the parent: an emulated chip sees every CS edge and every full-duplex
+// transfer, and answers in place.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace spi {
+
+enum SPIBitOrder { BIT_ORDER_LSB_FIRST, BIT_ORDER_MSB_FIRST };
+enum SPIClockPolarity { CLOCK_POLARITY_LOW, CLOCK_POLARITY_HIGH };
+enum SPIClockPhase { CLOCK_PHASE_LEADING, CLOCK_PHASE_TRAILING };
+enum SPIDataRate : uint32_t {
+    DATA_RATE_1MHZ = 1000000,
+    DATA_RATE_4MHZ = 4000000,
+    DATA_RATE_8MHZ = 8000000,
+};
+
+class SPIComponent {
+public:
+    virtual ~SPIComponent() = default;
+    virtual void select() {}
+    virtual void deselect() {}
+    // Clocks data out and replaces it with the bytes clocked in
+    virtual void transfer(uint8_t *data, size_t length) { memset(data, 0, length); }
+};
+
+class SPIClient {
+public:
+    void set_spi_parent(SPIComponent *parent) { this->parent_ = parent; }
+    void set_cs_pin(GPIOPin *cs) { this->cs_ = cs; }
+
+protected:
+    SPIComponent *parent_{nullptr};
+    GPIOPin *cs_{nullptr};
+};
+
+template<SPIBitOrder BIT_ORDER, SPIClockPolarity CLOCK_POLARITY, SPIClockPhase CLOCK_PHASE, SPIDataRate DATA_RATE>
+class SPIDevice : public SPIClient {
+public:
+    void spi_setup() {}
+    void spi_teardown() {}
+    void enable() { this->parent_->select(); }
+    void disable() { this->parent_->deselect(); }
+
+    uint8_t transfer_byte(uint8_t data) {
+        this->parent_->transfer(&data, 1);
+        return data;
+    }
+    void transfer_array(uint8_t *data, size_t length) { this->parent_->transfer(data, length); }
+    uint8_t read_byte() { return this->transfer_byte(0); }
+    void write_byte(uint8_t data) { this->transfer_byte(data); }
+    void read_array(uint8_t *data, size_t length) {
+        memset(data, 0, length);
+        this->parent_->transfer(data, length);
+    }
+    void write_array(const uint8_t *data, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            this->write_byte(data[i]);
+        }
+    }
+};
+
+} // namespace spi
+} // namespace esphome
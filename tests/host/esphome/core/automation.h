@@ -0,0 +1,33 @@
+#pragma once
+
+// Host stand-in for esphome/core/automation.h
+
+#include <functional>
+#include <vector>
+
+namespace esphome {
+
+template<typename... Ts> class Trigger {
+public:
+    void trigger(Ts... x) {
+        for (auto &listener : this->listeners_) {
+            listener(x...);
+        }
+    }
+    // Host only: lets a test observe the trigger instead of an automation
+    void add_listener(std::function<void(Ts...)> &&listener) { this->listeners_.push_back(std::move(listener)); }
+
+protected:
+    std::vector<std::function<void(Ts...)>> listeners_;
+};
+
+template<typename... Ts> class Action {
+public:
+    virtual ~Action() = default;
+    void play_complex(Ts... x) { this->play(x...); }
+
+protected:
+    virtual void play(Ts... x) = 0;
+};
+
+} // namespace esphome
@@ -0,0 +1,57 @@
+#pragma once
+
+// Host stand-in for esphome/core/component.h. Timeouts run from
+// host::run_scheduler(); the loop is whatever the test calls.
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "esphome/core/hal.h"
+
+namespace esphome {
+
+namespace setup_priority {
+static const float HARDWARE = 800.0f;
+static const float DATA = 600.0f;
+} // namespace setup_priority
+
+class Component {
+public:
+    virtual ~Component();
+    virtual void setup() {}
+    virtual void loop() {}
+    virtual void dump_config() {}
+    virtual float get_setup_priority() const { return 0.0f; }
+    virtual void on_shutdown() {}
+
+    void mark_failed() { this->failed_ = true; }
+    bool is_failed() const { return this->failed_; }
+    void disable_loop() { this->loop_enabled_ = false; }
+    void enable_loop() { this->loop_enabled_ = true; }
+    void enable_loop_soon_any_context() { this->loop_enabled_ = true; }
+    bool is_loop_enabled() const { return this->loop_enabled_; }
+
+    void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f);
+    bool cancel_timeout(const std::string &name);
+    void set_timeout(uint32_t timeout, std::function<void()> &&f) { this->set_timeout("", timeout, std::move(f)); }
+
+protected:
+    bool failed_{false};
+    volatile bool loop_enabled_{true};
+};
+
+class PollingComponent : public Component {
+public:
+    PollingComponent() {}
+    explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+    virtual void update() = 0;
+    void set_update_interval(uint32_t update_interval) { this->update_interval_ = update_interval; }
+    uint32_t get_update_interval() const { return this->update_interval_; }
+
+protected:
+    uint32_t update_interval_{0};
+};
+
+} // namespace esphome
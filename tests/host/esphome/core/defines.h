@@ -0,0 +1,3 @@
+#pragma once
+
+// The host build passes the USE_* defines on the compiler command line
@@ -0,0 +1,76 @@
+#pragma once
+
+// Host stand-in for esphome/core/hal.h: the clock comes from host.h, GPIO
+// pins are plain levels that tests drive.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define IRAM_ATTR
+#define HOT
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+namespace gpio {
+enum Flags : uint8_t {
+    FLAG_NONE = 0x00,
+    FLAG_INPUT = 0x01,
+    FLAG_OUTPUT = 0x02,
+};
+enum InterruptType : uint8_t {
+    INTERRUPT_RISING_EDGE = 1,
+    INTERRUPT_FALLING_EDGE = 2,
+    INTERRUPT_ANY_EDGE = 3,
+};
+} // namespace gpio
+
+class GPIOPin {
+public:
+    virtual ~GPIOPin() = default;
+    virtual void setup() {}
+    virtual void pin_mode(gpio::Flags flags) {}
+    virtual bool digital_read() { return this->level_; }
+    virtual void digital_write(bool value) { this->level_ = value; }
+    virtual std::string dump_summary() const { return "host pin"; }
+
+protected:
+    bool level_{false};
+};
+
+// A pin the test drives with set_level(); an edge matching the attached
+// interrupt runs the handler right away, as the ISR would.
+class InternalGPIOPin : public GPIOPin {
+public:
+    template<typename T> void attach_interrupt(void (*func)(T *), T *arg, gpio::InterruptType type) const {
+        this->isr_ = reinterpret_cast<void (*)(void *)>(func);
+        this->isr_arg_ = arg;
+        this->isr_type_ = type;
+    }
+
+    void set_level(bool level) {
+        bool rising = level && !this->level_;
+        bool falling = !level && this->level_;
+        this->level_ = level;
+        if (this->isr_ == nullptr) {
+            return;
+        }
+        if ((rising && (this->isr_type_ & gpio::INTERRUPT_RISING_EDGE)) ||
+            (falling && (this->isr_type_ & gpio::INTERRUPT_FALLING_EDGE))) {
+            this->isr_(this->isr_arg_);
+        }
+    }
+    bool has_interrupt() const { return this->isr_ != nullptr; }
+
+protected:
+    mutable void (*isr_)(void *){nullptr};
+    mutable void *isr_arg_{nullptr};
+    mutable gpio::InterruptType isr_type_{gpio::INTERRUPT_ANY_EDGE};
+};
+
+} // namespace esphome
@@ -0,0 +1,65 @@
+#pragma once
+
+// Host stand-in for the esphome/core/helpers.h functions the component uses
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define YESNO(b) ((b) ? "YES" : "NO")
+#define ONOFF(b) ((b) ? "ON" : "OFF")
+
+namespace esphome {
+
+using std::make_unique;
+
+// Deterministic on the host, seeded with host::set_random_seed()
+uint32_t random_uint32();
+float random_float();
+
+uint32_t fnv1_hash(const std::string &str);
+std::string str_sprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc = 0xffff, uint16_t reverse_poly = 0xa001,
+               bool refin = false, bool refout = false);
+std::string format_hex(const uint8_t *data, size_t length);
+std::string format_hex_pretty(const uint8_t *data, size_t length);
+
+class HighFrequencyLoopRequester {
+public:
+    void start() { this->started_ = true; }
+    void stop() { this->started_ = false; }
+    bool is_started() const { return this->started_; }
+
+protected:
+    bool started_{false};
+};
+
+template<typename T> class CallbackManager;
+template<typename... Ts> class CallbackManager<void(Ts...)> {
+public:
+    void add(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+    void call(Ts... args) {
+        for (auto &callback : this->callbacks_) {
+            callback(args...);
+        }
+    }
+
+protected:
+    std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+template<typename T> class Parented {
+public:
+    Parented() {}
+    Parented(T *parent) : parent_(parent) {}
+    T *get_parent() const { return this->parent_; }
+    void set_parent(T *parent) { this->parent_ = parent; }
+
+protected:
+    T *parent_{nullptr};
+};
+
+} // namespace esphome
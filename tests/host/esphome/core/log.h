@@ -0,0 +1,41 @@
+#pragma once
+
+// Host stand-in for esphome/core/log.h. Lines go to stdout up to the level
+// set with host::set_log_level(), and to the listener a test installed.
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace esphome {
+
+enum HostLogLevel : int {
+    HOST_LOG_LEVEL_NONE = 0,
+    HOST_LOG_LEVEL_ERROR = 1,
+    HOST_LOG_LEVEL_WARN = 2,
+    HOST_LOG_LEVEL_INFO = 3,
+    HOST_LOG_LEVEL_CONFIG = 4,
+    HOST_LOG_LEVEL_DEBUG = 5,
+    HOST_LOG_LEVEL_VERBOSE = 6,
+};
+
+void host_log(int level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+} // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::host_log(::esphome::HOST_LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::host_log(::esphome::HOST_LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::host_log(::esphome::HOST_LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::host_log(::esphome::HOST_LOG_LEVEL_CONFIG, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::host_log(::esphome::HOST_LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ::esphome::host_log(::esphome::HOST_LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#define ESP_LOGVV(tag, ...) ::esphome::host_log(::esphome::HOST_LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+
+#define LOG_PIN(prefix, pin) \
+    do { \
+        if ((pin) != nullptr) { \
+            ESP_LOGCONFIG(TAG, "%s%s", prefix, (pin)->dump_summary().c_str()); \
+        } \
+    } while (0)
+#define LOG_SENSOR(prefix, type, obj) (void) (obj)
+#define LOG_SELECT(prefix, type, obj) (void) (obj)
+#define LOG_UPDATE_INTERVAL(obj) (void) (obj)
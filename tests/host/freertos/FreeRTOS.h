@@ -0,0 +1,17 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS types, with a 1 kHz tick
+
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+#define portMAX_DELAY ((TickType_t) 0xFFFFFFFF)
+#define portYIELD_FROM_ISR(woken) (void) (woken)
@@ -0,0 +1,17 @@
+#pragma once
+
+// Host stand-in for FreeRTOS tasks: every task is a std::thread, and task
+// notifications are a counter behind a condition variable. host::stop_tasks()
+// ends all of them at their next ulTaskNotifyTake().
+
+#include "FreeRTOS.h"
+
+struct HostTask;
+typedef HostTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *created_task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken);
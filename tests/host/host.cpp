@@ -0,0 +1,360 @@
+#include "host.h"
+
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace esphome {
+
+// -------------------------------------------------------------------------
+// Clock
+// -------------------------------------------------------------------------
+
+static std::atomic<bool> manual_clock{false};
+static std::atomic<uint64_t> manual_now_us{0};
+static const auto clock_start = std::chrono::steady_clock::now();
+
+uint64_t host::now_us() {
+    if (manual_clock.load()) {
+        return manual_now_us.load();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - clock_start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void host::set_manual_clock(bool manual) {
+    manual_now_us.store(host::now_us());
+    manual_clock.store(manual);
+}
+
+void host::advance_us(uint64_t us) { manual_now_us.fetch_add(us); }
+
+uint32_t millis() { return static_cast<uint32_t>(host::now_us() / 1000); }
+uint32_t micros() { return static_cast<uint32_t>(host::now_us()); }
+
+void delay(uint32_t ms) { delayMicroseconds(ms * 1000); }
+
+void delayMicroseconds(uint32_t us) {
+    if (manual_clock.load()) {
+        host::advance_us(us);
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+// -------------------------------------------------------------------------
+// Helpers
+// -------------------------------------------------------------------------
+
+static uint32_t random_state = 0x12345678;
+
+void host::set_random_seed(uint32_t seed) { random_state = seed != 0 ? seed : 1; }
+
+uint32_t random_uint32() {
+    // xorshift32: cheap, and the same sequence on every host
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+float random_float() { return static_cast<float>(random_uint32()) / static_cast<float>(UINT32_MAX); }
+
+uint32_t fnv1_hash(const std::string &str) {
+    uint32_t hash = 2166136261UL;
+    for (char c : str) {
+        hash *= 16777619UL;
+        hash ^= static_cast<uint8_t>(c);
+    }
+    return hash;
+}
+
+std::string str_sprintf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    char buffer[256];
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    return buffer;
+}
+
+uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc, uint16_t reverse_poly, bool refin, bool refout) {
+    // Only the reflected form the component uses
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ reverse_poly : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+std::string format_hex(const uint8_t *data, size_t length) {
+    static const char *const digits = "0123456789abcdef";
+    std::string out;
+    out.reserve(length * 2);
+    for (size_t i = 0; i < length; i++) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0x0F];
+    }
+    return out;
+}
+
+std::string format_hex_pretty(const uint8_t *data, size_t length) {
+    std::string out;
+    for (size_t i = 0; i < length; i++) {
+        char byte[4];
+        snprintf(byte, sizeof(byte), i == 0 ? "%02X" : ".%02X", data[i]);
+        out += byte;
+    }
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// Logging
+// -------------------------------------------------------------------------
+
+static int log_level = HOST_LOG_LEVEL_WARN;
+static std::function<void(int, const char *, const std::string &)> log_listener;
+static std::mutex log_mutex;
+
+void host::set_log_level(int level) { log_level = level; }
+
+void host::set_log_listener(std::function<void(int level, const char *tag, const std::string &line)> &&listener) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    log_listener = std::move(listener);
+}
+
+void host_log(int level, const char *tag, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    char buffer[512];
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (level <= log_level) {
+        printf("[%s] %s\n", tag, buffer);
+    }
+    if (log_listener) {
+        log_listener(level, tag, buffer);
+    }
+}
+
+// -------------------------------------------------------------------------
+// Component timeouts
+// -------------------------------------------------------------------------
+
+struct HostTimeout {
+    Component *component;
+    std::string name;
+    uint32_t due;
+    std::function<void()> callback;
+};
+static std::list<HostTimeout> timeouts;
+
+Component::~Component() {
+    timeouts.remove_if([this](const HostTimeout &timeout) { return timeout.component == this; });
+}
+
+void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {
+    if (!name.empty()) {
+        this->cancel_timeout(name);
+    }
+    timeouts.push_back(HostTimeout{this, name, millis() + timeout, std::move(f)});
+}
+
+bool Component::cancel_timeout(const std::string &name) {
+    size_t before = timeouts.size();
+    timeouts.remove_if(
+        [this, &name](const HostTimeout &timeout) { return timeout.component == this && timeout.name == name; });
+    return timeouts.size() != before;
+}
+
+void host::run_scheduler() {
+    uint32_t now = millis();
+    for (auto it = timeouts.begin(); it != timeouts.end();) {
+        if ((int32_t) (now - it->due) >= 0) {
+            std::function<void()> callback = std::move(it->callback);
+            it = timeouts.erase(it);
+            callback();
+        } else {
+            ++it;
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// NVS
+// -------------------------------------------------------------------------
+
+static std::map<std::string, std::vector<uint8_t>> nvs_store;
+static size_t nvs_writes = 0;
+
+void host::nvs_reset() {
+    nvs_store.clear();
+    nvs_writes = 0;
+}
+
+bool host::nvs_read(const std::string &key, std::vector<uint8_t> &value) {
+    auto it = nvs_store.find(key);
+    if (it == nvs_store.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+size_t host::nvs_write_count() { return nvs_writes; }
+
+} // namespace esphome
+
+using esphome::nvs_store;
+
+esp_err_t nvs_flash_init() { return ESP_OK; }
+
+esp_err_t nvs_flash_erase() {
+    nvs_store.clear();
+    return ESP_OK;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        default: return "ESP_FAIL";
+    }
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    nvs_store[key].assign(bytes, bytes + length);
+    esphome::nvs_writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    auto it = nvs_store.find(key);
+    if (it == nvs_store.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value == nullptr) {
+        *length = it->second.size();
+        return ESP_OK;
+    }
+    if (*length < it->second.size()) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, it->second.data(), it->second.size());
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    return nvs_store.erase(key) != 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) { return ESP_OK; }
+
+void nvs_close(nvs_handle_t handle) {}
+
+// -------------------------------------------------------------------------
+// FreeRTOS tasks
+// -------------------------------------------------------------------------
+
+struct HostTaskStopped {};
+
+struct HostTask {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable notified;
+    uint32_t notifications{0};
+    bool stop{false};
+};
+
+static std::vector<std::unique_ptr<HostTask>> tasks;
+static thread_local HostTask *current_task = nullptr;
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *created_task) {
+    tasks.push_back(std::make_unique<HostTask>());
+    HostTask *task = tasks.back().get();
+    if (created_task != nullptr) {
+        *created_task = task;
+    }
+    task->thread = std::thread([task, function, parameters]() {
+        current_task = task;
+        try {
+            function(parameters);
+        } catch (const HostTaskStopped &) {
+        }
+    });
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait) {
+    HostTask *task = current_task;
+    std::unique_lock<std::mutex> lock(task->mutex);
+    auto ready = [task]() { return task->notifications > 0 || task->stop; };
+    if (ticks_to_wait == portMAX_DELAY) {
+        task->notified.wait(lock, ready);
+    } else {
+        task->notified.wait_for(lock, std::chrono::milliseconds(ticks_to_wait), ready);
+    }
+    if (task->stop) {
+        throw HostTaskStopped{};
+    }
+    uint32_t count = task->notifications;
+    if (count > 0) {
+        task->notifications = clear_count_on_exit ? 0 : count - 1;
+    }
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notifications++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken) {
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = pdTRUE;
+    }
+}
+
+void esphome::host::stop_tasks() {
+    for (auto &task : tasks) {
+        {
+            std::lock_guard<std::mutex> lock(task->mutex);
+            task->stop = true;
+        }
+        task->notified.notify_one();
+        task->thread.join();
+    }
+    tasks.clear();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Controls of the host stand-in layer, for tests, benchmarks and the simulator
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+// The clock runs on real time unless manual; a manual clock only moves with
+// advance_us() and delay()/delayMicroseconds(), so runs are deterministic
+void set_manual_clock(bool manual);
+void advance_us(uint64_t us);
+uint64_t now_us();
+
+void set_random_seed(uint32_t seed);
+
+void set_log_level(int level);
+void set_log_listener(std::function<void(int level, const char *tag, const std::string &line)> &&listener);
+
+// Runs the component timeouts that are due
+void run_scheduler();
+
+// NVS contents, by key within the only namespace the component opens
+void nvs_reset();
+bool nvs_read(const std::string &key, std::vector<uint8_t> &value);
+size_t nvs_write_count();
+
+// Ends every task at its next ulTaskNotifyTake() and waits for it
+void stop_tasks();
+
+} // namespace host
+} // namespace esphome
@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF NVS flash API, kept in memory
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+
+#define ESP_ERROR_CHECK(x) (void) (x)
+
+esp_err_t nvs_flash_init();
+esp_err_t nvs_flash_erase();
+const char *esp_err_to_name(esp_err_t code);
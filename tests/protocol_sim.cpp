@@ -0,0 +1,209 @@
+// Protocol simulator. Remotes run the real protocol and CC1101 driver on
+// emulated chips, and share one lossy channel with simulated main units,
+// optionally with foreign traffic. The manual clock advances in 1 ms steps
+// and all randomness is seeded, so each scenario is reproducible. For every
+// scenario it reports the success rate, p50/p99 time to acknowledgement and
+// the airtime used per operation.
+//
+//   protocol_sim [--quick]
+//
+// --quick runs fewer operations; ctest runs it that way. Either run fails if
+// an operation never completes, or one of the scenarios without loss or
+// contention does not succeed every time.
+
+#include "cc1101_emulator.h"
+#include "check.h"
+#include "esphome/core/log.h"
+#include "host.h"
+#include "sim_channel.h"
+#include "sim_main_unit.h"
+#include "zehnder_fan.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static const uint32_t STEP_US = 1000;
+static const uint32_t SCENARIO_LIMIT_MS = 60 * 60 * 1000;
+static const uint32_t MIN_COMMAND_GAP_MS = 500;
+static const uint32_t MAX_COMMAND_GAP_MS = 4000;
+static const uint32_t PAIRING_REPLY_SPREAD_MS = 200;
+
+struct Scenario {
+    const char *name;
+    SimChannelConfig channel;
+    uint8_t remotes;           // Boards, each with its own radio and protocol
+    uint8_t units_per_remote;  // Main units each board controls
+    uint32_t reply_delay_ms;   // Main unit turnaround
+    bool pairing;              // Pair with the strongest open unit instead of setting speeds
+    bool must_succeed;         // Checked in --quick runs
+};
+
+// One board: emulated CC1101, the real driver and the protocol
+struct SimRemote {
+    SimRemote() {
+        this->radio.set_spi_parent(&this->chip);
+        this->radio.set_cs_pin(&this->cs);
+        this->radio.set_gdo0_pin(&this->gdo0);
+        this->radio.set_gdo2_pin(&this->gdo2);
+        this->chip.set_gdo0_pin(&this->gdo0);
+        this->chip.set_gdo2_pin(&this->gdo2);
+        this->radio.init();
+        this->protocol = std::make_unique<FanProtocol>(&this->radio);
+    }
+
+    CC1101Emulator chip;
+    InternalGPIOPin gdo0;
+    InternalGPIOPin gdo2;
+    GPIOPin cs;
+    CC1101Controller radio;
+    std::unique_ptr<FanProtocol> protocol;
+};
+
+// A fan entity: one protocol unit of a remote talking to one main unit
+struct SimClient {
+    SimRemote *remote;
+    uint8_t unit;
+    FanPairingInfo pairing;
+    uint32_t next_command_ms;
+    uint32_t done;
+    bool running;
+};
+
+struct ScenarioResult {
+    uint32_t operations{0};
+    uint32_t acked{0};
+    std::vector<uint32_t> time_to_ack_ms;
+};
+
+static uint32_t percentile(std::vector<uint32_t> values, uint8_t percent) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[(values.size() - 1) * percent / 100];
+}
+
+static void run_scenario(const Scenario &scenario, uint32_t operations_per_client) {
+    host::set_random_seed(scenario.channel.seed);
+    SimChannel channel(scenario.channel);
+
+    std::vector<std::unique_ptr<SimRemote>> remotes;
+    std::vector<std::unique_ptr<SimMainUnit>> units;
+    std::vector<SimClient> clients;
+    for (uint8_t r = 0; r < scenario.remotes; r++) {
+        remotes.push_back(std::make_unique<SimRemote>());
+        channel.add_radio(&remotes.back()->chip, -60.0f);
+    }
+    for (uint8_t r = 0; r < scenario.remotes; r++) {
+        for (uint8_t u = 0; u < scenario.units_per_remote; u++) {
+            uint8_t unit_id = 0x40 + r * FAN_MAX_UNITS + u;
+            uint32_t network_id = 0x5A000000 | (unit_id << 8) | r;
+            units.push_back(std::make_unique<SimMainUnit>(network_id, unit_id));
+            units.back()->set_pairing_open(scenario.pairing);
+            // Pairing: the first unit is the strongest and should be joined. Units
+            // answering discovery at the same moment would collide every time, so
+            // the open units take turns.
+            uint32_t reply_delay_ms = scenario.reply_delay_ms + (scenario.pairing ? u * PAIRING_REPLY_SPREAD_MS : 0);
+            channel.add_main_unit(units.back().get(), reply_delay_ms, -55.0f - 10.0f * u);
+            if (!scenario.pairing) {
+                FanPairingInfo pairing{network_id, unit_id, FAN_TYPE_MAIN_UNIT, static_cast<uint8_t>(0x20 + r)};
+                uint32_t first_ms = random_uint32() % MAX_COMMAND_GAP_MS;
+                clients.push_back(SimClient{remotes[r].get(), u, pairing, first_ms, 0, false});
+            }
+        }
+        if (scenario.pairing) {
+            // One pairing per board; every open unit answers its discovery
+            clients.push_back(SimClient{remotes[r].get(), 0, {}, random_uint32() % MAX_COMMAND_GAP_MS, 0, false});
+        }
+    }
+
+    ScenarioResult result;
+    uint32_t start_ms = millis();
+    uint32_t expected = operations_per_client * clients.size();
+    while (result.operations < expected && millis() - start_ms < SCENARIO_LIMIT_MS) {
+        host::advance_us(STEP_US);
+        channel.update();
+        uint32_t now = millis() - start_ms;
+        for (auto &client : clients) {
+            if (client.running || client.done >= operations_per_client || now < client.next_command_ms) {
+                continue;
+            }
+            client.running = true;
+            SimClient *c = &client;
+            auto on_complete = [c, &result, &scenario, start_ms, &units](const FanOperationResult &r) {
+                c->running = false;
+                c->done++;
+                uint32_t gap_ms = MIN_COMMAND_GAP_MS + random_uint32() % (MAX_COMMAND_GAP_MS - MIN_COMMAND_GAP_MS);
+                c->next_command_ms = millis() - start_ms + gap_ms;
+                result.operations++;
+                bool acked = r.outcome == FanOperationOutcome::ACKED;
+                if (scenario.pairing) {
+                    // Only joining the strongest unit counts
+                    acked = acked && r.pairing && r.pairing->main_unit_id == units[0]->get_unit_id();
+                }
+                if (acked) {
+                    result.acked++;
+                    result.time_to_ack_ms.push_back(r.elapsed_ms);
+                }
+            };
+            if (scenario.pairing) {
+                client.remote->protocol->start_pairing(client.unit, true, std::move(on_complete));
+            } else {
+                uint8_t speed = FAN_SPEED_LOW + (client.done % FAN_SPEED_MAX);
+                client.remote->protocol->start_set_speed(client.unit, client.pairing, speed, 0, std::move(on_complete));
+            }
+        }
+        for (auto &remote : remotes) {
+            remote->chip.update();
+            remote->protocol->process();
+        }
+    }
+
+    double success = result.operations > 0 ? 100.0 * result.acked / result.operations : 0.0;
+    double operations = std::max<uint32_t>(result.operations, 1);
+    printf("%-22s %5" PRIu32 " %6" PRIu32 " %7.1f%% %7" PRIu32 " %7" PRIu32 " %9.2f %10.1f %8" PRIu32 "\n",
+           scenario.name, result.operations, result.acked, success, percentile(result.time_to_ack_ms, 50),
+           percentile(result.time_to_ack_ms, 99), channel.get_radio_frames() / operations,
+           channel.get_radio_airtime_us() / 1000.0 / operations, channel.get_overlaps());
+
+    CHECK(result.operations == expected);
+    if (scenario.must_succeed) {
+        CHECK(result.acked == result.operations);
+    }
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    uint32_t operations = quick ? 4 : 40;
+    host::set_manual_clock(true);
+    host::set_log_level(HOST_LOG_LEVEL_ERROR);
+
+    // name, {loss %, latency us, collision %, interferer frames/min, seed},
+    // remotes, units per remote, reply delay ms, pairing, must succeed
+    const Scenario scenarios[] = {
+        {"clean", {0, 0, 100, 0, 1}, 1, 1, 15, false, true},
+        {"loss 10%", {10, 0, 100, 0, 2}, 1, 1, 15, false, false},
+        {"loss 30%", {30, 0, 100, 0, 3}, 1, 1, 15, false, false},
+        {"slow fan 300 ms", {0, 2000, 100, 0, 4}, 1, 1, 300, false, true},
+        {"4 units, one remote", {0, 0, 100, 0, 5}, 1, 4, 15, false, true},
+        {"3 remotes", {5, 0, 100, 0, 6}, 3, 1, 15, false, false},
+        {"3 remotes, capture", {5, 0, 30, 0, 7}, 3, 1, 15, false, false},
+        {"foreign traffic", {0, 0, 100, 30, 8}, 1, 1, 15, false, false},
+        {"pairing, 2 open units", {0, 0, 100, 0, 9}, 1, 2, 15, true, true},
+        {"pairing, loss 20%", {20, 0, 100, 0, 10}, 1, 2, 15, true, false},
+    };
+
+    printf("%-22s %5s %6s %8s %7s %7s %9s %10s %8s\n", "scenario", "ops", "acked", "success", "p50 ms", "p99 ms",
+           "frames/op", "airtime/op", "overlaps");
+    for (const auto &scenario : scenarios) {
+        run_scenario(scenario, operations);
+    }
+    return check_result();
+}
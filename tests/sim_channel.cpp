@@ -0,0 +1,150 @@
+#include "sim_channel.h"
+
+#include "esphome/core/hal.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace esphome {
+namespace zehnder_fan {
+
+static const uint8_t INTERFERER_UNIT_ID = 0x7E;  // Main unit of another household, not simulated
+static const float INTERFERER_RSSI_DBM = -80.0f;
+
+SimChannel::SimChannel(const SimChannelConfig &config) : config_(config), random_state_(config.seed | 1) {}
+
+uint32_t SimChannel::next_random() {
+    this->random_state_ ^= this->random_state_ << 13;
+    this->random_state_ ^= this->random_state_ >> 17;
+    this->random_state_ ^= this->random_state_ << 5;
+    return this->random_state_;
+}
+
+int SimChannel::add_radio(CC1101Emulator *chip, float rssi_dbm) {
+    int index = this->nodes_.size();
+    this->nodes_.push_back(Node{chip, nullptr, 0, rssi_dbm});
+    chip->set_transmit_listener([this, index](const uint8_t *frame, uint32_t end_us) {
+        this->radio_frames_++;
+        this->radio_airtime_us_ += end_us - micros();
+        this->start(index, frame, micros(), end_us);
+    });
+    return index;
+}
+
+int SimChannel::add_main_unit(SimMainUnit *unit, uint32_t reply_delay_ms, float rssi_dbm) {
+    this->nodes_.push_back(Node{nullptr, unit, reply_delay_ms * 1000, rssi_dbm});
+    return this->nodes_.size() - 1;
+}
+
+void SimChannel::start(int source, const uint8_t *frame, uint32_t start_us, uint32_t end_us) {
+    Transmission transmission{source, start_us, end_us, {}, false, 0};
+    memcpy(transmission.frame, frame, FAN_FRAMESIZE);
+    for (auto &other : this->on_air_) {
+        if ((int32_t) (other.end_us - start_us) <= 0) {
+            continue;
+        }
+        // Neither sender hears the other while its own frame is on the air
+        if (source != INTERFERER) {
+            other.deaf |= 1u << source;
+        }
+        if (other.source != INTERFERER) {
+            transmission.deaf |= 1u << other.source;
+        }
+        this->overlaps_++;
+        transmission.garbled = true;
+        if (this->next_random() % 100 < this->config_.collision_percent) {
+            other.garbled = true;
+        }
+    }
+    this->on_air_.push_back(transmission);
+}
+
+void SimChannel::deliver(const Transmission &transmission) {
+    float rssi_dbm =
+        transmission.source == INTERFERER ? INTERFERER_RSSI_DBM : this->nodes_[transmission.source].rssi_dbm;
+    for (size_t i = 0; i < this->nodes_.size(); i++) {
+        Node &node = this->nodes_[i];
+        if ((int) i == transmission.source || (transmission.deaf & (1u << i))) {
+            continue;
+        }
+        if (this->next_random() % 100 < this->config_.loss_percent) {
+            continue;
+        }
+        if (node.chip != nullptr) {
+            node.chip->receive(transmission.frame, rssi_dbm, !transmission.garbled);
+            continue;
+        }
+        Transmission reply{(int) i, 0, 0, {}, false, 0};
+        if (!transmission.garbled && node.unit->answer(transmission.frame, reply.frame)) {
+            reply.start_us = micros() + node.reply_delay_us;
+            reply.end_us = reply.start_us + this->airtime_us_;
+            this->scheduled_.push_back(reply);
+        }
+    }
+}
+
+void SimChannel::schedule_interference(uint32_t now) {
+    // Poisson arrivals: exponentially distributed gaps
+    double mean_us = 60e6 / this->config_.interferer_frames_per_min;
+    double uniform = (this->next_random() + 1.0) / 4294967297.0;
+    this->next_interference_us_ = now + static_cast<uint32_t>(-std::log(uniform) * mean_us);
+}
+
+void SimChannel::update() {
+    uint32_t now = micros();
+    if (this->airtime_us_ == 0) {
+        for (const auto &node : this->nodes_) {
+            if (node.chip != nullptr) {
+                this->airtime_us_ = node.chip->get_frame_airtime_us();
+                break;
+            }
+        }
+        if (this->config_.interferer_frames_per_min > 0) {
+            this->schedule_interference(now);
+        }
+    }
+
+    for (size_t i = 0; i < this->scheduled_.size();) {
+        Transmission &due = this->scheduled_[i];
+        if ((int32_t) (now - due.start_us) >= 0) {
+            Transmission transmission = due;
+            this->scheduled_.erase(this->scheduled_.begin() + i);
+            this->start(transmission.source, transmission.frame, transmission.start_us, transmission.end_us);
+        } else {
+            i++;
+        }
+    }
+    if (this->config_.interferer_frames_per_min > 0 && (int32_t) (now - this->next_interference_us_) >= 0) {
+        uint8_t frame[FAN_FRAMESIZE];
+        build_set_speed_frame(frame, INTERFERER_UNIT_ID, this->next_random() & 0xFE, FAN_SPEED_MEDIUM, 0);
+        this->start(INTERFERER, frame, now, now + this->airtime_us_);
+        this->schedule_interference(now);
+    }
+
+    for (size_t i = 0; i < this->on_air_.size();) {
+        if ((int32_t) (now - (this->on_air_[i].end_us + this->config_.latency_us)) >= 0) {
+            Transmission transmission = this->on_air_[i];
+            this->on_air_.erase(this->on_air_.begin() + i);
+            this->deliver(transmission);
+        } else {
+            i++;
+        }
+    }
+
+    for (size_t i = 0; i < this->nodes_.size(); i++) {
+        if (this->nodes_[i].chip == nullptr) {
+            continue;
+        }
+        bool carrier = false;
+        for (const auto &transmission : this->on_air_) {
+            if (transmission.source != (int) i && (int32_t) (now - transmission.start_us) >= 0 &&
+                (int32_t) (transmission.end_us - now) > 0) {
+                carrier = true;
+            }
+        }
+        this->nodes_[i].chip->set_carrier(carrier);
+    }
+}
+
+} // namespace zehnder_fan
+} // namespace esphome
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "cc1101_emulator.h"
+#include "sim_main_unit.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace zehnder_fan {
+
+struct SimChannelConfig {
+    uint8_t loss_percent{0};                // Frames a receiver misses, rolled per receiver
+    uint32_t latency_us{0};                 // From the end of a frame on the air to its delivery
+    uint8_t collision_percent{100};         // Overlaps that destroy both frames; otherwise the earlier one survives
+    uint32_t interferer_frames_per_min{0};  // Foreign remotes talking to other units on the same channel
+    uint32_t seed{1};
+};
+
+// The shared 868 MHz channel between emulated CC1101s and simulated main
+// units. A frame is delivered to every other node when it ends, unless the
+// receiver lost it, was transmitting itself meanwhile, or it overlapped with
+// another frame: then it arrives garbled, with CRC_OK clear. While a frame is
+// on the air every other CC1101 sees a carrier. Main units answer after their
+// reply delay, without carrier sense. Has its own random sequence, so runs
+// with the same seed are identical.
+class SimChannel {
+public:
+    explicit SimChannel(const SimChannelConfig &config);
+
+    // Both return the node index; the CC1101's transmissions go on the air from now on
+    int add_radio(CC1101Emulator *chip, float rssi_dbm);
+    int add_main_unit(SimMainUnit *unit, uint32_t reply_delay_ms, float rssi_dbm);
+
+    // Starts due replies and interference, delivers frames that ended and
+    // updates carrier sense. Call after every clock step.
+    void update();
+
+    uint32_t get_radio_frames() const { return this->radio_frames_; }
+    uint64_t get_radio_airtime_us() const { return this->radio_airtime_us_; }
+    uint32_t get_overlaps() const { return this->overlaps_; }
+
+protected:
+    static const int INTERFERER = -1;
+
+    struct Node {
+        CC1101Emulator *chip;
+        SimMainUnit *unit;
+        uint32_t reply_delay_us;
+        float rssi_dbm;  // Level this node's frames arrive with
+    };
+
+    struct Transmission {
+        int source;
+        uint32_t start_us;
+        uint32_t end_us;
+        uint8_t frame[FAN_FRAMESIZE];
+        bool garbled;
+        uint32_t deaf;  // Bit per node that was transmitting during this frame
+    };
+
+    void start(int source, const uint8_t *frame, uint32_t start_us, uint32_t end_us);
+    void deliver(const Transmission &transmission);
+    void schedule_interference(uint32_t now);
+    uint32_t next_random();
+
+    SimChannelConfig config_;
+    uint32_t random_state_;
+    std::vector<Node> nodes_;
+    std::vector<Transmission> on_air_;
+    std::vector<Transmission> scheduled_;  // Replies and interference that start later
+    uint32_t airtime_us_{0};               // Of one frame, taken from the first CC1101 transmission
+    uint32_t next_interference_us_{0};
+
+    uint32_t radio_frames_{0};
+    uint64_t radio_airtime_us_{0};
+    uint32_t overlaps_{0};
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
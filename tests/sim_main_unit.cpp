@@ -0,0 +1,56 @@
+#include "sim_main_unit.h"
+
+namespace esphome {
+namespace zehnder_fan {
+
+bool SimMainUnit::answer(const uint8_t *frame, uint8_t *reply) {
+    FrameView heard(frame);
+    if (!heard.is_valid()) {
+        return false;
+    }
+    FrameBuilder builder(reply);
+    builder.src(FAN_TYPE_MAIN_UNIT, this->unit_id_).dest(heard.src_type(), heard.src_id());
+
+    if (heard.is_to(FAN_TYPE_DISCOVERY, 0x00)) {
+        if (!this->pairing_open_ || heard.command() != FAN_NETWORK_JOIN_ACK ||
+            heard.param_u32le(0) != NETWORK_LINK_ID) {
+            return false;
+        }
+        builder.command(FAN_NETWORK_JOIN_OPEN).param_count(4).param_u32le(0, this->network_id_);
+        return true;
+    }
+    if (!heard.is_to(FAN_TYPE_MAIN_UNIT, this->unit_id_)) {
+        return false;
+    }
+
+    switch (heard.command()) {
+        case FAN_FRAME_SETSPEED:
+        case FAN_FRAME_SETTIMER:
+            this->speed_ = heard.param(0);
+            this->timer_minutes_ = heard.command() == FAN_FRAME_SETTIMER ? heard.param(1) : 0;
+            this->speed_commands_++;
+            builder.command(FAN_FRAME_SETSPEED_REPLY).param_count(1).param(0, this->speed_);
+            return true;
+        case FAN_TYPE_QUERY_DEVICE:
+            builder.command(FAN_TYPE_FAN_SETTINGS)
+                .param_count(3)
+                .param(FAN_SETTINGS_SPEED, this->speed_)
+                .param(FAN_SETTINGS_VOLTAGE, this->speed_ * 25)
+                .param(FAN_SETTINGS_TIMER, this->timer_minutes_);
+            return true;
+        case FAN_NETWORK_JOIN_REQUEST:
+            if (!this->pairing_open_ || heard.param_u32le(0) != this->network_id_) {
+                return false;
+            }
+            builder.command(FAN_NETWORK_JOIN_ACK).param_count(4).param_u32le(0, this->network_id_);
+            return true;
+        case FAN_FRAME_0B:
+            builder.command(FAN_FRAME_0B);
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace zehnder_fan
+} // namespace esphome
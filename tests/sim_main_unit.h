@@ -0,0 +1,39 @@
+#pragma once
+
+#include "fan_frame.h"
+
+#include <cstdint>
+
+namespace esphome {
+namespace zehnder_fan {
+
+// A Zehnder main unit as the remotes hear it: it answers speed and timer
+// commands, status queries and, while open for pairing, the discovery and
+// join exchange. Like the real unit it goes by frame contents only.
+class SimMainUnit {
+public:
+    SimMainUnit(uint32_t network_id, uint8_t unit_id) : network_id_(network_id), unit_id_(unit_id) {}
+
+    void set_pairing_open(bool open) { this->pairing_open_ = open; }
+
+    // Builds the answer to a frame the unit heard; false if it stays silent
+    bool answer(const uint8_t *frame, uint8_t *reply);
+
+    uint32_t get_network_id() const { return this->network_id_; }
+    uint8_t get_unit_id() const { return this->unit_id_; }
+    uint8_t get_speed() const { return this->speed_; }
+    uint8_t get_timer_minutes() const { return this->timer_minutes_; }
+    // Speed and timer commands accepted, repeats included
+    uint32_t get_speed_commands() const { return this->speed_commands_; }
+
+protected:
+    uint32_t network_id_;
+    uint8_t unit_id_;
+    bool pairing_open_{false};
+    uint8_t speed_{FAN_SPEED_LOW};
+    uint8_t timer_minutes_{0};
+    uint32_t speed_commands_{0};
+};
+
+} // namespace zehnder_fan
+} // namespace esphome
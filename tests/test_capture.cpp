@@ -0,0 +1,153 @@
+// Frame capture: FanCapture keeps the latest FAN_CAPTURE_SIZE records oldest
+// first once it wraps, sequence numbers included. Then the protocol runs
+// enough exchanges on the mock radio to wrap its capture, and the dump is
+// read back from the log the way a host tool would: the begin line, one hex
+// line per 32-byte record, the end line. Given a path, the test also saves
+// the log there, for capture_tool to replay.
+
+#include "check.h"
+#include "esphome/core/log.h"
+#include "host.h"
+#include "zehnder_fan.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static const uint32_t OPERATIONS = 40;  // Two records each, so the capture wraps
+static const uint32_t OPERATION_LIMIT_MS = 1000;
+
+static void test_ring() {
+    FanCapture capture;
+    CHECK(capture.size() == 0);
+
+    FanCaptureRecord record{};
+    for (uint32_t i = 0; i < 10; i++) {
+        record.timestamp_us = i;
+        capture.add(record);
+    }
+    CHECK(capture.size() == 10);
+    CHECK(capture.get(0).timestamp_us == 0 && capture.get(9).timestamp_us == 9);
+
+    // Past 16 bits the sequence wraps too; records stay consecutive modulo 2^16
+    const uint32_t total = 70000;
+    for (uint32_t i = 10; i < total; i++) {
+        record.timestamp_us = i;
+        capture.add(record);
+    }
+    CHECK(capture.size() == FAN_CAPTURE_SIZE);
+    for (size_t i = 0; i < capture.size(); i++) {
+        uint32_t expected = total - FAN_CAPTURE_SIZE + i;
+        CHECK(capture.get(i).timestamp_us == expected);
+        CHECK(capture.get(i).sequence == static_cast<uint16_t>(expected));
+    }
+}
+
+static bool parse_hex(const std::string &hex, uint8_t *out, size_t length) {
+    if (hex.size() != 2 * length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        unsigned byte;
+        if (sscanf(hex.c_str() + 2 * i, "%2x", &byte) != 1) {
+            return false;
+        }
+        out[i] = byte;
+    }
+    return true;
+}
+
+static void test_dump(const char *log_path) {
+    host::set_manual_clock(true);
+    MockRadio radio;
+    radio.set_reply_delay(15);
+    FanProtocol protocol(&radio);
+    const FanPairingInfo pairing{MOCK_NETWORK_ID, MOCK_MAIN_UNIT_ID, FAN_TYPE_MAIN_UNIT, 0x21};
+
+    uint32_t acked = 0;
+    for (uint32_t i = 0; i < OPERATIONS; i++) {
+        bool done = false;
+        uint8_t speed = FAN_SPEED_LOW + i % FAN_SPEED_MAX;
+        protocol.start_set_speed(0, pairing, speed, 0, [&done, &acked](const FanOperationResult &result) {
+            done = true;
+            acked += result.outcome == FanOperationOutcome::ACKED;
+        });
+        for (uint32_t ms = 0; !done && ms < OPERATION_LIMIT_MS; ms++) {
+            host::advance_us(1000);
+            protocol.process();
+        }
+    }
+    CHECK(acked == OPERATIONS);
+
+    std::vector<std::string> lines;
+    FILE *log = log_path != nullptr ? fopen(log_path, "w") : nullptr;
+    CHECK(log_path == nullptr || log != nullptr);
+    host::set_log_listener([&lines, log](int level, const char *tag, const std::string &line) {
+        if (line.compare(0, 7, "Capture") == 0) {
+            lines.push_back(line);
+        }
+        if (log != nullptr) {
+            fprintf(log, "[I][%s]: %s\n", tag, line.c_str());
+        }
+    });
+    protocol.dump_capture();
+    host::set_log_listener(nullptr);
+    if (log != nullptr) {
+        fclose(log);
+    }
+
+    char begin[64];
+    snprintf(begin, sizeof(begin), "Capture begin: version %u, %u records of %u bytes", FAN_CAPTURE_VERSION,
+             (unsigned) FAN_CAPTURE_SIZE, (unsigned) sizeof(FanCaptureRecord));
+    CHECK(lines.size() == FAN_CAPTURE_SIZE + 2);
+    if (lines.size() != FAN_CAPTURE_SIZE + 2) {
+        return;
+    }
+    CHECK(lines.front() == begin);
+    CHECK(lines.back() == "Capture end");
+
+    std::vector<FanCaptureRecord> records(FAN_CAPTURE_SIZE);
+    for (size_t i = 0; i < FAN_CAPTURE_SIZE; i++) {
+        const std::string &line = lines[i + 1];
+        CHECK(line.compare(0, 9, "Capture: ") == 0);
+        CHECK(parse_hex(line.substr(9), reinterpret_cast<uint8_t *>(&records[i]), sizeof(FanCaptureRecord)));
+    }
+
+    // The oldest exchanges were overwritten; the latest FAN_CAPTURE_SIZE / 2
+    // are left, each frame followed by its reply
+    uint16_t first = 2 * OPERATIONS - FAN_CAPTURE_SIZE;
+    for (size_t i = 0; i < records.size(); i++) {
+        const FanCaptureRecord &record = records[i];
+        CHECK(record.sequence == first + i);
+        if (i > 0) {
+            CHECK((int32_t) (record.timestamp_us - records[i - 1].timestamp_us) >= 0);
+        }
+        FrameView view(record.data);
+        if (i % 2 == 0) {
+            CHECK(record.direction == static_cast<uint8_t>(FanCaptureDirection::TX));
+            CHECK(record.unit == 0);
+            CHECK(view.is_to(FAN_TYPE_MAIN_UNIT, MOCK_MAIN_UNIT_ID) && view.command() == FAN_FRAME_SETSPEED);
+            uint32_t operation = (first + i) / 2;
+            CHECK(view.param(0) == FAN_SPEED_LOW + operation % FAN_SPEED_MAX);
+            CHECK(record.status[0] == 0 && record.status[1] == 0);
+        } else {
+            CHECK(record.direction == static_cast<uint8_t>(FanCaptureDirection::RX));
+            CHECK(view.is_from(FAN_TYPE_MAIN_UNIT, MOCK_MAIN_UNIT_ID));
+            CHECK(record.status[0] == MOCK_RSSI_RAW);
+        }
+        for (uint8_t byte : record.reserved) {
+            CHECK(byte == 0);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    host::set_log_level(HOST_LOG_LEVEL_ERROR);
+    test_ring();
+    test_dump(argc > 1 ? argv[1] : nullptr);
+    return check_result();
+}
@@ -0,0 +1,237 @@
+// Capture tool: the log reader finds the dumps between other log output and
+// returns each record once whether the log is mapped or streamed, the frame
+// decoder names every command, the statistics count retries and reply
+// latency per main unit, and a replay on the emulated CC1101 sends the
+// captured frames again, or reports where the protocol no longer does.
+
+#include "capture_log.h"
+#include "capture_replay.h"
+#include "check.h"
+#include "esphome/core/log.h"
+#include "host.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static const uint8_t MAIN_UNIT = 0x4D;
+static const uint8_t OTHER_UNIT = 0x4E;
+static const uint8_t REMOTE = 0x21;
+static const uint8_t RSSI_RAW = 20;
+static const uint8_t LQI_CRC_OK = CC1101_LQI_CRC_OK | 10;
+
+static FanCaptureRecord make_record(uint16_t sequence, uint32_t timestamp_us, FanCaptureDirection direction,
+                                    uint8_t attempt = 0) {
+    FanCaptureRecord record{};
+    record.sequence = sequence;
+    record.timestamp_us = timestamp_us;
+    record.direction = static_cast<uint8_t>(direction);
+    record.unit = 0;
+    record.op_type = static_cast<uint8_t>(RadioOperationType::SET_SPEED);
+    record.attempt = attempt;
+    if (direction == FanCaptureDirection::RX) {
+        record.op_state = static_cast<uint8_t>(RadioOperationState::WAITING_RESPONSE);
+        record.status[0] = RSSI_RAW;
+        record.status[1] = LQI_CRC_OK;
+    } else {
+        record.op_state = static_cast<uint8_t>(RadioOperationState::TRANSMITTING);
+    }
+    return record;
+}
+
+static FanCaptureRecord set_speed(uint16_t sequence, uint32_t timestamp_us, uint8_t speed, uint8_t attempt = 0) {
+    FanCaptureRecord record = make_record(sequence, timestamp_us, FanCaptureDirection::TX, attempt);
+    build_set_speed_frame(record.data, MAIN_UNIT, REMOTE, speed, 0);
+    return record;
+}
+
+static FanCaptureRecord reply(uint16_t sequence, uint32_t timestamp_us, uint8_t speed, uint8_t from = MAIN_UNIT) {
+    FanCaptureRecord record = make_record(sequence, timestamp_us, FanCaptureDirection::RX);
+    FrameBuilder(record.data)
+        .src(FAN_TYPE_MAIN_UNIT, from)
+        .dest(FAN_TYPE_REMOTE_CONTROL, REMOTE)
+        .command(FAN_FRAME_SETSPEED_REPLY)
+        .param_count(1)
+        .param(0, speed);
+    return record;
+}
+
+static std::string record_line(const FanCaptureRecord &record) {
+    std::string line = "[12:00:00][I][zehnder_fan:123]: Capture: ";
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&record);
+    char hex[3];
+    for (size_t i = 0; i < sizeof(record); i++) {
+        snprintf(hex, sizeof(hex), "%02x", bytes[i]);
+        line += hex;
+    }
+    return line + "\033[0m\n";
+}
+
+static std::string dump(const std::vector<FanCaptureRecord> &records, unsigned version = FAN_CAPTURE_VERSION) {
+    char begin[128];
+    snprintf(begin, sizeof(begin),
+             "[12:00:00][I][zehnder_fan:120]: Capture begin: version %u, %u records of %u bytes\n", version,
+             (unsigned) records.size(), (unsigned) sizeof(FanCaptureRecord));
+    std::string text = begin;
+    for (const FanCaptureRecord &record : records) {
+        text += record_line(record);
+    }
+    return text + "[12:00:00][I][zehnder_fan:125]: Capture end\n";
+}
+
+static bool same_records(const std::vector<FanCaptureRecord> &a, const std::vector<FanCaptureRecord> &b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(FanCaptureRecord)) == 0;
+}
+
+static void test_reader() {
+    std::vector<FanCaptureRecord> first{set_speed(10, 1000, FAN_SPEED_LOW), reply(11, 16000, FAN_SPEED_LOW),
+                                        set_speed(12, 30000, FAN_SPEED_HIGH), reply(13, 45000, FAN_SPEED_HIGH)};
+    // The second dump repeats two records, then comes a gap of two
+    std::vector<FanCaptureRecord> second{first[2], first[3], set_speed(16, 90000, FAN_SPEED_MAX),
+                                         reply(17, 105000, FAN_SPEED_MAX)};
+    FanCaptureRecord corrupt = set_speed(18, 120000, FAN_SPEED_AUTO);
+    std::string bad_line = record_line(corrupt);
+    bad_line.erase(bad_line.find("Capture: ") + 20, 2);
+
+    std::string log = "[12:00:00][I][app]: Running\n" + dump(first) + "[12:00:01][D][zehnder_fan]: Fan speed 4\n" +
+                      dump(second) + dump({corrupt}, FAN_CAPTURE_VERSION + 1) + "Capture begin: version 1\n" +
+                      bad_line + "Capture end";
+
+    CaptureLogReader streamed;
+    std::vector<uint16_t> listened;
+    streamed.set_record_listener([&listened](const FanCaptureRecord &record) { listened.push_back(record.sequence); });
+    FILE *stream = fmemopen(const_cast<char *>(log.data()), log.size(), "r");
+    CHECK(stream != nullptr && streamed.read_stream(stream));
+    fclose(stream);
+
+    const std::vector<FanCaptureRecord> &records = streamed.get_records();
+    CHECK(records.size() == 6);
+    CHECK(listened == (std::vector<uint16_t>{10, 11, 12, 13, 16, 17}));
+    if (records.size() == 6) {
+        CHECK(memcmp(&records[4], &second[2], sizeof(FanCaptureRecord)) == 0);
+    }
+    // The newer version is not read; the line it dumps counts as not understood
+    CHECK(streamed.get_dumps() == 3);
+    CHECK(streamed.get_missed() == 2);
+    CHECK(streamed.get_bad_lines() == 2);
+
+    char path[] = "/tmp/capture_logXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0 && write(fd, log.data(), log.size()) == (ssize_t) log.size());
+    close(fd);
+    CaptureLogReader mapped;
+    CHECK(mapped.read_file(path));
+    unlink(path);
+    CHECK(same_records(mapped.get_records(), records));
+    CHECK(mapped.get_missed() == streamed.get_missed() && mapped.get_bad_lines() == streamed.get_bad_lines());
+
+    CaptureLogReader missing;
+    CHECK(!missing.read_file("/nonexistent/capture.log"));
+
+    // A device that restarted counts from zero again
+    CaptureLogReader restarted;
+    std::string restart_log =
+        dump(first) + dump({set_speed(0, 500, FAN_SPEED_MEDIUM), reply(1, 15500, FAN_SPEED_MEDIUM)});
+    stream = fmemopen(const_cast<char *>(restart_log.data()), restart_log.size(), "r");
+    CHECK(stream != nullptr && restarted.read_stream(stream));
+    fclose(stream);
+    CHECK(restarted.get_records().size() == 6 && restarted.get_missed() == 0);
+}
+
+static void test_describe() {
+    uint8_t frame[FAN_FRAMESIZE];
+    build_set_speed_frame(frame, MAIN_UNIT, REMOTE, FAN_SPEED_HIGH, 0);
+    CHECK(describe_frame(frame) == "remote 0x21 -> main 0x4D: SETSPEED speed=HIGH");
+    build_set_speed_frame(frame, MAIN_UNIT, REMOTE, FAN_SPEED_MAX, 30);
+    CHECK(describe_frame(frame) == "remote 0x21 -> main 0x4D: SETTIMER speed=MAX timer=30min");
+    build_query_device_frame(frame, MAIN_UNIT, REMOTE);
+    CHECK(describe_frame(frame) == "remote 0x21 -> main 0x4D: QUERY_DEVICE");
+    build_discover_frame(frame, REMOTE);
+    CHECK(describe_frame(frame).find("-> discovery: JOIN_ACK network=0x") != std::string::npos);
+    build_join_request_frame(frame, MAIN_UNIT, REMOTE, 0x12345678);
+    CHECK(describe_frame(frame) == "remote 0x21 -> main 0x4D: JOIN_REQUEST network=0x12345678");
+
+    FrameBuilder(frame).src(FAN_TYPE_MAIN_UNIT, MAIN_UNIT).dest(FAN_TYPE_REMOTE_CONTROL, REMOTE)
+        .command(FAN_TYPE_FAN_SETTINGS).param_count(3)
+        .param(FAN_SETTINGS_SPEED, FAN_SPEED_LOW).param(FAN_SETTINGS_VOLTAGE, 30).param(FAN_SETTINGS_TIMER, 0);
+    CHECK(describe_frame(frame) == "main 0x4D -> remote 0x21: FAN_SETTINGS speed=LOW voltage=30% timer=0min");
+    FrameBuilder(frame).src(FAN_TYPE_MAIN_UNIT, MAIN_UNIT).dest(FAN_TYPE_REMOTE_CONTROL, REMOTE)
+        .command(FAN_NETWORK_JOIN_OPEN).param_count(4).param_u32le(0, 0xA1B2C3D4);
+    CHECK(describe_frame(frame) == "main 0x4D -> remote 0x21: JOIN_OPEN network=0xA1B2C3D4");
+    FrameBuilder(frame).src(FAN_TYPE_MAIN_UNIT, MAIN_UNIT).dest(FAN_TYPE_REMOTE_CONTROL, REMOTE).command(FAN_FRAME_0B);
+    CHECK(describe_frame(frame) == "main 0x4D -> remote 0x21: FRAME_0B");
+    FrameBuilder(frame).src(FAN_TYPE_MAIN_UNIT, MAIN_UNIT).dest(FAN_TYPE_REMOTE_CONTROL, REMOTE).command(0x77)
+        .param_count(2).param(0, 0xAB).param(1, 0xCD);
+    CHECK(describe_frame(frame) == "main 0x4D -> remote 0x21: command 0x77 AB CD");
+
+    FanCaptureRecord record = reply(5, 16000, FAN_SPEED_LOW);
+    std::string line = describe_record(record, 1000);
+    CHECK(line.find("15.000 ms RX unit 0 set_speed/waiting_response attempt 1") != std::string::npos);
+    CHECK(line.find("SETSPEED_REPLY") != std::string::npos && line.find("LQI 10") != std::string::npos);
+    record.unit = FAN_CAPTURE_NO_UNIT;
+    CHECK(describe_record(record, 1000).find("RX listening  main 0x4D") != std::string::npos);
+}
+
+static void test_stats() {
+    // One exchange answered after 15 ms, one after a retry and 25 ms, one
+    // never answered, and a frame from a unit nobody addressed
+    std::vector<FanCaptureRecord> records{
+        set_speed(0, 1000, FAN_SPEED_LOW),      reply(1, 16000, FAN_SPEED_LOW),
+        set_speed(2, 30000, FAN_SPEED_HIGH),    set_speed(3, 530000, FAN_SPEED_HIGH, 1),
+        reply(4, 555000, FAN_SPEED_HIGH),       reply(5, 600000, FAN_SPEED_HIGH, OTHER_UNIT),
+        set_speed(6, 700000, FAN_SPEED_MAX),
+    };
+    CaptureStats stats;
+    stats.add(records);
+    CHECK(stats.get_peers().size() == 1 && stats.get_overheard() == 1);
+    const CapturePeerStats &peer = stats.get_peers().at(MAIN_UNIT);
+    CHECK(peer.operations == 3 && peer.frames_sent == 4 && peer.retries == 1 && peer.max_attempt == 2);
+    CHECK(peer.replies == 2 && peer.unanswered == 2);
+    CHECK(peer.latency_us == (std::vector<uint32_t>{15000, 25000}));
+    CHECK(peer.get_latency_percentile_us(50) == 15000 && peer.get_latency_percentile_us(100) == 25000);
+}
+
+static void test_replay() {
+    // The first exchange is the tail of an operation whose start was overwritten
+    std::vector<FanCaptureRecord> records{
+        reply(7, 500, FAN_SPEED_AUTO),
+        set_speed(8, 1000, FAN_SPEED_LOW),   reply(9, 16000, FAN_SPEED_LOW),
+        set_speed(10, 30000, FAN_SPEED_HIGH), set_speed(11, 530000, FAN_SPEED_HIGH, 1),
+        reply(12, 545000, FAN_SPEED_HIGH),
+    };
+    CaptureReplayResult result = CaptureReplay(records).run();
+    CHECK(result.skipped_records == 1);
+    CHECK(result.operations == 2 && result.acked == 2 && result.failed == 0);
+    CHECK(result.frames_matched == 3 && result.matches());
+    CHECK(result.frames_delivered == 2 && result.frames_not_heard == 0);
+
+    // Had the last reply failed its CRC, the protocol would have tried
+    // again, and the replay sends frames the capture does not hold
+    records.back().status[1] &= ~CC1101_LQI_CRC_OK;
+    result = CaptureReplay(records).run();
+    CHECK(result.operations == 2 && result.acked == 1 && result.failed == 1);
+    CHECK(result.frames_matched == 3 && result.frames_extra > 0 && !result.matches());
+
+    // A captured frame the protocol no longer sends
+    records = {set_speed(0, 1000, FAN_SPEED_LOW), reply(1, 16000, FAN_SPEED_LOW)};
+    records.push_back(set_speed(2, 17000, FAN_SPEED_LOW, 1));
+    result = CaptureReplay(records).run();
+    CHECK(result.frames_matched == 1 && result.frames_missing == 1 && !result.matches());
+}
+
+int main() {
+    host::set_log_level(HOST_LOG_LEVEL_ERROR);
+    host::set_manual_clock(true);
+    test_reader();
+    test_describe();
+    test_stats();
+    test_replay();
+    return check_result();
+}
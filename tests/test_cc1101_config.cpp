@@ -0,0 +1,67 @@
+// CC1101 radio parameters: after init() the emulated chip holds the
+// frequency, data rate, deviation, RX bandwidth and output power the build
+// asked for, read back from its registers with the datasheet formulas. Built
+// once with the defaults and once with the defines codegen emits for other
+// YAML values; CONFIG_* holds the physical values each build expects.
+
+#include "cc1101_emulator.h"
+#include "check.h"
+#include "esphome/core/log.h"
+#include "host.h"
+#include "zehnder_fan.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static const double XOSC_HZ = 26e6;
+
+static const uint8_t REG_FSCTRL0 = 0x0C;
+static const uint8_t REG_FREQ2 = 0x0D;
+static const uint8_t REG_FREQ1 = 0x0E;
+static const uint8_t REG_FREQ0 = 0x0F;
+static const uint8_t REG_MDMCFG4 = 0x10;
+static const uint8_t REG_MDMCFG3 = 0x11;
+static const uint8_t REG_DEVIATN = 0x15;
+
+int main() {
+    host::set_log_level(HOST_LOG_LEVEL_ERROR);
+    host::set_manual_clock(true);
+
+    CC1101Emulator chip;
+    InternalGPIOPin gdo0;
+    InternalGPIOPin gdo2;
+    GPIOPin cs;
+    CC1101Controller radio;
+    radio.set_spi_parent(&chip);
+    radio.set_cs_pin(&cs);
+    radio.set_gdo0_pin(&gdo0);
+    radio.set_gdo2_pin(&gdo2);
+    radio.init();
+
+    uint32_t freq = (chip.get_register(REG_FREQ2) << 16) | (chip.get_register(REG_FREQ1) << 8) |
+                    chip.get_register(REG_FREQ0);
+    double frequency_hz = freq * XOSC_HZ / (1 << 16);
+    double offset_hz = static_cast<int8_t>(chip.get_register(REG_FSCTRL0)) * XOSC_HZ / (1 << 14);
+    uint8_t mdmcfg4 = chip.get_register(REG_MDMCFG4);
+    double data_rate = (256 + chip.get_register(REG_MDMCFG3)) * std::ldexp(XOSC_HZ, (mdmcfg4 & 0x0F) - 28);
+    double bandwidth_hz = XOSC_HZ / (8 * (4 + ((mdmcfg4 >> 4) & 0x03)) * (1 << (mdmcfg4 >> 6)));
+    uint8_t deviatn = chip.get_register(REG_DEVIATN);
+    double deviation_hz = XOSC_HZ / (1 << 17) * (8 + (deviatn & 0x07)) * (1 << (deviatn >> 4));
+
+    printf("%.4f MHz %+.1f kHz, %.2f kBaud, deviation %.1f kHz, bandwidth %.1f kHz, PATABLE 0x%02X\n",
+           frequency_hz / 1e6, offset_hz / 1e3, data_rate / 1e3, deviation_hz / 1e3, bandwidth_hz / 1e3,
+           chip.get_patable());
+
+    // Within one step of each setting
+    CHECK(std::fabs(frequency_hz - CONFIG_FREQUENCY_HZ) <= XOSC_HZ / (1 << 16));
+    CHECK(std::fabs(offset_hz - CONFIG_FREQUENCY_OFFSET_HZ) <= XOSC_HZ / (1 << 14));
+    CHECK(std::fabs(data_rate - CONFIG_DATA_RATE) <= CONFIG_DATA_RATE / 256.0);
+    CHECK(std::fabs(deviation_hz - CONFIG_DEVIATION_HZ) <= deviation_hz / 8);
+    // The narrowest filter that passes the requested bandwidth
+    CHECK(std::round(bandwidth_hz) >= CONFIG_RX_BANDWIDTH_HZ && bandwidth_hz < CONFIG_RX_BANDWIDTH_HZ * 1.25);
+    CHECK(chip.get_patable() == CONFIG_PATABLE);
+    return check_result();
+}
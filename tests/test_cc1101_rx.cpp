@@ -0,0 +1,143 @@
+// CC1101 receive path: the driver on the register-level emulator, which
+// raises and drops GDO0 around every packet and answers the FIFO reads over
+// the host SPI bus. In interrupt mode an idle service_rx() must not touch
+// SPI, frames keep the time of their GDO0 edge however late the loop gets to
+// them, frames queued up during a stalled loop all come out in order, and a
+// frame failing CRC never reaches the protocol. Prints the per-call SPI cost
+// of both modes as a baseline.
+
+#include "cc1101_emulator.h"
+#include "check.h"
+#include "esphome/core/log.h"
+#include "host.h"
+#include "zehnder_fan.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static const uint32_t IDLE_CALLS = 1000;
+static const uint32_t LOOP_STALL_US = 50000;  // A main loop held up by WiFi or the API
+static const uint8_t STALL_FRAMES = 3;        // As many as fit the 64-byte RX FIFO
+static const float RSSI_DBM = -60.0f;
+
+struct RxRig {
+    explicit RxRig(bool rx_interrupt) {
+        this->radio.set_spi_parent(&this->chip);
+        this->radio.set_cs_pin(&this->cs);
+        this->radio.set_gdo0_pin(&this->gdo0);
+        this->radio.set_gdo2_pin(&this->gdo2);
+        this->radio.set_rx_interrupt(rx_interrupt);
+        this->chip.set_gdo0_pin(&this->gdo0);
+        this->chip.set_gdo2_pin(&this->gdo2);
+        this->radio.init();
+    }
+
+    // Waits out the calibration and settling of the first SRX
+    bool enter_rx() {
+        this->radio.set_mode_receive();
+        for (uint32_t i = 0; i < 100; i++) {
+            host::advance_us(100);
+            this->chip.update();
+            if (this->radio.get_state() == RadioState::RX) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    CC1101Emulator chip;
+    InternalGPIOPin gdo0;
+    InternalGPIOPin gdo2;
+    GPIOPin cs;
+    CC1101Controller radio;
+};
+
+static void make_frame(uint8_t *frame, uint8_t speed) {
+    build_set_speed_frame(frame, 0x42, 0x21, speed, 0);
+}
+
+static void test_mode(bool rx_interrupt) {
+    const char *mode = rx_interrupt ? "interrupt" : "polling";
+    RxRig rig(rx_interrupt);
+    CHECK(rig.enter_rx());
+
+    // Idle: nothing on the air
+    RxFrame rx;
+    SpiStats before = rig.radio.get_spi_stats();
+    for (uint32_t i = 0; i < IDLE_CALLS; i++) {
+        host::advance_us(1000);
+        rig.radio.service_rx();
+        CHECK(!rig.radio.pop_rx_frame(rx));
+    }
+    SpiStats idle = rig.radio.get_spi_stats() - before;
+    if (rx_interrupt) {
+        CHECK(idle.transactions == 0);
+    } else {
+        CHECK(idle.transactions == IDLE_CALLS);  // One SNOP; RXBYTES is only read once a frame is in
+    }
+
+    // One frame, picked up by a loop that stalled after the edge
+    uint8_t frame[FAN_FRAMESIZE];
+    make_frame(frame, FAN_SPEED_HIGH);
+    CHECK(rig.chip.receive(frame, RSSI_DBM, true));
+    uint32_t edge_us = micros();
+    host::advance_us(LOOP_STALL_US);
+    before = rig.radio.get_spi_stats();
+    rig.radio.service_rx();
+    SpiStats single = rig.radio.get_spi_stats() - before;
+    CHECK(rig.radio.pop_rx_frame(rx));
+    CHECK(memcmp(rx.data, frame, FAN_FRAMESIZE) == 0);
+    CHECK(rx.crc_ok() && rx.rssi_dbm() == RSSI_DBM);
+    uint32_t timestamp_error_us = rx.timestamp_us - edge_us;
+    if (rx_interrupt) {
+        CHECK(timestamp_error_us == 0);
+    }
+    CHECK(!rig.radio.pop_rx_frame(rx));
+
+    // Several frames back to back while the loop stalls, drained in one call
+    for (uint8_t i = 0; i < STALL_FRAMES; i++) {
+        make_frame(frame, FAN_SPEED_LOW + i);
+        CHECK(rig.chip.receive(frame, RSSI_DBM, true));
+        host::advance_us(rig.chip.get_frame_airtime_us());
+    }
+    host::advance_us(LOOP_STALL_US);
+    before = rig.radio.get_spi_stats();
+    rig.radio.service_rx();
+    SpiStats burst = rig.radio.get_spi_stats() - before;
+    for (uint8_t i = 0; i < STALL_FRAMES; i++) {
+        CHECK(rig.radio.pop_rx_frame(rx) && rx.view().param(0) == FAN_SPEED_LOW + i);
+    }
+    CHECK(!rig.radio.pop_rx_frame(rx));
+    CHECK(rig.radio.get_rx_overflows() == 0);
+
+    // A corrupted frame is read out of the FIFO but never handed on
+    make_frame(frame, FAN_SPEED_MEDIUM);
+    CHECK(rig.chip.receive(frame, RSSI_DBM, false));
+    rig.radio.service_rx();
+    CHECK(!rig.radio.pop_rx_frame(rx));
+    CHECK(rig.radio.get_crc_errors() == 1);
+
+    // The radio stayed in RX throughout; the FIFO was never flushed
+    CHECK(rig.radio.get_state() == RadioState::RX);
+
+    printf("%-10s %9.2f %9.2f %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %12" PRIu32 "\n", mode,
+           (double) idle.transactions / IDLE_CALLS, (double) idle.bytes / IDLE_CALLS, single.transactions,
+           single.bytes, burst.transactions, burst.bytes, timestamp_error_us);
+}
+
+int main() {
+    host::set_manual_clock(true);
+    host::set_log_level(HOST_LOG_LEVEL_ERROR);
+
+    printf("SPI cost of service_rx(), frames picked up %" PRIu32 " ms after their GDO0 edge\n",
+           LOOP_STALL_US / 1000);
+    printf("%-10s %9s %9s %9s %9s %9s %9s %12s\n", "rx mode", "idle txn", "idle B", "1 fr txn", "1 fr B",
+           "3 fr txn", "3 fr B", "ts error us");
+    test_mode(true);
+    test_mode(false);
+    return check_result();
+}
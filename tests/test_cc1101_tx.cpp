@@ -0,0 +1,150 @@
+// CC1101 carrier sense: after STX the protocol decides whether CCA held the
+// frame back. TXOFF_MODE=RX brings the chip back to RX once the frame is
+// out, so finding it in RX is not enough; a frame that was already sent must
+// not be sent again. Covered with the loop running as usual, with the loop
+// stalled past the end of the frame and its reply, and on a busy channel,
+// which defers the frame until it clears. Built for the default data rate
+// and for 250 kBaud, where the whole frame fits in the CCA decision window.
+
+#include "cc1101_emulator.h"
+#include "check.h"
+#include "esphome/core/log.h"
+#include "host.h"
+#include "sim_main_unit.h"
+#include "zehnder_fan.h"
+
+#include <cstdio>
+#include <memory>
+#include <optional>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static const uint32_t LOOP_INTERVAL_US = 1000;
+static const uint32_t REPLY_DELAY_US = 15000;
+static const uint32_t LOOP_STALL_US = 50000;  // Past the end of the frame, on top of its airtime
+static const uint32_t BUSY_US = 300000;
+static const uint32_t OPERATION_LIMIT_MS = 30000;
+static const uint32_t NETWORK_ID = 0x6B1A2C3D;
+static const uint8_t MAIN_UNIT_ID = 0x42;
+static const uint8_t MY_DEVICE_ID = 0x21;
+
+struct TxRig {
+    TxRig() : unit(NETWORK_ID, MAIN_UNIT_ID) {
+        this->radio.set_spi_parent(&this->chip);
+        this->radio.set_cs_pin(&this->cs);
+        this->radio.set_gdo0_pin(&this->gdo0);
+        this->radio.set_gdo2_pin(&this->gdo2);
+        this->chip.set_gdo0_pin(&this->gdo0);
+        this->chip.set_gdo2_pin(&this->gdo2);
+        this->chip.set_transmit_listener([this](const uint8_t *frame, uint32_t end_us) {
+            if (this->stall_next_frame) {
+                this->stall_next_frame = false;
+                this->stalled_until_us = end_us + LOOP_STALL_US;
+            }
+            if (this->unit.answer(frame, this->reply)) {
+                this->reply_pending = true;
+                this->reply_due_us = end_us + REPLY_DELAY_US + this->chip.get_frame_airtime_us();
+            }
+        });
+        this->radio.init();
+        this->protocol = std::make_unique<FanProtocol>(&this->radio);
+    }
+
+    void step() {
+        host::advance_us(LOOP_INTERVAL_US);
+        this->chip.update();
+        if (this->reply_pending && (int32_t) (micros() - this->reply_due_us) >= 0) {
+            this->reply_pending = false;
+            this->chip.receive(this->reply, -60.0f, true);
+        }
+        if ((int32_t) (micros() - this->stalled_until_us) >= 0) {
+            this->protocol->process();
+        }
+    }
+
+    std::optional<FanOperationResult> set_speed(uint8_t speed) {
+        FanPairingInfo pairing{NETWORK_ID, MAIN_UNIT_ID, FAN_TYPE_MAIN_UNIT, MY_DEVICE_ID};
+        std::optional<FanOperationResult> result;
+        this->protocol->start_set_speed(0, pairing, speed, 0,
+                                        [&result](const FanOperationResult &r) { result = r; });
+        uint32_t start_ms = millis();
+        while (!result && millis() - start_ms < OPERATION_LIMIT_MS) {
+            this->step();
+        }
+        return result;
+    }
+
+    CC1101Emulator chip;
+    InternalGPIOPin gdo0;
+    InternalGPIOPin gdo2;
+    GPIOPin cs;
+    CC1101Controller radio;
+    SimMainUnit unit;
+    std::unique_ptr<FanProtocol> protocol;
+
+    bool stall_next_frame{false};
+    uint32_t stalled_until_us{0};
+    bool reply_pending{false};
+    uint32_t reply_due_us{0};
+    uint8_t reply[FAN_FRAMESIZE]{};
+};
+
+// One frame on the air, one command at the unit, acked on the first attempt
+static void check_sent_once(TxRig &rig, const std::optional<FanOperationResult> &result, uint32_t frames_before,
+                            uint32_t commands_before) {
+    CHECK(result && result->outcome == FanOperationOutcome::ACKED && result->retries == 0);
+    CHECK(rig.chip.get_frames_sent() == frames_before + 1);
+    CHECK(rig.unit.get_speed_commands() == commands_before + 1);
+}
+
+int main() {
+    host::set_log_level(HOST_LOG_LEVEL_ERROR);
+    host::set_manual_clock(true);
+
+    TxRig rig;
+    for (uint32_t i = 0; i < 100 && !rig.radio.is_calibrated(); i++) {
+        rig.step();
+    }
+    CHECK(rig.radio.is_calibrated());
+    printf("Frame airtime %u us, CCA decision after %u us\n", (unsigned) rig.chip.get_frame_airtime_us(),
+           (unsigned) (FAN_CCA_DECISION_US + FAN_RXTX_TURNAROUND_BITS * rig.radio.get_bit_time_us()));
+
+    // Clear channel: one STX, one frame
+    uint32_t frames = rig.chip.get_frames_sent();
+    uint32_t commands = rig.unit.get_speed_commands();
+    uint32_t stx = rig.chip.get_strobe_count(CC1101_STX);
+    check_sent_once(rig, rig.set_speed(FAN_SPEED_HIGH), frames, commands);
+    CHECK(rig.chip.get_strobe_count(CC1101_STX) == stx + 1);
+    CHECK(rig.unit.get_speed() == FAN_SPEED_HIGH);
+
+    // The loop gets back to the protocol only after the frame went out, the
+    // chip is in RX again and the reply is already in the RX FIFO
+    frames = rig.chip.get_frames_sent();
+    commands = rig.unit.get_speed_commands();
+    rig.stall_next_frame = true;
+    check_sent_once(rig, rig.set_speed(FAN_SPEED_LOW), frames, commands);
+    CHECK(rig.unit.get_speed() == FAN_SPEED_LOW);
+
+    // Busy channel: STX is held back, and the frame goes out once it clears
+    frames = rig.chip.get_frames_sent();
+    commands = rig.unit.get_speed_commands();
+    stx = rig.chip.get_strobe_count(CC1101_STX);
+    rig.chip.set_carrier(true);
+    FanPairingInfo pairing{NETWORK_ID, MAIN_UNIT_ID, FAN_TYPE_MAIN_UNIT, MY_DEVICE_ID};
+    std::optional<FanOperationResult> result;
+    rig.protocol->start_set_speed(0, pairing, FAN_SPEED_MAX, 0, [&result](const FanOperationResult &r) { result = r; });
+    for (uint32_t us = 0; us < BUSY_US; us += LOOP_INTERVAL_US) {
+        rig.step();
+    }
+    CHECK(!result && rig.chip.get_frames_sent() == frames);
+    CHECK(rig.chip.get_strobe_count(CC1101_STX) > stx + 1);
+    rig.chip.set_carrier(false);
+    uint32_t start_ms = millis();
+    while (!result && millis() - start_ms < OPERATION_LIMIT_MS) {
+        rig.step();
+    }
+    check_sent_once(rig, result, frames, commands);
+    CHECK(rig.unit.get_speed() == FAN_SPEED_MAX);
+    return check_result();
+}
@@ -0,0 +1,88 @@
+// Frame codec: every builder round-trips through FrameView field by field,
+// parameter access stays inside the frame, and a throughput figure for
+// building and parsing frames in place.
+
+#include "check.h"
+#include "fan_frame.h"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace esphome::zehnder_fan;
+
+static const uint32_t THROUGHPUT_FRAMES = 10000000;
+
+static void test_round_trips() {
+    uint8_t frame[FAN_FRAMESIZE]{};
+    FrameView view(frame);
+
+    build_set_speed_frame(frame, 0x4D, 0x21, FAN_SPEED_HIGH, 0);
+    CHECK(view.is_to(FAN_TYPE_MAIN_UNIT, 0x4D) && view.is_from(FAN_TYPE_REMOTE_CONTROL, 0x21));
+    CHECK(view.ttl() == FAN_FRAME_TTL);
+    CHECK(view.command() == FAN_FRAME_SETSPEED && view.param_count() == 1 && view.param(0) == FAN_SPEED_HIGH);
+    CHECK(view.param(1) == 0 && view.is_valid());
+
+    build_set_speed_frame(frame, 0x4D, 0x21, FAN_SPEED_MAX, 30);
+    CHECK(view.command() == FAN_FRAME_SETTIMER && view.param_count() == 2);
+    CHECK(view.param(0) == FAN_SPEED_MAX && view.param(1) == 30);
+
+    build_query_device_frame(frame, 0x4D, 0x21);
+    CHECK(view.is_to(FAN_TYPE_MAIN_UNIT, 0x4D) && view.command() == FAN_TYPE_QUERY_DEVICE && view.param_count() == 0);
+
+    build_discover_frame(frame, 0x5C);
+    CHECK(view.is_to(FAN_TYPE_DISCOVERY, 0x00) && view.is_from(FAN_TYPE_REMOTE_CONTROL, 0x5C));
+    CHECK(view.command() == FAN_NETWORK_JOIN_ACK && view.param_count() == 4 && view.param_u32le(0) == NETWORK_LINK_ID);
+
+    // The join request carries the network id without announcing it
+    build_join_request_frame(frame, 0x4D, 0x5C, 0x12345678);
+    CHECK(view.command() == FAN_NETWORK_JOIN_REQUEST && view.param_count() == 0);
+    CHECK(view.param_u32le(0) == 0x12345678);
+    CHECK(frame[FRAME_PARAMS] == 0x78 && frame[FRAME_PARAMS + 3] == 0x12);
+
+    build_join_ack_frame(frame, 0x4D, 0x5C);
+    CHECK(view.is_from(FAN_TYPE_REMOTE_CONTROL, 0x5C) && view.command() == FAN_FRAME_0B);
+
+    // Every builder clears what an earlier frame left in the buffer
+    for (uint8_t i = FRAME_PARAMS; i < FAN_FRAMESIZE; i++) {
+        CHECK(frame[i] == 0);
+    }
+}
+
+static void test_bounds() {
+    uint8_t frame[FAN_FRAMESIZE]{};
+    FrameBuilder builder(frame);
+    builder.param_count(FAN_FRAME_MAX_PARAMS).param(FAN_FRAME_MAX_PARAMS - 1, 0xAB).param(FAN_FRAME_MAX_PARAMS, 0xCD);
+    FrameView view(frame);
+    CHECK(view.is_valid());
+    CHECK(view.param(FAN_FRAME_MAX_PARAMS - 1) == 0xAB);
+    CHECK(view.param(FAN_FRAME_MAX_PARAMS) == 0);
+    // A u32 running past the end reads the missing bytes as zero
+    CHECK(view.param_u32le(FAN_FRAME_MAX_PARAMS - 1) == 0xAB);
+
+    builder.param_count(FAN_FRAME_MAX_PARAMS + 1);
+    CHECK(!view.is_valid());
+}
+
+static void bench_throughput() {
+    uint8_t frame[FAN_FRAMESIZE]{};
+    uint32_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < THROUGHPUT_FRAMES; i++) {
+        build_set_speed_frame(frame, i & 0xFF, (i >> 8) & 0xFF, i % 5, (i >> 4) & 0x0F);
+        FrameView view(frame);
+        if (view.is_valid() && view.is_to(FAN_TYPE_MAIN_UNIT, i & 0xFF)) {
+            checksum += view.command() + view.param(0) + view.param(1);
+        }
+        // Keeps the compiler from dropping the loop
+        asm volatile("" : : "r"(frame) : "memory");
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("Frame build + parse: %.1f ns per frame (checksum %u)\n", ns / THROUGHPUT_FRAMES, (unsigned) checksum);
+}
+
+int main() {
+    test_round_trips();
+    test_bounds();
+    bench_throughput();
+    return check_result();
+}
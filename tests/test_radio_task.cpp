@@ -0,0 +1,145 @@
+// Radio task: ZehnderRadio built with USE_ZEHNDER_FAN_RADIO_TASK on the mock
+// backend and the real clock. Commands for several units go to the task,
+// completions come back through the main loop only after the task woke it,
+// each once and in the order the exchanges finished. Record writes wait
+// from the first change on, one still waiting is flushed by on_shutdown(),
+// and stop_tasks() ends the task.
+
+#include "check.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "host.h"
+#include "zehnder_fan.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::zehnder_fan;
+
+static const char *const RADIO_ID = "fan_radio";
+static const uint32_t REPLY_DELAY_MS = 5;
+static const uint32_t COMPLETION_LIMIT_MS = 5000;
+
+struct Completion {
+    uint8_t unit;
+    FanOperationOutcome outcome;
+    std::thread::id thread;
+};
+
+// Runs the main loop the way the application does: loop() only while enabled
+static void run_main_loop(ZehnderRadio &radio, const std::vector<Completion> &completions, size_t expected) {
+    uint32_t start_ms = millis();
+    while (completions.size() < expected && millis() - start_ms < COMPLETION_LIMIT_MS) {
+        if (radio.is_loop_enabled()) {
+            radio.loop();
+        }
+        host::run_scheduler();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static void test_commands(ZehnderRadio &radio) {
+    const FanPairingInfo pairing{MOCK_NETWORK_ID, MOCK_MAIN_UNIT_ID, FAN_TYPE_MAIN_UNIT, 0x21};
+    std::vector<Completion> completions;
+    completions.reserve(2 * FAN_MAX_UNITS);
+
+    for (uint8_t round = 0; round < 2; round++) {
+        size_t expected = completions.size() + FAN_MAX_UNITS;
+        for (uint8_t unit = 0; unit < FAN_MAX_UNITS; unit++) {
+            uint8_t speed = FAN_SPEED_LOW + (unit + round) % FAN_SPEED_MAX;
+            radio.start_set_speed(unit, pairing, speed, 0, [&completions, unit](const FanOperationResult &result) {
+                completions.push_back(Completion{unit, result.outcome, std::this_thread::get_id()});
+            });
+        }
+        run_main_loop(radio, completions, expected);
+        CHECK(completions.size() == expected);
+    }
+
+    // The queued exchanges are served in turn, so each round completes in unit order
+    for (size_t i = 0; i < completions.size(); i++) {
+        CHECK(completions[i].unit == i % FAN_MAX_UNITS);
+        CHECK(completions[i].outcome == FanOperationOutcome::ACKED);
+        CHECK(completions[i].thread == std::this_thread::get_id());
+    }
+    // Nothing arrives twice
+    size_t count = completions.size();
+    run_main_loop(radio, completions, count + 1);
+    CHECK(completions.size() == count);
+}
+
+static void test_shutdown_flush(ZehnderRadio &radio) {
+    FanUnitRecord record = radio.get_unit_record(0);
+    record.pairing = FanPairingInfo{MOCK_NETWORK_ID, MOCK_MAIN_UNIT_ID, FAN_TYPE_MAIN_UNIT, 0x21};
+    record.flags |= FAN_RECORD_PAIRED | FAN_RECORD_SPEED_VALID;
+    record.fan_speed = FAN_SPEED_HIGH;
+
+    // Speed changes are written FAN_RECORD_WRITE_DELAY_MS after the first
+    // one; a later change does not push the write further out
+    host::set_manual_clock(true);
+    size_t writes = host::nvs_write_count();
+    radio.update_unit_record(0, record, false);
+    host::advance_us(FAN_RECORD_WRITE_DELAY_MS * 2000ULL / 3);
+    host::run_scheduler();
+    CHECK(host::nvs_write_count() == writes);
+    record.fan_speed = FAN_SPEED_MEDIUM;
+    radio.update_unit_record(0, record, false);
+    host::advance_us(FAN_RECORD_WRITE_DELAY_MS * 1000ULL / 3);
+    host::run_scheduler();
+    CHECK(host::nvs_write_count() == writes + 1);
+    host::set_manual_clock(false);
+
+    // One still waiting is written by on_shutdown()
+    record.fan_speed = FAN_SPEED_HIGH;
+    writes = host::nvs_write_count();
+    radio.update_unit_record(0, record, false);
+    host::run_scheduler();
+    CHECK(host::nvs_write_count() == writes);
+
+    radio.on_shutdown();
+    CHECK(host::nvs_write_count() == writes + 1);
+
+    char key[16];
+    snprintf(key, sizeof(key), "record_%08" PRIx32, fnv1_hash(RADIO_ID));
+    std::vector<uint8_t> value;
+    CHECK(host::nvs_read(key, value));
+    CHECK(value.size() == sizeof(FanPersistentRecord));
+    if (value.size() != sizeof(FanPersistentRecord)) {
+        return;
+    }
+    FanPersistentRecord stored;
+    memcpy(&stored, value.data(), sizeof(stored));
+    CHECK(stored.version == FAN_RECORD_VERSION);
+    CHECK(stored.crc == crc16(value.data(), offsetof(FanPersistentRecord, crc)));
+    CHECK(memcmp(&radio.get_unit_record(0), &record, sizeof(record)) == 0);
+
+    // Nothing left to write on a second shutdown
+    radio.on_shutdown();
+    CHECK(host::nvs_write_count() == writes + 1);
+}
+
+int main() {
+    host::set_log_level(HOST_LOG_LEVEL_ERROR);
+    host::nvs_reset();
+
+    ZehnderRadio radio;
+    radio.set_record_key(RADIO_ID);
+    radio.set_reply_delay(REPLY_DELAY_MS);
+    radio.setup();
+    CHECK(!radio.is_failed());
+
+    // The first pass finds nothing to hand over and puts the loop to sleep
+    radio.loop();
+    CHECK(!radio.is_loop_enabled());
+
+    test_commands(radio);
+    test_shutdown_flush(radio);
+
+    // Returns once the task left its wait
+    host::stop_tasks();
+    return check_result();
+}
@@ -0,0 +1,109 @@
+// RingBuffer: FIFO order, capacity and drop counting on one thread, then a
+// producer and a consumer thread passing sequence-numbered frames, the way
+// the GDO0 interrupt and the main loop share it on the device. A torn or
+// reordered item shows up as a sequence or payload mismatch.
+
+#include "check.h"
+#include "radio.h"
+#include "ring_buffer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+using namespace esphome::zehnder_fan;
+
+static const uint32_t SPSC_ITEMS = 1000000;
+
+static void test_single_thread() {
+    RingBuffer<uint32_t, 8> ring;
+    uint32_t item;
+    CHECK(ring.empty());
+    CHECK(!ring.pop(item));
+
+    // One slot stays free
+    for (uint32_t i = 0; i < 7; i++) {
+        CHECK(ring.push(i));
+    }
+    CHECK(!ring.push(7));
+    CHECK(ring.dropped() == 1);
+
+    for (uint32_t i = 0; i < 7; i++) {
+        CHECK(ring.pop(item) && item == i);
+    }
+    CHECK(ring.empty());
+
+    // Wraps around the end of the storage
+    for (uint32_t round = 0; round < 5; round++) {
+        for (uint32_t i = 0; i < 5; i++) {
+            CHECK(ring.push(round * 10 + i));
+        }
+        for (uint32_t i = 0; i < 5; i++) {
+            CHECK(ring.pop(item) && item == round * 10 + i);
+        }
+    }
+
+    ring.push(1);
+    ring.push(2);
+    ring.clear();
+    CHECK(ring.empty());
+    CHECK(!ring.pop(item));
+    CHECK(ring.push(3) && ring.pop(item) && item == 3);
+}
+
+static void fill_frame(RxFrame &frame, uint32_t sequence) {
+    memset(frame.data, sequence & 0xFF, sizeof(frame.data));
+    frame.status[0] = sequence >> 8;
+    frame.status[1] = sequence >> 16;
+    frame.timestamp_us = sequence;
+}
+
+static bool frame_matches(const RxFrame &frame, uint32_t sequence) {
+    RxFrame expected;
+    fill_frame(expected, sequence);
+    return memcmp(frame.data, expected.data, sizeof(frame.data)) == 0 &&
+           memcmp(frame.status, expected.status, sizeof(frame.status)) == 0 && frame.timestamp_us == sequence;
+}
+
+static void test_spsc_threads() {
+    static RingBuffer<RxFrame, FAN_RX_RING_SIZE> ring;
+    uint32_t full = 0;
+
+    std::thread producer([&full]() {
+        RxFrame frame;
+        for (uint32_t sequence = 0; sequence < SPSC_ITEMS; sequence++) {
+            fill_frame(frame, sequence);
+            while (!ring.push(frame)) {
+                full++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t received = 0;
+    uint32_t mismatches = 0;
+    RxFrame frame;
+    while (received < SPSC_ITEMS) {
+        if (!ring.pop(frame)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!frame_matches(frame, received)) {
+            mismatches++;
+        }
+        received++;
+    }
+    producer.join();
+
+    CHECK(mismatches == 0);
+    CHECK(ring.empty());
+    // Every rejected push was retried, and each one was counted as a drop
+    CHECK(ring.dropped() == full);
+    printf("SPSC: %u frames, %u pushes found the ring full\n", (unsigned) received, (unsigned) full);
+}
+
+int main() {
+    test_single_thread();
+    test_spsc_threads();
+    return check_result();
+}